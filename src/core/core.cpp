@@ -1,5 +1,15 @@
 #include "core.h"
 
+#include <cerrno>
+
+DEFINE_LOG_CATEGORY(engine);
+DEFINE_LOG_CATEGORY(validation);
+DEFINE_LOG_CATEGORY(window);
+DEFINE_LOG_CATEGORY(render_graph);
+DEFINE_LOG_CATEGORY(capture);
+DEFINE_LOG_CATEGORY(gpu);
+DEFINE_LOG_CATEGORY(core);
+
 void assert_vulkan_result(const vk::Result& result, const std::string& failure_message)
 {
     if (result != vk::Result::eSuccess)
@@ -44,6 +54,62 @@ bool has_environment_variable(const std::string& name)
     return get_environment_variable(name).has_value();
 }
 
+bool parse_unsigned(const std::string& value, std::uint64_t& out)
+{
+    if (value.empty() || value.front() < '0' || value.front() > '9')
+    {
+        return false;
+    }
+
+    char* end = nullptr;
+
+    errno = 0;
+
+    out = std::strtoull(value.c_str(), &end, 10);
+
+    return errno != ERANGE && *end == '\0';
+}
+
+std::string json_escape(std::string_view value)
+{
+    std::string result;
+
+    result.reserve(value.size());
+
+    for (const char character : value)
+    {
+        switch (character)
+        {
+        case '"':
+            result += "\\\"";
+            break;
+        case '\\':
+            result += "\\\\";
+            break;
+        case '\n':
+            result += "\\n";
+            break;
+        case '\r':
+            result += "\\r";
+            break;
+        case '\t':
+            result += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(character) < 0x20)
+            {
+                result += fmt::format("\\u{:04x}", static_cast<unsigned int>(static_cast<unsigned char>(character)));
+            }
+            else
+            {
+                result += character;
+            }
+        }
+    }
+
+    return result;
+}
+
 std::vector<char> read_file(const std::string& filename)
 {
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
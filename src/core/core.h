@@ -4,6 +4,8 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <algorithm>
 #include <cstdlib>
 #include <cstdint>
 #include <iostream>
@@ -76,12 +78,42 @@ std::optional<std::string> get_environment_variable(const std::string& name);
 
 bool has_environment_variable(const std::string& name);
 
+// The whole string as a decimal number, without sign or whitespace (strtoull accepts and negates "-1").
+bool parse_unsigned(const std::string& value, std::uint64_t& out);
+
+// Quotes, backslashes and control characters escaped for a JSON string.
+std::string json_escape(std::string_view value);
+
 class engine;
 class sdl_window;
 
+// Engine lifecycle and frame loop, the per object trace messages are compiled out of release builds.
+#ifdef NDEBUG
+DECLARE_LOG_CATEGORY(engine, SPDLOG_LEVEL_DEBUG);
+#else
+DECLARE_LOG_CATEGORY(engine, SPDLOG_LEVEL_TRACE);
+#endif
+
+// Messages of the validation layers.
+DECLARE_LOG_CATEGORY(validation, SPDLOG_LEVEL_TRACE);
+
+DECLARE_LOG_CATEGORY(window, SPDLOG_LEVEL_TRACE);
+
+// Render graph compiles, transient resource (re)creation.
+DECLARE_LOG_CATEGORY(render_graph, SPDLOG_LEVEL_TRACE);
+
+// Frame capture buffers and the files written by the capture workers.
+DECLARE_LOG_CATEGORY(capture, SPDLOG_LEVEL_TRACE);
+
+// GPU completion waiter and watchdog.
+DECLARE_LOG_CATEGORY(gpu, SPDLOG_LEVEL_TRACE);
+
+// Helpers shared by all of the above, e.g. the exceptions thrown by throw_exception().
+DECLARE_LOG_CATEGORY(core, SPDLOG_LEVEL_TRACE);
+
 inline void throw_exception(std::string message)
 {
-    SPDLOG_CRITICAL("Exception thrown: '{}'.", message.c_str());
+    LOG_CRITICAL(core, "Exception thrown: '{}'.", message);
 
     throw std::runtime_error(message);
 }
@@ -0,0 +1,37 @@
+#include "deletion_queue.h"
+
+void deletion_queue::push(std::uint64_t last_use, std::function<void()> destroy)
+{
+    // Pushed in frame order nearly always, so this finds the spot right away.
+    auto position = entries_.end();
+
+    while (position != entries_.begin() && std::prev(position)->last_use > last_use)
+    {
+        --position;
+    }
+
+    entries_.insert(position, entry{ last_use, std::move(destroy) });
+}
+
+std::size_t deletion_queue::collect(std::uint64_t completed)
+{
+    std::size_t destroyed{ 0 };
+
+    while (!entries_.empty() && entries_.front().last_use <= completed)
+    {
+        auto destroy = std::move(entries_.front().destroy);
+
+        entries_.pop_front();
+
+        destroy();
+
+        ++destroyed;
+    }
+
+    return destroyed;
+}
+
+std::size_t deletion_queue::flush()
+{
+    return collect(std::numeric_limits<std::uint64_t>::max());
+}
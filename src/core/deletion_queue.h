@@ -0,0 +1,50 @@
+#ifndef DELETION_QUEUE_H_
+#define DELETION_QUEUE_H_
+
+#include "core/core.h"
+
+#include <deque>
+#include <functional>
+#include <limits>
+
+// Vulkan objects waiting for the GPU to be done with them, instead of waiting for the GPU.
+// Every entry carries the frame timeline value of the last submission that may use the object,
+// collect() is called once per frame with the value the GPU has reached and destroys what it passed.
+// Only used from the thread recording and submitting frames.
+class deletion_queue
+{
+public:
+    void push(std::uint64_t last_use, std::function<void()> destroy);
+
+    // Any handle vk::Device::destroy() takes (buffers, images, views, pipelines, semaphores, ...).
+    template <typename Handle>
+    void push(std::uint64_t last_use, vk::Device device, Handle handle, const vk::DispatchLoaderDynamic& dispatch)
+    {
+        if (!handle)
+        {
+            return;
+        }
+
+        push(last_use, [device, handle, &dispatch]() { device.destroy(handle, nullptr, dispatch); });
+    }
+
+    // Destroys the entries last used at or before completed, returns how many.
+    std::size_t collect(std::uint64_t completed);
+
+    // Destroys everything, the device must be idle.
+    std::size_t flush();
+
+    std::size_t size() const { return entries_.size(); }
+
+private:
+    struct entry
+    {
+        std::uint64_t last_use{ 0 };
+        std::function<void()> destroy;
+    };
+
+    // ordered by last_use, entries with the same value in the order they were pushed
+    std::deque<entry> entries_;
+};
+
+#endif
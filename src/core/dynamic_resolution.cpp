@@ -0,0 +1,49 @@
+#include "dynamic_resolution.h"
+
+#include <cmath>
+
+dynamic_resolution::dynamic_resolution(std::chrono::duration<float, std::milli> budget)
+    : budget_(budget)
+{
+}
+
+void dynamic_resolution::add_frame_time(std::chrono::duration<float, std::milli> gpu_time)
+{
+    if (gpu_time.count() <= 0.0f)
+    {
+        return;
+    }
+
+    if (first_frame_)
+    {
+        smoothed_ = gpu_time;
+        first_frame_ = false;
+    }
+    else
+    {
+        smoothed_ += (gpu_time - smoothed_) * SMOOTHING;
+    }
+
+    const auto desired = std::clamp(scale_ * std::sqrt(budget_.count() * TARGET_FRACTION / smoothed_.count()), MIN_SCALE, MAX_SCALE);
+
+    if (std::abs(desired - scale_) < DEAD_BAND)
+    {
+        // The slow approach would never quite get back to full resolution.
+        if (desired == MAX_SCALE)
+        {
+            scale_ = MAX_SCALE;
+        }
+
+        return;
+    }
+
+    scale_ += (desired - scale_) * (desired < scale_ ? DOWN_RATE : UP_RATE);
+}
+
+vk::Extent2D dynamic_resolution::scaled_extent(const vk::Extent2D& full_extent) const
+{
+    return vk::Extent2D{
+        std::max(1u, static_cast<std::uint32_t>(std::lround(static_cast<float>(full_extent.width) * scale_))),
+        std::max(1u, static_cast<std::uint32_t>(std::lround(static_cast<float>(full_extent.height) * scale_)))
+    };
+}
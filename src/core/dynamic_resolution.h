@@ -0,0 +1,43 @@
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+#include "core/core.h"
+
+// Picks the resolution scale of the offscreen target from the measured GPU frame times, so the
+// GPU time stays under a budget instead of the frame rate dropping.
+// The frame times are smoothed, the scale moves toward the one that would put the smoothed time
+// at TARGET_FRACTION of the budget: fast when over budget, slowly when there is room to grow.
+// The pixel count goes with the square of the scale, so the scale goes with the square root of the time ratio.
+class dynamic_resolution
+{
+public:
+    constexpr static float MIN_SCALE = 0.5f;
+    constexpr static float MAX_SCALE = 1.0f;
+    constexpr static float TARGET_FRACTION = 0.9f;
+    constexpr static float SMOOTHING = 0.2f;
+    constexpr static float DOWN_RATE = 0.5f;
+    constexpr static float UP_RATE = 0.05f;
+    // Changes smaller than this are ignored, the resolution doesn't wobble around the target.
+    constexpr static float DEAD_BAND = 0.01f;
+
+    explicit dynamic_resolution(std::chrono::duration<float, std::milli> budget);
+
+    void add_frame_time(std::chrono::duration<float, std::milli> gpu_time);
+
+    float scale() const { return scale_; }
+
+    std::chrono::duration<float, std::milli> budget() const { return budget_; }
+    std::chrono::duration<float, std::milli> smoothed_frame_time() const { return smoothed_; }
+
+    // The extent to render at, never empty.
+    vk::Extent2D scaled_extent(const vk::Extent2D& full_extent) const;
+
+private:
+    std::chrono::duration<float, std::milli> budget_;
+    std::chrono::duration<float, std::milli> smoothed_{ 0.0f };
+
+    bool first_frame_{ true };
+    float scale_{ MAX_SCALE };
+};
+
+#endif
@@ -2,7 +2,8 @@
 
 #include "sdl_window.h"
 
-engine::engine()
+engine::engine(engine_config config)
+    : config_(std::move(config))
 {
 
 }
@@ -14,7 +15,9 @@ engine::~engine()
 
 void engine::initialize()
 {
-    SPDLOG_INFO("Initializing...");
+    LOG_INFO(engine, "Initializing...");
+
+    shared_memory_sink_ = find_log_sink<spdlog::sinks::shared_memory_sink_mt>();
 
     const auto vkt_gpu_type = get_environment_variable("VKT_GPU_TYPE");
 
@@ -28,64 +31,115 @@ void engine::initialize()
         {
             preferred_physical_device_type_ = vk::PhysicalDeviceType::eIntegratedGpu;
         }
+        else if (vkt_gpu_type.value() == "cpu")
+        {
+            // Software implementations such as lavapipe.
+            preferred_physical_device_type_ = vk::PhysicalDeviceType::eCpu;
+        }
         else
         {
             throw std::runtime_error(fmt::format("Unknown GPU type specified: '{}'.", vkt_gpu_type.value()));
         }
     }
 
+    if (config_.gpu_type)
+    {
+        preferred_physical_device_type_ = config_.gpu_type.value();
+    }
+
+    if (const auto present_mode_setting = get_environment_variable("VKT_PRESENT_MODE"))
+    {
+        if (present_mode_setting.value() == "low_latency")
+        {
+            low_latency_requested_ = true;
+            requested_present_mode_ = vk::PresentModeKHR::eFifo;
+        }
+        else if (const auto present_mode = present_mode_from_name(present_mode_setting.value()))
+        {
+            requested_present_mode_ = present_mode.value();
+        }
+        else
+        {
+            throw_exception(fmt::format("Unknown VKT_PRESENT_MODE value: '{}'.", present_mode_setting.value()));
+        }
+    }
+
+    if (config_.low_latency)
+    {
+        low_latency_requested_ = config_.low_latency.value();
+
+        // Paced FIFO doesn't tear and queues at most one frame.
+        if (low_latency_requested_)
+        {
+            requested_present_mode_ = vk::PresentModeKHR::eFifo;
+        }
+    }
+
+    if (config_.present_mode)
+    {
+        requested_present_mode_ = config_.present_mode.value();
+    }
+
+    validation_enabled_ = USE_DEBUG_LAYERS && config_.validation.value_or(!has_environment_variable("VKT_DISABLE_VALIDATION"));
+
     if (RENDER_THREAD_ENABLED)
     {
-        SPDLOG_INFO("Starting render thread...");
+        LOG_INFO(engine, "Starting render thread...");
 
         render_thread_ = std::thread([this]() { this->render_entrypoint_(); });
 
-        SPDLOG_INFO("Started render thread.");
+        LOG_INFO(engine, "Started render thread.");
     }
     else
     {
-        SPDLOG_WARN("Render thread not enabled.");
+        LOG_WARN(engine, "Render thread not enabled.");
     }
 
     auto vk_layer_path_env = get_environment_variable("VK_LAYER_PATH");
 
     if (vk_layer_path_env)
     {
-        SPDLOG_INFO("VK_LAYER_PATH = '{}'.", vk_layer_path_env.value().c_str());
+        LOG_INFO(engine, "VK_LAYER_PATH = '{}'.", vk_layer_path_env.value().c_str());
     }
 
-    if (!has_environment_variable("VKT_DISABLE_VALIDATION") || !USE_DEBUG_LAYERS)
+    if (validation_enabled_)
     {
         layers_.emplace_back("VK_LAYER_KHRONOS_validation");
     }
     else
     {
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
     }
 
-    instance_extensions_.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
-
-    if (!has_environment_variable("VKT_DISABLE_VALIDATION") || !USE_DEBUG_LAYERS)
+    if (validation_enabled_)
     {
         instance_extensions_.emplace_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
         instance_extensions_.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
-    instance_extensions_.emplace_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+    if (config_.headless)
+    {
+        LOG_INFO(engine, "Running headless at {}x{}.", config_.headless_extent.width, config_.headless_extent.height);
+    }
+    else
+    {
+        instance_extensions_.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
+        instance_extensions_.emplace_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
 
 #ifdef WIN32
-    instance_extensions_.emplace_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+        instance_extensions_.emplace_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #else
-    instance_extensions_.emplace_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
-    //instance_extensions_.emplace_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
+        instance_extensions_.emplace_back(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
+        //instance_extensions_.emplace_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
 #endif
 
-    device_extensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        device_extensions_.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
     create_sdl_window_();
     create_instance_();
@@ -96,33 +150,39 @@ void engine::initialize()
     create_device_();
     retrieve_queues_();
     query_swapchain_support_();
+    select_dynamic_resolution_();
+    create_frame_capture_();
     create_swapchain_();
     retrieve_swapchain_images_();
     create_render_pass_();
     create_graphics_pipeline_();
     create_framebuffers_();
     create_command_pools_();
+    create_frame_timeline_();
+    create_gpu_completion_();
+    create_render_graph_();
+    create_timestamp_queries_();
 
-    SPDLOG_INFO("Initialized.");
+    LOG_INFO(engine, "Initialized.");
 }
 
 void engine::destroy()
 {
-    SPDLOG_TRACE("Destroying everything...");
+    LOG_TRACE(engine, "Destroying everything...");
 
     if (RENDER_THREAD_ENABLED)
     {
-        SPDLOG_TRACE("Stopping render thread...");
+        LOG_TRACE(engine, "Stopping render thread...");
 
         render_thread_active_ = false;
 
         render_queue_.enqueue(nullptr);
 
-        SPDLOG_TRACE("Joining render thread...");
+        LOG_TRACE(engine, "Joining render thread...");
 
         render_thread_.join();
 
-        SPDLOG_TRACE("Stopped render thread.");
+        LOG_TRACE(engine, "Stopped render thread.");
     }
 
     destroy_frame_in_flight_(new_frame_in_flight, true);
@@ -132,28 +192,40 @@ void engine::destroy()
     destroy_render_pass_();
     destroy_swapchain_image_views_();
     destroy_swapchain_();
+
+    LOG_TRACE(engine, "Flushing deletion queue ({} object(s))...", deletion_queue_.size());
+
+    destroy_frame_capture_();
+    destroy_timestamp_queries_();
+    destroy_render_graph_();
+
+    // run() waited for the device to be idle
+    deletion_queue_.flush();
+
+    destroy_gpu_completion_();
+    destroy_frame_timeline_();
     destroy_device_();
     destroy_surface_();
     destroy_debug_utils_ext_();
     destroy_instance_();
     destroy_sdl_window_();
 
-    if (has_environment_variable("VKT_DISABLE_VALIDATION"))
+    if (!validation_enabled_)
     {
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
-        SPDLOG_CRITICAL("VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
+        LOG_CRITICAL(engine, "VALIDATION IS DISABLED!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!");
     }
 
-    SPDLOG_TRACE("Destroyed everything.");
+    LOG_TRACE(engine, "Destroyed everything.");
 }
 
 int engine::run()
 {
-    SPDLOG_INFO("Engine is running.");
+    LOG_INFO(engine, "Engine is running.");
 
     start_point_ = clock::now();
 
@@ -173,16 +245,40 @@ int engine::run()
     // WAIT IDLE
     // WAIT IDLE
 
-    SPDLOG_INFO("Engine has stopped.");
+    if (input_latency_.count() > 0)
+    {
+        LOG_INFO(engine, "Input latency until {}: mean {:.2f} ms, p50 {:.0f} ms, p99 {:.0f} ms, max {:.2f} ms over {} frame(s).",
+            present_wait_ ? "presented" : "rendered", input_latency_.mean(), input_latency_.percentile(0.50f),
+            input_latency_.percentile(0.99f), input_latency_.max(), input_latency_.count());
+    }
+
+    LOG_INFO(engine, "Engine has stopped.");
 
     return 0;
 }
 
+void engine::request_capture()
+{
+    if (!frame_capture_)
+    {
+        LOG_WARN(engine, "Frame capture is not enabled (VKT_CAPTURE), capture request ignored.");
+
+        return;
+    }
+
+    capture_requests_++;
+}
+
+std::string engine::device_name() const
+{
+    return selected_physical_device_info_ ? std::string(selected_physical_device_info_->properties.properties.deviceName.data()) : std::string{};
+}
+
 void engine::stop()
 {
     main_loop_running_ = false;
 
-    SPDLOG_WARN("Engine is set to stop.");
+    LOG_INFO(engine, "Engine is set to stop.");
 }
 
 void engine::main_loop_()
@@ -195,29 +291,153 @@ void engine::main_loop_()
 
         second_counter_++;
 
-        sdl_window_->set_title(fmt::format("Vulkan Testing ({}): {} second(s) elapsed, {} FPS.", selected_physical_device_info_->properties.properties.deviceName, second_counter_, fps_counter_));
-        SPDLOG_INFO("Tick {}: {} second(s) elapsed, {} FPS.", ticks_, second_counter_, fps_counter_);
+        if (sdl_window_)
+        {
+            sdl_window_->set_title(fmt::format("Vulkan Testing ({}): {} second(s) elapsed, {} FPS.", selected_physical_device_info_->properties.properties.deviceName, second_counter_, fps_counter_));
+        }
+
+        LOG_INFO(engine, "Tick {}: {} second(s) elapsed, {} FPS.", ticks_, second_counter_, fps_counter_);
+
+        auto stats = take_log_queue_stats();
+
+        report_log_stats_(stats);
+        publish_counters_(stats);
+
+        if (dynamic_resolution_)
+        {
+            LOG_DEBUG(engine, "GPU frame time {:.2f} ms (smoothed {:.2f} ms, budget {:.2f} ms), resolution scale {:.0f}%.",
+                last_gpu_frame_time_.count(), dynamic_resolution_->smoothed_frame_time().count(), dynamic_resolution_->budget().count(), dynamic_resolution_->scale() * 100.0f);
+        }
+
+        if (input_latency_.count() > 0)
+        {
+            LOG_DEBUG(engine, "Input latency until {}: p50 {:.0f} ms, p95 {:.0f} ms, p99 {:.0f} ms, max {:.2f} ms over {} frame(s).",
+                present_wait_ ? "presented" : "rendered", input_latency_.percentile(0.50f), input_latency_.percentile(0.95f),
+                input_latency_.percentile(0.99f), input_latency_.max(), input_latency_.count());
+        }
 
         fps_counter_ = 0;
     }
     
     if (first_tick_)
     {
-        SPDLOG_INFO("First tick started.");
+        LOG_INFO(engine, "First tick started.");
     }
 
-    sdl_window_->process_events();
+    wait_for_previous_present_();
+
+    if (sdl_window_)
+    {
+        sdl_window_->process_events();
+
+        frame_input_time_ = sdl_window_->take_earliest_input();
+
+        if (sdl_window_->take_capture_request())
+        {
+            request_capture();
+        }
+    }
 
     draw_frame_();
 
+    if (config_.frame_callback)
+    {
+        // draw_frame_() waited for the frame, its timestamps are there.
+        read_timestamps_(completed_timeline_value_());
+
+        frame_stats stats{};
+
+        stats.frame = ticks_;
+        stats.cpu_time = last_cpu_frame_time_;
+        stats.gpu_time = last_gpu_frame_time_;
+        stats.wait_time = last_gpu_wait_time_;
+        stats.resolution_scale = dynamic_resolution_ ? dynamic_resolution_->scale() : 1.0f;
+
+        config_.frame_callback(stats);
+    }
+
     if (first_tick_)
     {
-        SPDLOG_INFO("First tick done.");
+        LOG_INFO(engine, "First tick done.");
 
         first_tick_ = false;
     }
 
     ticks_++;
+
+    if (config_.frame_limit != 0 && ticks_ >= config_.frame_limit)
+    {
+        LOG_INFO(engine, "Frame limit of {} reached.", config_.frame_limit);
+
+        stop();
+    }
+}
+
+void engine::report_log_stats_(const log_queue_stats& stats)
+{
+    if (!stats.asynchronous)
+    {
+        return;
+    }
+
+    if (stats.overrun_counter != last_log_overrun_counter_)
+    {
+        LOG_WARN(engine, "Log queue overran, {} message(s) dropped since the last report.", stats.overrun_counter - last_log_overrun_counter_);
+
+        last_log_overrun_counter_ = stats.overrun_counter;
+    }
+
+    LOG_DEBUG(engine, "Log queue: {}/{} queued, {} message(s) enqueued, enqueue latency average {} ns, max {} ns.",
+        stats.queue_depth, stats.queue_capacity, stats.enqueued, stats.enqueue_latency_average.count(), stats.enqueue_latency_max.count());
+}
+
+void engine::publish_counters_(const log_queue_stats& stats)
+{
+    if (!shared_memory_sink_)
+    {
+        return;
+    }
+
+    shared_memory_sink_->set_counter("seconds", static_cast<std::int64_t>(second_counter_));
+    shared_memory_sink_->set_counter("fps", static_cast<std::int64_t>(fps_counter_));
+    shared_memory_sink_->set_counter("ticks", static_cast<std::int64_t>(ticks_));
+    shared_memory_sink_->set_counter("log_queue_depth", static_cast<std::int64_t>(stats.queue_depth));
+    shared_memory_sink_->set_counter("log_overruns", static_cast<std::int64_t>(stats.overrun_counter));
+    shared_memory_sink_->set_counter("log_enqueue_max_ns", static_cast<std::int64_t>(stats.enqueue_latency_max.count()));
+
+    if (timestamp_query_pool_)
+    {
+        shared_memory_sink_->set_counter("gpu_frame_us", static_cast<std::int64_t>(last_gpu_frame_time_.count() * 1000.0f));
+    }
+
+    shared_memory_sink_->set_counter("gpu_wait_us", static_cast<std::int64_t>(last_gpu_wait_time_.count() * 1000.0f));
+
+    if (low_latency())
+    {
+        shared_memory_sink_->set_counter("present_wait_us", static_cast<std::int64_t>(last_present_wait_.count() * 1000.0f));
+    }
+
+    if (input_latency_.count() > 0)
+    {
+        shared_memory_sink_->set_counter("input_latency_us", static_cast<std::int64_t>(last_input_latency_.count() * 1000.0f));
+        shared_memory_sink_->set_counter("input_latency_p95_us", static_cast<std::int64_t>(input_latency_.percentile(0.95f) * 1000.0f));
+    }
+
+    if (dynamic_resolution_)
+    {
+        shared_memory_sink_->set_counter("resolution_scale_pct", static_cast<std::int64_t>(dynamic_resolution_->scale() * 100.0f));
+    }
+
+    if (frame_capture_)
+    {
+        shared_memory_sink_->set_counter("captures", static_cast<std::int64_t>(frame_capture_->captured()));
+        shared_memory_sink_->set_counter("captures_dropped", static_cast<std::int64_t>(frame_capture_->dropped()));
+    }
+
+    if (validation_messages_)
+    {
+        shared_memory_sink_->set_counter("validation_messages", static_cast<std::int64_t>(validation_messages_->messages_emitted()));
+    }
 }
 
 void engine::create_frame_in_flight_(frame_in_flight& p_frame_in_flight)
@@ -258,23 +478,44 @@ void engine::create_frame_in_flight_(frame_in_flight& p_frame_in_flight)
 
 void engine::destroy_frame_in_flight_(frame_in_flight& p_frame_in_flight, bool final_destroy)
 {
-    device_.freeCommandBuffers(*p_frame_in_flight.command_pool_ptr, p_frame_in_flight.command_buffer, dispatch_);
-    device_.destroySemaphore(p_frame_in_flight.image_available_semaphore, nullptr, dispatch_);
-    device_.destroySemaphore(p_frame_in_flight.render_finished_semaphore, nullptr, dispatch_);
-    device_.destroyFence(p_frame_in_flight.fence);
+    if (p_frame_in_flight.command_pool_ptr != nullptr)
+    {
+        // A frame that was never submitted may still have an acquire pending on its semaphore,
+        // that is covered by the last submission.
+        auto last_use = p_frame_in_flight.timeline_value != 0 ? p_frame_in_flight.timeline_value : last_timeline_value_;
 
-    p_frame_in_flight.command_buffer = nullptr;
-    p_frame_in_flight.image_available_semaphore = nullptr;
-    p_frame_in_flight.render_finished_semaphore = nullptr;
-    p_frame_in_flight.command_pool_ptr = nullptr;
-    p_frame_in_flight.swapchain_image_index = 0;
-    //p_frame_in_flight.frame_done.reset();
+        auto command_pool = *p_frame_in_flight.command_pool_ptr;
+        auto command_buffer = p_frame_in_flight.command_buffer;
+
+        deletion_queue_.push(last_use, [this, command_pool, command_buffer]() { device_.freeCommandBuffers(command_pool, command_buffer, dispatch_); });
+        deletion_queue_.push(last_use, device_, p_frame_in_flight.image_available_semaphore, dispatch_);
+        deletion_queue_.push(last_use, device_, p_frame_in_flight.render_finished_semaphore, dispatch_);
+        deletion_queue_.push(last_use, device_, p_frame_in_flight.fence, dispatch_);
+    }
+
+    if (final_destroy)
+    {
+        deletion_queue_.flush();
+    }
 
     p_frame_in_flight = frame_in_flight{};
 }
 
 void engine::draw_frame_()
 {
+    const auto frame_start = std::chrono::steady_clock::now();
+
+    const auto completed = completed_timeline_value_();
+
+    deletion_queue_.collect(completed);
+
+    read_timestamps_(completed);
+
+    if (frame_capture_)
+    {
+        frame_capture_->collect(completed);
+    }
+
     if (out_of_date_)
     {
         recreate_swapchain_();
@@ -293,36 +534,65 @@ void engine::draw_frame_()
 
     create_frame_in_flight_(new_frame_in_flight);
 
+    new_frame_in_flight.input_time = std::exchange(frame_input_time_, std::nullopt);
+
     {
-        auto result = device_.acquireNextImageKHR(swapchain_, std::numeric_limits<std::uint64_t>::max(),
-                                                  new_frame_in_flight.image_available_semaphore, nullptr, &new_frame_in_flight.swapchain_image_index,
-                                             dispatch_);
+        auto result = vk::Result::eSuccess;
+
+        if (config_.headless)
+        {
+            // The offscreen images take turns, the previous frame was waited for.
+            new_frame_in_flight.swapchain_image_index = static_cast<std::uint32_t>(ticks_ % swapchain_images_.size());
+        }
+        else
+        {
+            result = device_.acquireNextImageKHR(swapchain_, std::numeric_limits<std::uint64_t>::max(),
+                new_frame_in_flight.image_available_semaphore, nullptr, &new_frame_in_flight.swapchain_image_index, dispatch_);
+        }
 
         if (result == vk::Result::eSuboptimalKHR)
         {
+            // The image was acquired, it is still rendered and presented. The swapchain is
+            // recreated next frame, so the acquire semaphore never stays signaled.
             out_of_date_ = true;
-
-            return;
         }
-
-        EVK_ASSERT_RESULT(result, "Failed to acquire image.");
+        else
+        {
+            EVK_ASSERT_RESULT(result, "Failed to acquire image.");
+        }
 
         record_command_buffer_(new_frame_in_flight);
 
         const vk::PipelineStageFlags wait_dst_stage_mask[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
 
-        const vk::Semaphore signal_semaphores[1] = { new_frame_in_flight.render_finished_semaphore };
+        new_frame_in_flight.timeline_value = ++last_timeline_value_;
+
+        const vk::Semaphore signal_semaphores[2] = { frame_timeline_, new_frame_in_flight.render_finished_semaphore };
+
+        // the binary semaphores ignore their values
+        const std::uint64_t wait_values[1] = { 0 };
+        const std::uint64_t signal_values[2] = { new_frame_in_flight.timeline_value, 0 };
+
+        // Headless frames have no image to wait for and nothing to present.
+        const std::uint32_t wait_count = config_.headless ? 0 : 1;
+        const std::uint32_t signal_count = config_.headless ? 1 : 2;
 
-        vk::StructureChain<vk::SubmitInfo> chain{};
+        vk::StructureChain<vk::SubmitInfo, vk::TimelineSemaphoreSubmitInfo> chain{};
+
+        chain.get<vk::TimelineSemaphoreSubmitInfo>()
+            .setWaitSemaphoreValueCount(wait_count)
+            .setPWaitSemaphoreValues(wait_values)
+            .setSignalSemaphoreValueCount(signal_count)
+            .setPSignalSemaphoreValues(signal_values);
 
         auto& submit_info = chain.get<vk::SubmitInfo>();
 
-        submit_info.setWaitSemaphoreCount(1)
+        submit_info.setWaitSemaphoreCount(wait_count)
             .setPWaitSemaphores(&new_frame_in_flight.image_available_semaphore)
             .setPWaitDstStageMask(wait_dst_stage_mask)
             .setCommandBufferCount(1)
             .setPCommandBuffers(&new_frame_in_flight.command_buffer)
-            .setSignalSemaphoreCount(1)
+            .setSignalSemaphoreCount(signal_count)
             .setPSignalSemaphores(signal_semaphores);
 
         result = graphics_queue_.submit(1, &submit_info, new_frame_in_flight.fence, dispatch_);
@@ -332,25 +602,41 @@ void engine::draw_frame_()
 
     //render_queue_.enqueue(&new_frame_in_flight);
 
-    present_(&new_frame_in_flight);
+    if (!config_.headless)
+    {
+        present_(&new_frame_in_flight);
+    }
+
+    last_cpu_frame_time_ = std::chrono::steady_clock::now() - frame_start;
 
-    wait_on_fence(new_frame_in_flight.fence, "command buffers");
+    last_gpu_wait_time_ = gpu_completion_->wait(new_frame_in_flight.timeline_value);
+
+    // Without present ids the latency ends when the GPU is done.
+    if (!present_wait_ && new_frame_in_flight.input_time)
+    {
+        add_input_latency_(new_frame_in_flight.input_time.value(), std::chrono::steady_clock::now());
+    }
 
     //current_frame_ = (current_frame_ + 1) % MAXIMUM_FRAMES_IN_FLIGHT;
 }
 
 void engine::create_sdl_window_()
 {
-    SPDLOG_INFO("Creating SDL window...");
+    if (config_.headless)
+    {
+        return;
+    }
+
+    LOG_INFO(engine, "Creating SDL window...");
 
     sdl_window_ = std::make_unique<sdl_window>(*this);
 
-    SPDLOG_INFO("SDL window created.");
+    LOG_INFO(engine, "SDL window created.");
 }
 
 void engine::create_instance_()
 {
-    SPDLOG_DEBUG("Creating the Vulkan instance...");
+    LOG_DEBUG(engine, "Creating the Vulkan instance...");
 
     vk::ApplicationInfo application_info{};
 
@@ -376,17 +662,17 @@ void engine::create_instance_()
 
     dispatch_.init(instance_, vkGetInstanceProcAddr);
 
-    SPDLOG_DEBUG("Successfully created the Vulkan instance.");
+    LOG_DEBUG(engine, "Successfully created the Vulkan instance.");
 }
 
 void engine::create_debug_utils_ext_()
 {
-    if (!USE_DEBUG_LAYERS)
+    if (!validation_enabled_)
     {
         return;
     }
 
-    SPDLOG_INFO("Creating debug utils messenger callback...");
+    LOG_INFO(engine, "Creating debug utils messenger callback...");
 
     vk::DebugUtilsMessengerCreateInfoEXT create_info{};
 
@@ -401,25 +687,32 @@ void engine::create_debug_utils_ext_()
             vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance |
             vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation);
 
+    validation_messages_ = std::make_unique<validation_messages>();
+
     create_info.pUserData = reinterpret_cast<void*>(this);
 
     create_info.pfnUserCallback = &messenger_callback;
 
     debug_utils_messenger_ = instance_.createDebugUtilsMessengerEXT(create_info, nullptr, dispatch_);
 
-    SPDLOG_INFO("Created debug utils messenger callback.");
+    LOG_INFO(engine, "Created debug utils messenger callback.");
 }
 
 void engine::create_surface_()
 {
-    SPDLOG_INFO("Creating surface...");
+    if (config_.headless)
+    {
+        return;
+    }
+
+    LOG_INFO(engine, "Creating surface...");
 
     const auto wm_info = sdl_window_->get_system_wm_info();
 
     vk::Result result;
 
 #ifdef WIN32
-    SPDLOG_INFO("Using Win32 surface.");
+    LOG_INFO(engine, "Using Win32 surface.");
 
     vk::Win32SurfaceCreateInfoKHR create_info{};
 
@@ -434,7 +727,7 @@ void engine::create_surface_()
 
     if (!display || display.value().empty() || sdl_videodriver == "wayland")
     {
-        SPDLOG_INFO("Using Wayland surface.");
+        LOG_INFO(engine, "Using Wayland surface.");
 
         vk::WaylandSurfaceCreateInfoKHR create_info{};
 
@@ -446,7 +739,7 @@ void engine::create_surface_()
     }
     else
     {
-        SPDLOG_INFO("Using X11 surface.");
+        LOG_INFO(engine, "Using X11 surface.");
 
         vk::XlibSurfaceCreateInfoKHR create_info{};
 
@@ -460,14 +753,19 @@ void engine::create_surface_()
 
     EVK_ASSERT_RESULT(result, "Failed to create surface.");
 
-    SPDLOG_INFO("Created surface.");
+    LOG_INFO(engine, "Created surface.");
 }
 
 void engine::enumerate_physical_devices_()
 {
-    SPDLOG_INFO("Enumerating physical devices...");
+    LOG_INFO(engine, "Enumerating physical devices...");
 
-    const auto wm_info = sdl_window_->get_system_wm_info();
+    SDL_SysWMinfo wm_info{};
+
+    if (sdl_window_)
+    {
+        wm_info = sdl_window_->get_system_wm_info();
+    }
 
     const auto physical_devices = instance_.enumeratePhysicalDevices(dispatch_);
 
@@ -481,36 +779,46 @@ void engine::enumerate_physical_devices_()
         new_info.features = physical_device.getFeatures2(dispatch_);
         new_info.queue_families = physical_device.getQueueFamilyProperties2(dispatch_);
 
-        SPDLOG_INFO("Found physical device: '{}'.", new_info.properties.properties.deviceName.data());
+        LOG_INFO(engine, "Found physical device: '{}'.", new_info.properties.properties.deviceName.data());
 
-        const auto present_modes = physical_device.getSurfacePresentModesKHR(surface_, dispatch_);
-
-        for (auto present_mode : present_modes)
+        if (surface_)
         {
-            SPDLOG_INFO("Physical device and surface supports present mode '{}'.", vk::to_string(present_mode).c_str());
+            const auto present_modes = physical_device.getSurfacePresentModesKHR(surface_, dispatch_);
+
+            for (auto present_mode : present_modes)
+            {
+                LOG_INFO(engine, "Physical device and surface supports present mode '{}'.", vk::to_string(present_mode).c_str());
+            }
         }
 
         std::uint32_t queue_family_index{ 0 };
 
         for (auto queue_family : new_info.queue_families)
         {
-            SPDLOG_INFO("Testing queue family index {}.", queue_family_index);
+            LOG_INFO(engine, "Testing queue family index {}.", queue_family_index);
 
             if (queue_family.queueFamilyProperties.queueFlags & vk::QueueFlagBits::eGraphics)
             {
                 new_info.graphics_family_queue_indices_.emplace_back(queue_family_index);
 
-                SPDLOG_INFO("Found graphics family queue at index {}.", queue_family_index);
+                LOG_INFO(engine, "Found graphics family queue at index {}.", queue_family_index);
             }
 
             if (queue_family.queueFamilyProperties.queueFlags & vk::QueueFlagBits::eTransfer)
             {
                 new_info.transfer_family_queue_indices_.emplace_back(queue_family_index);
 
-                SPDLOG_INFO("Found transfer family queue at index {}.", queue_family_index);
+                LOG_INFO(engine, "Found transfer family queue at index {}.", queue_family_index);
             }
 
-            SPDLOG_INFO("Querying surface support...");
+            if (!surface_)
+            {
+                queue_family_index++;
+
+                continue;
+            }
+
+            LOG_INFO(engine, "Querying surface support...");
 
             vk::Bool32 present_support{ false };
 
@@ -518,11 +826,11 @@ void engine::enumerate_physical_devices_()
 
             if (result != vk::Result::eSuccess)
             {
-                SPDLOG_WARN("Querying surface support has failed: '{}'.", vk::to_string(result).c_str());
+                LOG_WARN(engine, "Querying surface support has failed: '{}'.", vk::to_string(result).c_str());
             }
             else if (present_support)
             {
-                SPDLOG_INFO("Surface is supported by queue family index {}.", queue_family_index);
+                LOG_INFO(engine, "Surface is supported by queue family index {}.", queue_family_index);
 
                 new_info.present_family_queue_indices_.emplace_back(queue_family_index);
             }
@@ -534,7 +842,7 @@ void engine::enumerate_physical_devices_()
 
                 if (present_support)
                 {
-                    SPDLOG_INFO("Surface is supported for Wayland by queue family index {}.", queue_family_index);
+                    LOG_INFO(engine, "Surface is supported for Wayland by queue family index {}.", queue_family_index);
 
                     new_info.present_family_queue_indices_.emplace_back(queue_family_index);
                 }
@@ -545,7 +853,7 @@ void engine::enumerate_physical_devices_()
         }
     }
 
-    SPDLOG_INFO("Enumerated physical devices.");
+    LOG_INFO(engine, "Enumerated physical devices.");
 }
 
 void engine::select_physical_device_()
@@ -556,17 +864,19 @@ void engine::select_physical_device_()
         {
             selected_physical_device_info_ = &physical_device_info;
 
-            SPDLOG_INFO("Selected device '{}'.", selected_physical_device_info_->properties.properties.deviceName.data());
+            LOG_INFO(engine, "Selected device '{}'.", selected_physical_device_info_->properties.properties.deviceName.data());
 
             graphics_queue_family_index_ = selected_physical_device_info_->graphics_family_queue_indices_[0];
-            present_queue_family_index_ = selected_physical_device_info_->present_family_queue_indices_[0];
 
-            SPDLOG_INFO("Selected queue family index {} for graphics.", graphics_queue_family_index_);
-            SPDLOG_INFO("Selected queue family index {} for presentation.", present_queue_family_index_);
+            // Headless nothing is presented, the present queue is the graphics queue.
+            present_queue_family_index_ = config_.headless ? graphics_queue_family_index_ : selected_physical_device_info_->present_family_queue_indices_[0];
+
+            LOG_INFO(engine, "Selected queue family index {} for graphics.", graphics_queue_family_index_);
+            LOG_INFO(engine, "Selected queue family index {} for presentation.", present_queue_family_index_);
         }
         else
         {
-            SPDLOG_WARN("The device '{}' was not considered suitable.", physical_device_info.properties.properties.deviceName.data());
+            LOG_WARN(engine, "The device '{}' was not considered suitable.", physical_device_info.properties.properties.deviceName.data());
         }
     }
 
@@ -576,132 +886,477 @@ void engine::select_physical_device_()
     }
 }
 
-void engine::create_device_()
+void engine::select_rendering_backend_()
 {
-    SPDLOG_INFO("Creating device...");
-
     const auto physical_device = selected_physical_device_info_->physical_device;
 
-    vk::StructureChain<vk::DeviceCreateInfo, vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures> chain{};
+    dynamic_rendering_ = false;
 
-    auto& create_info = chain.get<vk::DeviceCreateInfo>();
+    if (has_environment_variable("VKT_DISABLE_DYNAMIC_RENDERING"))
+    {
+        LOG_INFO(engine, "Dynamic rendering disabled (VKT_DISABLE_DYNAMIC_RENDERING is set), using render passes.");
 
-    chain.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>()
-        .setTimelineSemaphore(true);
+        return;
+    }
 
-    float queue_priority{ 1.0f };
+    const auto extensions = physical_device.enumerateDeviceExtensionProperties(nullptr, dispatch_);
 
-    std::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
-    std::set<uint32_t> unique_queue_families = { graphics_queue_family_index_, present_queue_family_index_ };
+    const bool extension_found = std::any_of(extensions.begin(), extensions.end(), [](const vk::ExtensionProperties& extension) {
+        return std::string_view(extension.extensionName.data()) == VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+    });
 
-    for (auto queue_family : unique_queue_families)
+    if (!extension_found)
     {
-        auto& queue_create_info = queue_create_infos.emplace_back();
+        LOG_INFO(engine, "Device does not support '{}', using render passes.", VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
 
-        queue_create_info
-            .setQueueFamilyIndex(queue_family)
-            .setQueueCount(1)
-            .setPQueuePriorities(&queue_priority);
+        return;
     }
-    
-    create_info
-        .setQueueCreateInfoCount(queue_create_infos.size())
-        .setPQueueCreateInfos(queue_create_infos.data())
-        .setPEnabledFeatures(nullptr)
-        .setEnabledExtensionCount(device_extensions_.size())
-        .setPpEnabledExtensionNames(device_extensions_.data())
-        .setEnabledLayerCount(layers_.size())
-        .setPpEnabledLayerNames(layers_.data());
 
-    const auto result = physical_device.createDevice(&create_info, nullptr, &device_, dispatch_);
+    const auto features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR>(dispatch_);
 
-    EVK_ASSERT_RESULT(result, "Failed to create device.");
+    if (!features.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering)
+    {
+        LOG_INFO(engine, "Device does not support the dynamic rendering feature, using render passes.");
 
-    SPDLOG_INFO("Creating device.");
-}
+        return;
+    }
 
-void engine::retrieve_queues_()
-{
-    SPDLOG_INFO("Retrieving queues...");
+    dynamic_rendering_ = true;
 
-    device_.getQueue(graphics_queue_family_index_, 0, &graphics_queue_, dispatch_);
-    device_.getQueue(present_queue_family_index_, 0, &present_queue_, dispatch_);
+    device_extensions_.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
 
-    SPDLOG_INFO("Retrieved queues.");
+    LOG_INFO(engine, "Using dynamic rendering.");
 }
 
-void engine::query_swapchain_support_()
+void engine::select_present_wait_()
 {
-    SPDLOG_INFO("Querying swapchain support...");
+    present_wait_ = false;
 
-    swapchain_info_.capabilities = selected_physical_device_info_->physical_device.getSurfaceCapabilities2KHR(surface_, dispatch_);
-    swapchain_info_.surface_formats = selected_physical_device_info_->physical_device.getSurfaceFormats2KHR(surface_, dispatch_);
-    swapchain_info_.present_modes = selected_physical_device_info_->physical_device.getSurfacePresentModesKHR(surface_, dispatch_);
+    // Also enabled without low latency mode, the input latency is measured until the present.
+    if (config_.headless)
+    {
+        return;
+    }
 
-    bool preferred_format_found{ false };
+    const auto physical_device = selected_physical_device_info_->physical_device;
 
-    for (const auto format : swapchain_info_.surface_formats)
-    {
-        if (format.surfaceFormat.format == PREFERRED_FORMAT && format.surfaceFormat.colorSpace == PREFERRED_COLOR_SPACE)
-        {
-            swapchain_info_.chosen_surface_format = format;
+    const auto extensions = physical_device.enumerateDeviceExtensionProperties(nullptr, dispatch_);
 
-            preferred_format_found = true;
+    auto has_extension = [&extensions](std::string_view name) {
+        return std::any_of(extensions.begin(), extensions.end(), [name](const vk::ExtensionProperties& extension) {
+            return std::string_view(extension.extensionName.data()) == name;
+        });
+    };
 
-            break;
-        }
-    }
+    bool supported = has_extension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && has_extension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
 
-    if (!preferred_format_found)
+    if (supported)
     {
-        throw_exception(fmt::format("Could not find format '{}' and color space '{}'.", vk::to_string(PREFERRED_FORMAT), vk::to_string(PREFERRED_COLOR_SPACE)));
-    }
-
-    SPDLOG_INFO("Format '{}' and color space '{}' chosen.", vk::to_string(swapchain_info_.chosen_surface_format.surfaceFormat.format).c_str(), vk::to_string(swapchain_info_.chosen_surface_format.surfaceFormat.colorSpace).c_str());
+        const auto features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR>(dispatch_);
 
-    bool preferred_present_mode_found{ false };
+        supported = features.get<vk::PhysicalDevicePresentIdFeaturesKHR>().presentId && features.get<vk::PhysicalDevicePresentWaitFeaturesKHR>().presentWait;
+    }
 
-    for (const auto present_mode : swapchain_info_.present_modes)
+    if (!supported)
     {
-        if (present_mode == PREFERRED_PRESENT_MODE)
+        if (low_latency_requested_)
         {
-            swapchain_info_.chosen_present_mode = present_mode;
+            LOG_WARN(engine, "Device does not support '{}' and '{}', low latency mode only paces by the frame timeline.",
+                VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        }
 
-            preferred_present_mode_found = true;
+        LOG_INFO(engine, "Input latency is measured until the GPU finished the frame.");
 
-            break;
-        }
+        return;
     }
 
-    if (!preferred_present_mode_found)
+    present_wait_ = true;
+
+    device_extensions_.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+    device_extensions_.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+    if (low_latency_requested_)
     {
-        throw_exception(fmt::format("Could not find present mode '{}'.", vk::to_string(PREFERRED_PRESENT_MODE)));
+        LOG_INFO(engine, "Low latency mode, waiting for the previous present before sampling input.");
     }
+}
 
-    SPDLOG_INFO("Present mode '{}' chosen.", vk::to_string(swapchain_info_.chosen_present_mode).c_str());
+void engine::select_dynamic_resolution_()
+{
+    const auto physical_device = selected_physical_device_info_->physical_device;
 
-    swapchain_info_.chosen_extent = swapchain_info_.capabilities.surfaceCapabilities.currentExtent;
+    // The kiosks run on integrated GPUs, holding the frame rate matters more than the resolution there.
+    bool enabled = preferred_physical_device_type_ == vk::PhysicalDeviceType::eIntegratedGpu;
 
-    SPDLOG_INFO("Extent chosen has width '{}' and height '{}'.", swapchain_info_.chosen_extent.width, swapchain_info_.chosen_extent.height);
+    const auto setting = get_environment_variable("VKT_DYNAMIC_RESOLUTION");
 
-    swapchain_info_.chosen_image_count = swapchain_info_.capabilities.surfaceCapabilities.minImageCount + PREFERRED_EXTRA_IMAGE_COUNT;
+    if (setting)
+    {
+        if (setting.value() == "on")
+        {
+            enabled = true;
+        }
+        else if (setting.value() == "off")
+        {
+            enabled = false;
+        }
+        else
+        {
+            throw_exception(fmt::format("Unknown VKT_DYNAMIC_RESOLUTION value: '{}'.", setting.value()));
+        }
+    }
 
-    if (swapchain_info_.capabilities.surfaceCapabilities.maxImageCount > 0 && swapchain_info_.chosen_image_count > swapchain_info_.capabilities.surfaceCapabilities.maxImageCount)
+    if (config_.dynamic_resolution)
     {
-        swapchain_info_.chosen_image_count = swapchain_info_.capabilities.surfaceCapabilities.maxImageCount;
+        enabled = config_.dynamic_resolution.value();
     }
 
-    SPDLOG_INFO("Chosen image count is '{}'.", swapchain_info_.chosen_image_count);
+    if (!enabled)
+    {
+        LOG_INFO(engine, "Dynamic resolution disabled.");
 
-    SPDLOG_INFO("Queried swapchain support.");
+        return;
+    }
+
+    if (!dynamic_rendering_)
+    {
+        LOG_WARN(engine, "Dynamic resolution needs the render graph (dynamic rendering), disabled.");
+
+        return;
+    }
+
+    if (selected_physical_device_info_->queue_families[graphics_queue_family_index_].queueFamilyProperties.timestampValidBits == 0)
+    {
+        LOG_WARN(engine, "The graphics queue has no timestamps, dynamic resolution disabled.");
+
+        return;
+    }
+
+    if (!(swapchain_info_.capabilities.surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst))
+    {
+        LOG_WARN(engine, "Swapchain images can't be blitted to, dynamic resolution disabled.");
+
+        return;
+    }
+
+    const auto format_properties = physical_device.getFormatProperties(swapchain_info_.chosen_surface_format.surfaceFormat.format, dispatch_);
+
+    const vk::FormatFeatureFlags blit_features = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst;
+
+    if ((format_properties.optimalTilingFeatures & blit_features) != blit_features)
+    {
+        LOG_WARN(engine, "Format '{}' can't be blitted, dynamic resolution disabled.", vk::to_string(swapchain_info_.chosen_surface_format.surfaceFormat.format));
+
+        return;
+    }
+
+    upscale_filter_ = (format_properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) ? vk::Filter::eLinear : vk::Filter::eNearest;
+
+    float budget_ms{ DEFAULT_FRAME_BUDGET_MS };
+
+    const auto budget_setting = get_environment_variable("VKT_FRAME_BUDGET_MS");
+
+    if (budget_setting)
+    {
+        char* end = nullptr;
+
+        budget_ms = std::strtof(budget_setting.value().c_str(), &end);
+
+        if (end == budget_setting.value().c_str() || *end != '\0' || budget_ms <= 0.0f)
+        {
+            throw_exception(fmt::format("Invalid VKT_FRAME_BUDGET_MS value: '{}'.", budget_setting.value()));
+        }
+    }
+
+    dynamic_resolution_ = std::make_unique<dynamic_resolution>(std::chrono::duration<float, std::milli>(budget_ms));
+
+    LOG_INFO(engine, "Dynamic resolution enabled, GPU frame budget is {:.2f} ms, upscaling with '{}' filter.", budget_ms, vk::to_string(upscale_filter_));
+}
+
+void engine::create_frame_capture_()
+{
+    const auto setting = get_environment_variable("VKT_CAPTURE");
+
+    if (!setting && config_.capture_frames.empty())
+    {
+        return;
+    }
+
+    if (setting)
+    {
+        if (!parse_unsigned(setting.value(), capture_interval_))
+        {
+            throw_exception(fmt::format("Invalid VKT_CAPTURE value: '{}'.", setting.value()));
+        }
+    }
+
+    auto file_format = frame_capture::file_format::qoi;
+
+    if (const auto format_setting = get_environment_variable("VKT_CAPTURE_FORMAT"))
+    {
+        if (format_setting.value() == "png")
+        {
+            file_format = frame_capture::file_format::png;
+        }
+        else if (format_setting.value() != "qoi")
+        {
+            throw_exception(fmt::format("Unknown VKT_CAPTURE_FORMAT value: '{}'.", format_setting.value()));
+        }
+    }
+
+    const auto directory = config_.capture_directory.value_or(get_environment_variable("VKT_CAPTURE_DIR").value_or(CAPTURE_DIRECTORY));
+
+    if (!dynamic_rendering_)
+    {
+        LOG_WARN(engine, "Frame capture needs the render graph (dynamic rendering), disabled.");
+
+        return;
+    }
+
+    if (!(swapchain_info_.capabilities.surfaceCapabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc))
+    {
+        LOG_WARN(engine, "Swapchain images can't be copied from, frame capture disabled.");
+
+        return;
+    }
+
+    if (!frame_capture::supports(swapchain_info_.chosen_surface_format.surfaceFormat.format))
+    {
+        LOG_WARN(engine, "Format '{}' can't be captured, frame capture disabled.", vk::to_string(swapchain_info_.chosen_surface_format.surfaceFormat.format));
+
+        return;
+    }
+
+    LOG_INFO(engine, "Creating frame capture...");
+
+    frame_capture_ = std::make_unique<frame_capture>(device_, selected_physical_device_info_->physical_device, dispatch_, directory, file_format, config_.capture_callback);
+
+    if (!config_.capture_frames.empty())
+    {
+        LOG_INFO(engine, "Created frame capture to '{}', capturing {} scheduled frame(s).", directory, config_.capture_frames.size());
+    }
+    else if (capture_interval_ == 0)
+    {
+        LOG_INFO(engine, "Created frame capture to '{}', frames are captured on request (F12).", directory);
+    }
+    else
+    {
+        LOG_INFO(engine, "Created frame capture to '{}', capturing every {} frame(s).", directory, capture_interval_);
+    }
+}
+
+void engine::create_device_()
+{
+    LOG_INFO(engine, "Creating device...");
+
+    const auto physical_device = selected_physical_device_info_->physical_device;
+
+    select_rendering_backend_();
+
+    if (config_.headless && !dynamic_rendering_)
+    {
+        throw_exception("Headless rendering needs the render graph (dynamic rendering).");
+    }
+
+    select_present_wait_();
+
+    vk::StructureChain<vk::DeviceCreateInfo, vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures, vk::PhysicalDeviceDynamicRenderingFeaturesKHR,
+        vk::PhysicalDevicePresentIdFeaturesKHR, vk::PhysicalDevicePresentWaitFeaturesKHR> chain{};
+
+    auto& create_info = chain.get<vk::DeviceCreateInfo>();
+
+    chain.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>()
+        .setTimelineSemaphore(true);
+
+    if (dynamic_rendering_)
+    {
+        chain.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>()
+            .setDynamicRendering(true);
+    }
+    else
+    {
+        chain.unlink<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>();
+    }
+
+    if (present_wait_)
+    {
+        chain.get<vk::PhysicalDevicePresentIdFeaturesKHR>()
+            .setPresentId(true);
+        chain.get<vk::PhysicalDevicePresentWaitFeaturesKHR>()
+            .setPresentWait(true);
+    }
+    else
+    {
+        chain.unlink<vk::PhysicalDevicePresentIdFeaturesKHR>();
+        chain.unlink<vk::PhysicalDevicePresentWaitFeaturesKHR>();
+    }
+
+    float queue_priority{ 1.0f };
+
+    std::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
+    std::set<uint32_t> unique_queue_families = { graphics_queue_family_index_, present_queue_family_index_ };
+
+    for (auto queue_family : unique_queue_families)
+    {
+        auto& queue_create_info = queue_create_infos.emplace_back();
+
+        queue_create_info
+            .setQueueFamilyIndex(queue_family)
+            .setQueueCount(1)
+            .setPQueuePriorities(&queue_priority);
+    }
+    
+    create_info
+        .setQueueCreateInfoCount(queue_create_infos.size())
+        .setPQueueCreateInfos(queue_create_infos.data())
+        .setPEnabledFeatures(nullptr)
+        .setEnabledExtensionCount(device_extensions_.size())
+        .setPpEnabledExtensionNames(device_extensions_.data())
+        .setEnabledLayerCount(layers_.size())
+        .setPpEnabledLayerNames(layers_.data());
+
+    const auto result = physical_device.createDevice(&create_info, nullptr, &device_, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create device.");
+
+    // Device level entry points, the extension commands (vkCmdBeginRenderingKHR) aren't there otherwise.
+    dispatch_.init(device_);
+
+    LOG_INFO(engine, "Creating device.");
+}
+
+void engine::retrieve_queues_()
+{
+    LOG_INFO(engine, "Retrieving queues...");
+
+    device_.getQueue(graphics_queue_family_index_, 0, &graphics_queue_, dispatch_);
+    device_.getQueue(present_queue_family_index_, 0, &present_queue_, dispatch_);
+
+    LOG_INFO(engine, "Retrieved queues.");
+}
+
+void engine::query_swapchain_support_()
+{
+    if (config_.headless)
+    {
+        // The offscreen images are created with everything the dynamic resolution and the frame capture check for.
+        swapchain_info_.capabilities.surfaceCapabilities.supportedUsageFlags =
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst;
+        swapchain_info_.chosen_surface_format.surfaceFormat = vk::SurfaceFormatKHR{ PREFERRED_FORMAT, PREFERRED_COLOR_SPACE };
+        swapchain_info_.chosen_extent = config_.headless_extent;
+        swapchain_info_.chosen_image_count = static_cast<std::uint32_t>(MAXIMUM_FRAMES_IN_FLIGHT);
+
+        return;
+    }
+
+    LOG_INFO(engine, "Querying swapchain support...");
+
+    swapchain_info_.capabilities = selected_physical_device_info_->physical_device.getSurfaceCapabilities2KHR(surface_, dispatch_);
+    swapchain_info_.surface_formats = selected_physical_device_info_->physical_device.getSurfaceFormats2KHR(surface_, dispatch_);
+    swapchain_info_.present_modes = selected_physical_device_info_->physical_device.getSurfacePresentModesKHR(surface_, dispatch_);
+
+    bool preferred_format_found{ false };
+
+    for (const auto format : swapchain_info_.surface_formats)
+    {
+        if (format.surfaceFormat.format == PREFERRED_FORMAT && format.surfaceFormat.colorSpace == PREFERRED_COLOR_SPACE)
+        {
+            swapchain_info_.chosen_surface_format = format;
+
+            preferred_format_found = true;
+
+            break;
+        }
+    }
+
+    if (!preferred_format_found)
+    {
+        throw_exception(fmt::format("Could not find format '{}' and color space '{}'.", vk::to_string(PREFERRED_FORMAT), vk::to_string(PREFERRED_COLOR_SPACE)));
+    }
+
+    LOG_INFO(engine, "Format '{}' and color space '{}' chosen.", vk::to_string(swapchain_info_.chosen_surface_format.surfaceFormat.format).c_str(), vk::to_string(swapchain_info_.chosen_surface_format.surfaceFormat.colorSpace).c_str());
+
+    choose_present_mode_();
+
+    swapchain_info_.chosen_extent = swapchain_info_.capabilities.surfaceCapabilities.currentExtent;
+
+    LOG_INFO(engine, "Extent chosen has width '{}' and height '{}'.", swapchain_info_.chosen_extent.width, swapchain_info_.chosen_extent.height);
+
+    swapchain_info_.chosen_image_count = swapchain_info_.capabilities.surfaceCapabilities.minImageCount + PREFERRED_EXTRA_IMAGE_COUNT;
+
+    if (swapchain_info_.capabilities.surfaceCapabilities.maxImageCount > 0 && swapchain_info_.chosen_image_count > swapchain_info_.capabilities.surfaceCapabilities.maxImageCount)
+    {
+        swapchain_info_.chosen_image_count = swapchain_info_.capabilities.surfaceCapabilities.maxImageCount;
+    }
+
+    LOG_INFO(engine, "Chosen image count is '{}'.", swapchain_info_.chosen_image_count);
+
+    LOG_INFO(engine, "Queried swapchain support.");
+}
+
+void engine::choose_present_mode_()
+{
+    // Without the requested mode: the closest one that doesn't tear more, FIFO is always there.
+    std::vector<vk::PresentModeKHR> candidates{ requested_present_mode_ };
+
+    switch (requested_present_mode_)
+    {
+    case vk::PresentModeKHR::eImmediate:
+        candidates.insert(candidates.end(), { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eFifo });
+        break;
+    case vk::PresentModeKHR::eMailbox:
+    case vk::PresentModeKHR::eFifoRelaxed:
+        candidates.push_back(vk::PresentModeKHR::eFifo);
+        break;
+    default:
+        break;
+    }
+
+    for (const auto candidate : candidates)
+    {
+        if (std::find(swapchain_info_.present_modes.begin(), swapchain_info_.present_modes.end(), candidate) == swapchain_info_.present_modes.end())
+        {
+            continue;
+        }
+
+        if (candidate != requested_present_mode_)
+        {
+            LOG_WARN(engine, "Present mode '{}' is not supported, falling back to '{}'.", vk::to_string(requested_present_mode_), vk::to_string(candidate));
+        }
+
+        swapchain_info_.chosen_present_mode = candidate;
+
+        LOG_INFO(engine, "Present mode '{}' chosen.", vk::to_string(swapchain_info_.chosen_present_mode).c_str());
+
+        return;
+    }
+
+    throw_exception(fmt::format("Could not find present mode '{}' or a fallback.", vk::to_string(requested_present_mode_)));
 }
 
 void engine::create_swapchain_()
 {
-    SPDLOG_INFO("Creating swapchain...");
+    if (config_.headless)
+    {
+        return;
+    }
+
+    LOG_INFO(engine, "Creating swapchain...");
 
     vk::SwapchainKHR old_swapchain = swapchain_;
 
+    vk::ImageUsageFlags swapchain_usage{ vk::ImageUsageFlagBits::eColorAttachment };
+
+    if (dynamic_resolution_)
+    {
+        swapchain_usage |= vk::ImageUsageFlagBits::eTransferDst;
+    }
+
+    if (frame_capture_)
+    {
+        swapchain_usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+
     vk::SwapchainCreateInfoKHR create_info{};
 
     create_info
@@ -711,7 +1366,7 @@ void engine::create_swapchain_()
         .setImageColorSpace(swapchain_info_.chosen_surface_format.surfaceFormat.colorSpace)
         .setImageExtent(swapchain_info_.chosen_extent)
         .setImageArrayLayers(1)
-        .setImageUsage(vk::ImageUsageFlagBits::eColorAttachment)
+        .setImageUsage(swapchain_usage)
         .setImageSharingMode(vk::SharingMode::eExclusive)
         .setPreTransform(swapchain_info_.capabilities.surfaceCapabilities.currentTransform)
         .setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
@@ -736,12 +1391,22 @@ void engine::create_swapchain_()
 
     EVK_ASSERT_RESULT(result, "Failed to create swapchain.");
 
-    SPDLOG_INFO("Created swapchain.");
+    // Retired by the new one, its images may still be used by the frames in flight.
+    deletion_queue_.push(last_timeline_value_, device_, old_swapchain, dispatch_);
+
+    LOG_INFO(engine, "Created swapchain.");
 }
 
 void engine::retrieve_swapchain_images_()
 {
-    SPDLOG_INFO("Retrieving swapchain images...");
+    if (config_.headless)
+    {
+        create_offscreen_images_();
+
+        return;
+    }
+
+    LOG_INFO(engine, "Retrieving swapchain images...");
 
     const auto images = device_.getSwapchainImagesKHR(swapchain_, dispatch_);
 
@@ -773,15 +1438,105 @@ void engine::retrieve_swapchain_images_()
 
         auto result = device_.createImageView(&create_info, nullptr, &new_swapchain_image.image_view, dispatch_);
 
-        EVK_ASSERT_RESULT(result, "Failed to create swapchain image view.");
+        EVK_ASSERT_RESULT(result, "Failed to create swapchain image view.");
+    }
+
+    LOG_INFO(engine, "Retrieved swapchain images.");
+}
+
+void engine::create_offscreen_images_()
+{
+    LOG_INFO(engine, "Creating {} offscreen image(s)...", swapchain_info_.chosen_image_count);
+
+    const auto memory_properties = selected_physical_device_info_->physical_device.getMemoryProperties(dispatch_);
+
+    for (std::uint32_t index = 0; index < swapchain_info_.chosen_image_count; ++index)
+    {
+        auto& new_swapchain_image = swapchain_images_.emplace_back();
+
+        vk::ImageCreateInfo image_create_info{};
+
+        image_create_info
+            .setImageType(vk::ImageType::e2D)
+            .setFormat(swapchain_info_.chosen_surface_format.surfaceFormat.format)
+            .setExtent(vk::Extent3D{ swapchain_info_.chosen_extent.width, swapchain_info_.chosen_extent.height, 1 })
+            .setMipLevels(1)
+            .setArrayLayers(1)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setUsage(swapchain_info_.capabilities.surfaceCapabilities.supportedUsageFlags)
+            .setSharingMode(vk::SharingMode::eExclusive)
+            .setInitialLayout(vk::ImageLayout::eUndefined);
+
+        auto result = device_.createImage(&image_create_info, nullptr, &new_swapchain_image.image, dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to create offscreen image.");
+
+        const auto requirements = device_.getImageMemoryRequirements(new_swapchain_image.image, dispatch_);
+
+        // Device local when there is such a type, software implementations may only have host memory.
+        const vk::MemoryPropertyFlags preferred[] = { vk::MemoryPropertyFlagBits::eDeviceLocal, vk::MemoryPropertyFlags{} };
+
+        auto memory_type = std::numeric_limits<std::uint32_t>::max();
+
+        for (const auto properties : preferred)
+        {
+            for (std::uint32_t type = 0; type < memory_properties.memoryTypeCount && memory_type == std::numeric_limits<std::uint32_t>::max(); ++type)
+            {
+                if ((requirements.memoryTypeBits & (1u << type)) && (memory_properties.memoryTypes[type].propertyFlags & properties) == properties)
+                {
+                    memory_type = type;
+                }
+            }
+        }
+
+        if (memory_type == std::numeric_limits<std::uint32_t>::max())
+        {
+            throw_exception("No memory type for the offscreen images.");
+        }
+
+        vk::MemoryAllocateInfo allocate_info{};
+
+        allocate_info
+            .setAllocationSize(requirements.size)
+            .setMemoryTypeIndex(memory_type);
+
+        result = device_.allocateMemory(&allocate_info, nullptr, &new_swapchain_image.memory, dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to allocate offscreen image memory.");
+
+        device_.bindImageMemory(new_swapchain_image.image, new_swapchain_image.memory, 0, dispatch_);
+
+        vk::ImageViewCreateInfo create_info{};
+
+        create_info
+            .setImage(new_swapchain_image.image)
+            .setViewType(vk::ImageViewType::e2D)
+            .setFormat(swapchain_info_.chosen_surface_format.surfaceFormat.format);
+
+        create_info.subresourceRange
+            .setAspectMask(vk::ImageAspectFlagBits::eColor)
+            .setBaseMipLevel(0)
+            .setLevelCount(1)
+            .setBaseArrayLayer(0)
+            .setLayerCount(1);
+
+        result = device_.createImageView(&create_info, nullptr, &new_swapchain_image.image_view, dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to create offscreen image view.");
     }
 
-    SPDLOG_INFO("Retrieved swapchain images.");
+    LOG_INFO(engine, "Created offscreen images.");
 }
 
 void engine::create_render_pass_()
 {
-    SPDLOG_INFO("Creating render pass...");
+    if (dynamic_rendering_)
+    {
+        return;
+    }
+
+    LOG_INFO(engine, "Creating render pass...");
 
     vk::AttachmentDescription color_attachment{};
 
@@ -830,29 +1585,29 @@ void engine::create_render_pass_()
 
     EVK_ASSERT_RESULT(result, "Failed to create render pass.");
 
-    SPDLOG_INFO("Created render pass.");
+    LOG_INFO(engine, "Created render pass.");
 }
 
 void engine::create_graphics_pipeline_()
 {
-    SPDLOG_INFO("Creating graphics pipeline...");
+    LOG_INFO(engine, "Creating graphics pipeline...");
 
-    SPDLOG_INFO("Reading SPIRV files...");
+    LOG_INFO(engine, "Reading SPIRV files...");
 
     const auto vert_shader_code = read_file(VERT_SHADER_FILENAME);
     const auto frag_shader_code = read_file(FRAG_SHADER_FILENAME);
 
-    SPDLOG_INFO("Vertex shader binary size is {} bytes.", vert_shader_code.size());
-    SPDLOG_INFO("Fragment shader binary size is {} bytes.", frag_shader_code.size());
+    LOG_INFO(engine, "Vertex shader binary size is {} bytes.", vert_shader_code.size());
+    LOG_INFO(engine, "Fragment shader binary size is {} bytes.", frag_shader_code.size());
 
-    SPDLOG_INFO("Read SPIRV files.");
+    LOG_INFO(engine, "Read SPIRV files.");
 
-    SPDLOG_INFO("Creating shader modules...");
+    LOG_INFO(engine, "Creating shader modules...");
 
     const auto vert_shader_module = create_shader_module_(VERT_SHADER_FILENAME, vert_shader_code);
     const auto frag_shader_module = create_shader_module_(FRAG_SHADER_FILENAME, frag_shader_code);
 
-    SPDLOG_INFO("Creating shader modules.");
+    LOG_INFO(engine, "Creating shader modules.");
 
     vk::PipelineShaderStageCreateInfo vert_create_info{};
 
@@ -877,29 +1632,20 @@ void engine::create_graphics_pipeline_()
     pipeline_input_assembly_state_create_info
         .setTopology(vk::PrimitiveTopology::eTriangleList);
 
-    vk::Viewport viewport{};
-
-    viewport
-        .setX(0.0f)
-        .setY(0.0f)
-        .setWidth(swapchain_info_.chosen_extent.width)
-        .setHeight(swapchain_info_.chosen_extent.height)
-        .setMinDepth(0.0f)
-        .setMaxDepth(1.0f);
-
-    vk::Rect2D scissor{};
-
-    scissor
-        .setOffset(vk::Offset2D{ 0, 0 })
-        .setExtent(swapchain_info_.chosen_extent);
-
+    // Viewport and scissor are set when recording, so the pipeline survives swapchain resizes.
     vk::PipelineViewportStateCreateInfo pipeline_viewport_state_create_info{};
 
     pipeline_viewport_state_create_info
         .setScissorCount(1)
-        .setPScissors(&scissor)
-        .setViewportCount(1)
-        .setPViewports(&viewport);
+        .setViewportCount(1);
+
+    const vk::DynamicState dynamic_states[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+
+    vk::PipelineDynamicStateCreateInfo pipeline_dynamic_state_create_info{};
+
+    pipeline_dynamic_state_create_info
+        .setDynamicStateCount(2)
+        .setPDynamicStates(dynamic_states);
 
     vk::PipelineRasterizationStateCreateInfo pipeline_rasterization_state_create_info{};
 
@@ -919,297 +1665,712 @@ void engine::create_graphics_pipeline_()
 
     vk::PipelineColorBlendAttachmentState pipeline_color_blend_attachment_state{};
 
-    pipeline_color_blend_attachment_state
-        .setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
-        .setBlendEnable(false);
+    pipeline_color_blend_attachment_state
+        .setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
+        .setBlendEnable(false);
+
+    vk::PipelineColorBlendStateCreateInfo pipeline_color_blend_state_create_info{};
+
+    pipeline_color_blend_state_create_info
+        .setLogicOpEnable(false)
+        .setAttachmentCount(1)
+        .setPAttachments(&pipeline_color_blend_attachment_state);
+
+    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{};
+
+    auto result = device_.createPipelineLayout(&pipeline_layout_create_info, nullptr, &pipeline_layout_, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create pipeline layout.");
+
+    vk::StructureChain<vk::GraphicsPipelineCreateInfo, vk::PipelineRenderingCreateInfoKHR> chain{};
+
+    auto& create_info = chain.get<vk::GraphicsPipelineCreateInfo>();
+
+    create_info
+        .setStageCount(2)
+        .setPStages(shader_stages)
+        .setPInputAssemblyState(&pipeline_input_assembly_state_create_info)
+        .setPVertexInputState(&pipeline_vertex_input_state_create_info)
+        .setPViewportState(&pipeline_viewport_state_create_info)
+        .setPRasterizationState(&pipeline_rasterization_state_create_info)
+        .setPMultisampleState(&pipeline_multisample_state_create_info)
+        .setPColorBlendState(&pipeline_color_blend_state_create_info)
+        .setPDynamicState(&pipeline_dynamic_state_create_info)
+        .setLayout(pipeline_layout_);
+
+    const auto color_format = swapchain_info_.chosen_surface_format.surfaceFormat.format;
+
+    if (dynamic_rendering_)
+    {
+        // Only the attachment formats have to match, any attachment of that format can be rendered to.
+        chain.get<vk::PipelineRenderingCreateInfoKHR>()
+            .setColorAttachmentCount(1)
+            .setPColorAttachmentFormats(&color_format);
+    }
+    else
+    {
+        chain.unlink<vk::PipelineRenderingCreateInfoKHR>();
+
+        create_info.setRenderPass(render_pass_);
+    }
+
+    result = device_.createGraphicsPipelines(nullptr, 1, &create_info, nullptr, &graphics_pipeline_, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create graphics pipeline.");
+
+    LOG_INFO(engine, "Created graphics pipeline.");
+
+    LOG_INFO(engine, "Destroying shader modules...");
+
+    device_.destroyShaderModule(vert_shader_module, nullptr, dispatch_);
+    device_.destroyShaderModule(frag_shader_module, nullptr, dispatch_);
+
+    LOG_INFO(engine, "Destroyed shader modules.");
+}
+
+vk::ShaderModule engine::create_shader_module_(const std::string& name, const std::vector<char>& binary)
+{
+    LOG_INFO(engine, "Creating shader module for '{}'...", name.c_str());
+
+    vk::ShaderModuleCreateInfo create_info{};
+
+    create_info
+        .setPCode(reinterpret_cast<const std::uint32_t*>(binary.data()))
+        .setCodeSize(binary.size());
+
+    vk::ShaderModule shader_module;
+
+    const auto result = device_.createShaderModule(&create_info, nullptr, &shader_module, dispatch_);
+
+    EVK_ASSERT_RESULT(result, fmt::format("Failed to create shader module for '{}'.", name));
+
+    LOG_INFO(engine, "Created shader module for '{}'.", name.c_str());
+
+    return shader_module;
+}
+
+void engine::create_framebuffers_()
+{
+    if (dynamic_rendering_)
+    {
+        return;
+    }
+
+    LOG_INFO(engine, "Creating framebuffers...");
+
+    for (auto& swapchain_image : swapchain_images_)
+    {
+        vk::FramebufferCreateInfo create_info{};
+
+        create_info
+            .setRenderPass(render_pass_)
+            .setAttachmentCount(1)
+            .setPAttachments(&swapchain_image.image_view)
+            .setWidth(swapchain_info_.chosen_extent.width)
+            .setHeight(swapchain_info_.chosen_extent.height)
+            .setLayers(1);
+
+        const auto result = device_.createFramebuffer(&create_info, nullptr, &swapchain_image.framebuffer, dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to create framebuffer.");
+    }
+
+    LOG_INFO(engine, "Creating framebuffers.");
+}
+
+void engine::create_command_pools_()
+{
+    LOG_INFO(engine, "Creating command pools...");
+
+    for (auto& swapchain_image : swapchain_images_)
+    {
+        vk::CommandPoolCreateInfo create_info{};
+
+        create_info
+            .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+            .setQueueFamilyIndex(graphics_queue_family_index_);
+
+        const auto result = device_.createCommandPool(&create_info, nullptr, &swapchain_image.command_pool, dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to create command pool.");
+    }
+
+    LOG_INFO(engine, "Created command pools.");
+}
+
+void engine::create_frame_timeline_()
+{
+    LOG_INFO(engine, "Creating frame timeline semaphore...");
+
+    reset_timeline_semaphore_(frame_timeline_, last_timeline_value_);
+
+    LOG_INFO(engine, "Created frame timeline semaphore.");
+}
+
+void engine::create_gpu_completion_()
+{
+    LOG_INFO(engine, "Starting GPU completion waiter...");
+
+    gpu_completion_ = std::make_unique<gpu_completion>(device_, dispatch_, frame_timeline_, std::chrono::milliseconds(TOTAL_TIME_ABORT_LEVEL_MS),
+        [this](std::uint64_t value, std::chrono::milliseconds stalled) { this->on_gpu_hang_(value, stalled); });
+
+    LOG_INFO(engine, "Started GPU completion waiter.");
+}
+
+void engine::create_render_graph_()
+{
+    if (!dynamic_rendering_)
+    {
+        return;
+    }
+
+    LOG_INFO(engine, "Creating render graph...");
+
+    render_graph_ = std::make_unique<render_graph>(device_, selected_physical_device_info_->physical_device, dispatch_, deletion_queue_, dynamic_rendering_);
+
+    LOG_INFO(engine, "Created render graph.");
+}
+
+void engine::create_timestamp_queries_()
+{
+    const auto valid_bits = selected_physical_device_info_->queue_families[graphics_queue_family_index_].queueFamilyProperties.timestampValidBits;
+
+    if (valid_bits == 0)
+    {
+        LOG_INFO(engine, "The graphics queue has no timestamps, GPU frame times are not measured.");
+
+        return;
+    }
+
+    LOG_INFO(engine, "Creating timestamp queries...");
+
+    timestamp_period_ns_ = selected_physical_device_info_->properties.properties.limits.timestampPeriod;
+    timestamp_mask_ = valid_bits >= 64 ? std::numeric_limits<std::uint64_t>::max() : (std::uint64_t{ 1 } << valid_bits) - 1;
+
+    vk::QueryPoolCreateInfo create_info{};
+
+    create_info
+        .setQueryType(vk::QueryType::eTimestamp)
+        .setQueryCount(TIMESTAMP_QUERY_FRAMES * 2);
+
+    const auto result = device_.createQueryPool(&create_info, nullptr, &timestamp_query_pool_, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create timestamp query pool.");
+
+    // Submitted frames don't have timestamps yet.
+    timestamps_read_ = last_timeline_value_;
+
+    LOG_INFO(engine, "Created timestamp queries.");
+}
+
+std::uint64_t engine::completed_timeline_value_()
+{
+    std::uint64_t value{ 0 };
+
+    const auto result = device_.getSemaphoreCounterValue(frame_timeline_, &value, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to get frame timeline semaphore value.");
+
+    return value;
+}
+
+std::uint32_t engine::timestamp_query_(std::uint64_t timeline_value) const
+{
+    return static_cast<std::uint32_t>(timeline_value % TIMESTAMP_QUERY_FRAMES) * 2;
+}
+
+void engine::read_timestamps_(std::uint64_t completed)
+{
+    if (!timestamp_query_pool_ || completed <= timestamps_read_)
+    {
+        return;
+    }
+
+    // The queries of older frames were reused by newer ones already.
+    auto first = std::max(timestamps_read_ + 1, completed >= TIMESTAMP_QUERY_FRAMES ? completed - TIMESTAMP_QUERY_FRAMES + 1 : 1);
+
+    for (auto timeline_value = first; timeline_value <= completed; ++timeline_value)
+    {
+        std::uint64_t timestamps[2]{};
+
+        const auto result = device_.getQueryPoolResults(timestamp_query_pool_, timestamp_query_(timeline_value), 2, sizeof(timestamps), timestamps,
+            sizeof(std::uint64_t), vk::QueryResultFlagBits::e64, dispatch_);
+
+        if (result != vk::Result::eSuccess)
+        {
+            continue;
+        }
+
+        const auto ticks = (timestamps[1] - timestamps[0]) & timestamp_mask_;
+
+        last_gpu_frame_time_ = std::chrono::duration<float, std::milli>(static_cast<float>(ticks) * timestamp_period_ns_ / 1000000.0f);
+
+        if (dynamic_resolution_)
+        {
+            dynamic_resolution_->add_frame_time(last_gpu_frame_time_);
+        }
+    }
+
+    timestamps_read_ = completed;
+}
+
+void engine::reset_timeline_semaphore_(vk::Semaphore& timeline_semaphore, std::uint64_t initial_value)
+{
+    if (timeline_semaphore != static_cast<vk::Semaphore>(nullptr))
+    {
+        device_.destroySemaphore(timeline_semaphore, nullptr, dispatch_);
+
+        timeline_semaphore = nullptr;
+    }
+
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> chain{};
+
+    chain.get<vk::SemaphoreTypeCreateInfo>()
+        .setSemaphoreType(vk::SemaphoreType::eTimeline)
+        .setInitialValue(initial_value);
+
+    const auto result = device_.createSemaphore(&chain.get<vk::SemaphoreCreateInfo>(), nullptr, &timeline_semaphore, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create timeline semaphore.");
+}
+
+void engine::record_command_buffer_(frame_in_flight& p_frame_in_flight)
+{
+    const auto& swapchain_image = swapchain_images_[p_frame_in_flight.swapchain_image_index];
+
+    const auto& cmd_buffer = p_frame_in_flight.command_buffer;
+
+    vk::CommandBufferBeginInfo begin_info{};
+
+    cmd_buffer.begin(begin_info, dispatch_);
+
+    // draw_frame_() gives the submission the next timeline value.
+    const auto query = timestamp_query_(last_timeline_value_ + 1);
+
+    if (timestamp_query_pool_)
+    {
+        cmd_buffer.resetQueryPool(timestamp_query_pool_, query, 2, dispatch_);
+
+        // At the stage the acquire semaphore is waited on, so the wait for the presentation engine
+        // (long under FIFO) isn't counted as GPU time and doesn't lower the resolution scale.
+        cmd_buffer.writeTimestamp(vk::PipelineStageFlagBits::eColorAttachmentOutput, timestamp_query_pool_, query, dispatch_);
+    }
+
+    if (dynamic_rendering_)
+    {
+        build_render_graph_(swapchain_image);
+
+        render_graph_->execute(cmd_buffer);
+    }
+    else
+    {
+        vk::ClearValue clear_color{};
+
+        clear_color.color.setFloat32({ 0.0f, 0.0f, 0.0f, 1.0f });
+
+        vk::Rect2D render_area{};
+
+        render_area
+            .setOffset(vk::Offset2D{ 0, 0 })
+            .setExtent(swapchain_info_.chosen_extent);
+
+        vk::RenderPassBeginInfo render_pass_begin_info{};
+
+        render_pass_begin_info
+            .setRenderPass(render_pass_)
+            .setFramebuffer(swapchain_image.framebuffer)
+            .setRenderArea(render_area)
+            .setClearValueCount(1)
+            .setClearValues(clear_color);
+
+        cmd_buffer.beginRenderPass(render_pass_begin_info, vk::SubpassContents::eInline, dispatch_);
+
+        draw_triangle_(cmd_buffer, render_area);
+
+        cmd_buffer.endRenderPass(dispatch_);
+    }
+
+    if (timestamp_query_pool_)
+    {
+        cmd_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestamp_query_pool_, query + 1, dispatch_);
+    }
+
+    cmd_buffer.end(dispatch_);
+}
+
+void engine::build_render_graph_(const swapchain_image& p_swapchain_image)
+{
+    render_graph_->reset();
+
+    render_graph::image_desc backbuffer_desc{};
+
+    backbuffer_desc.format = swapchain_info_.chosen_surface_format.surfaceFormat.format;
+    backbuffer_desc.extent = swapchain_info_.chosen_extent;
+
+    // The acquire semaphore is waited on at color attachment output, the old contents are discarded.
+    // Presenting is ordered by the render finished semaphore, only the layout has to be right.
+    // Nothing reads the offscreen images of headless runs afterwards, they stay where the frame left them.
+    const auto final_layout = config_.headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+
+    const auto backbuffer = render_graph_->import_image("backbuffer", p_swapchain_image.image, p_swapchain_image.image_view, backbuffer_desc,
+        render_graph::external_state{ vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlags{}, vk::ImageLayout::eUndefined },
+        render_graph::external_state{ vk::PipelineStageFlagBits::eBottomOfPipe, vk::AccessFlags{}, final_layout });
 
-    vk::PipelineColorBlendStateCreateInfo pipeline_color_blend_state_create_info{};
+    vk::ClearColorValue clear_color{};
 
-    pipeline_color_blend_state_create_info
-        .setLogicOpEnable(false)
-        .setAttachmentCount(1)
-        .setPAttachments(&pipeline_color_blend_attachment_state);
+    clear_color.setFloat32({ 0.0f, 0.0f, 0.0f, 1.0f });
 
-    vk::PipelineLayoutCreateInfo pipeline_layout_create_info{};
+    auto draw = [this](const render_graph::pass_context& context) { draw_triangle_(context.cmd_buffer, context.render_area); };
 
-    auto result = device_.createPipelineLayout(&pipeline_layout_create_info, nullptr, &pipeline_layout_, dispatch_);
+    if (!dynamic_resolution_)
+    {
+        render_graph_->add_pass("triangle", draw)
+            .color_attachment(backbuffer, clear_color);
+    }
+    else
+    {
+        // The scene image has the full extent so scale changes don't recreate it, only the top left
+        // corner is rendered to and blitted.
+        const auto full_extent = swapchain_info_.chosen_extent;
+        const auto scaled_extent = dynamic_resolution_->scaled_extent(full_extent);
 
-    EVK_ASSERT_RESULT(result, "Failed to create pipeline layout.");
+        render_graph::image_desc scene_desc{};
 
-    vk::GraphicsPipelineCreateInfo create_info{};
+        scene_desc.format = backbuffer_desc.format;
+        scene_desc.extent = full_extent;
 
-    create_info
-        .setStageCount(2)
-        .setPStages(shader_stages)
-        .setPInputAssemblyState(&pipeline_input_assembly_state_create_info)
-        .setPVertexInputState(&pipeline_vertex_input_state_create_info)
-        .setPViewportState(&pipeline_viewport_state_create_info)
-        .setPRasterizationState(&pipeline_rasterization_state_create_info)
-        .setPMultisampleState(&pipeline_multisample_state_create_info)
-        .setPColorBlendState(&pipeline_color_blend_state_create_info)
-        .setLayout(pipeline_layout_)
-        .setRenderPass(render_pass_);
+        const auto scene = render_graph_->create_image("scene", scene_desc);
 
-    result = device_.createGraphicsPipelines(nullptr, 1, &create_info, nullptr, &graphics_pipeline_, dispatch_);
+        render_graph_->add_pass("triangle", draw)
+            .color_attachment(scene, clear_color)
+            .render_area(vk::Rect2D{ vk::Offset2D{ 0, 0 }, scaled_extent });
 
-    EVK_ASSERT_RESULT(result, "Failed to create graphics pipeline.");
+        render_graph_->add_pass("upscale", [this, scene, backbuffer, scaled_extent, full_extent](const render_graph::pass_context& context) {
+            vk::ImageBlit region{};
 
-    SPDLOG_INFO("Created graphics pipeline.");
+            region.srcSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+            region.srcOffsets[1] = vk::Offset3D{ static_cast<std::int32_t>(scaled_extent.width), static_cast<std::int32_t>(scaled_extent.height), 1 };
+            region.dstSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+            region.dstOffsets[1] = vk::Offset3D{ static_cast<std::int32_t>(full_extent.width), static_cast<std::int32_t>(full_extent.height), 1 };
 
-    SPDLOG_INFO("Destroying shader modules...");
+            context.cmd_buffer.blitImage(context.graph.image(scene), vk::ImageLayout::eTransferSrcOptimal, context.graph.image(backbuffer), vk::ImageLayout::eTransferDstOptimal,
+                1, &region, upscale_filter_, dispatch_);
+        })
+            .read(scene, render_graph::usage::transfer_src)
+            .write(backbuffer, render_graph::usage::transfer_dst);
+    }
 
-    device_.destroyShaderModule(vert_shader_module, nullptr, dispatch_);
-    device_.destroyShaderModule(frag_shader_module, nullptr, dispatch_);
+    if (frame_capture_)
+    {
+        add_capture_pass_(backbuffer);
+    }
 
-    SPDLOG_INFO("Destroyed shader modules.");
+    render_graph_->compile(last_timeline_value_);
 }
 
-vk::ShaderModule engine::create_shader_module_(const std::string& name, const std::vector<char>& binary)
+void engine::add_capture_pass_(render_graph::resource backbuffer)
 {
-    SPDLOG_INFO("Creating shader module for '{}'...", name.c_str());
+    bool scheduled{ false };
 
-    vk::ShaderModuleCreateInfo create_info{};
+    if (next_capture_frame_ < config_.capture_frames.size() && config_.capture_frames[next_capture_frame_] == ticks_)
+    {
+        // Taken even when the capture is dropped, the frame is gone either way.
+        scheduled = true;
 
-    create_info
-        .setPCode(reinterpret_cast<const std::uint32_t*>(binary.data()))
-        .setCodeSize(binary.size());
+        next_capture_frame_++;
+    }
 
-    vk::ShaderModule shader_module;
+    const bool requested = capture_requests_ > 0;
 
-    const auto result = device_.createShaderModule(&create_info, nullptr, &shader_module, dispatch_);
+    if (!scheduled && !requested && (capture_interval_ == 0 || ticks_ % capture_interval_ != 0))
+    {
+        return;
+    }
 
-    EVK_ASSERT_RESULT(result, fmt::format("Failed to create shader module for '{}'.", name));
+    const auto extent = swapchain_info_.chosen_extent;
 
-    SPDLOG_INFO("Created shader module for '{}'.", name.c_str());
+    const auto slot = frame_capture_->begin(ticks_, extent, swapchain_info_.chosen_surface_format.surfaceFormat.format);
 
-    return shader_module;
-}
+    if (!slot)
+    {
+        LOG_DEBUG_RATE_LIMITED(engine, 1, "Capture of frame {} dropped, all capture buffers are in use.", ticks_);
 
-void engine::create_framebuffers_()
-{
-    SPDLOG_INFO("Creating framebuffers...");
+        return;
+    }
 
-    for (auto& swapchain_image : swapchain_images_)
+    if (requested && !scheduled)
     {
-        vk::FramebufferCreateInfo create_info{};
+        capture_requests_--;
+    }
 
-        create_info
-            .setRenderPass(render_pass_)
-            .setAttachmentCount(1)
-            .setPAttachments(&swapchain_image.image_view)
-            .setWidth(swapchain_info_.chosen_extent.width)
-            .setHeight(swapchain_info_.chosen_extent.height)
-            .setLayers(1);
+    // The buffer is free: the GPU passed its last copy and the workers are done with it.
+    // The host reads it after the frame timeline passes this frame.
+    const auto readback = render_graph_->import_buffer("capture", frame_capture_->buffer(slot.value()), frame_capture_->buffer_size(slot.value()),
+        render_graph::external_state{ vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags{}, vk::ImageLayout::eUndefined },
+        render_graph::external_state{ vk::PipelineStageFlagBits::eHost, vk::AccessFlagBits::eHostRead, vk::ImageLayout::eUndefined });
 
-        const auto result = device_.createFramebuffer(&create_info, nullptr, &swapchain_image.framebuffer, dispatch_);
+    render_graph_->add_pass("capture", [backbuffer, readback, extent, this](const render_graph::pass_context& context) {
+        vk::BufferImageCopy region{};
 
-        EVK_ASSERT_RESULT(result, "Failed to create framebuffer.");
-    }
+        region
+            .setBufferOffset(0)
+            .setImageSubresource(vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 })
+            .setImageExtent(vk::Extent3D{ extent.width, extent.height, 1 });
 
-    SPDLOG_INFO("Creating framebuffers.");
+        context.cmd_buffer.copyImageToBuffer(context.graph.image(backbuffer), vk::ImageLayout::eTransferSrcOptimal, context.graph.buffer(readback), 1, &region, dispatch_);
+    })
+        .read(backbuffer, render_graph::usage::transfer_src)
+        .write(readback, render_graph::usage::transfer_dst);
+
+    // draw_frame_() gives the submission the next timeline value.
+    frame_capture_->recorded(slot.value(), last_timeline_value_ + 1);
 }
 
-void engine::create_command_pools_()
+void engine::draw_triangle_(const vk::CommandBuffer& cmd_buffer, const vk::Rect2D& render_area)
 {
-    SPDLOG_INFO("Creating command pools...");
-
-    for (auto& swapchain_image : swapchain_images_)
-    {
-        vk::CommandPoolCreateInfo create_info{};
+    vk::Viewport viewport{};
 
-        create_info
-            .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
-            .setQueueFamilyIndex(graphics_queue_family_index_);
+    viewport
+        .setX(0.0f)
+        .setY(0.0f)
+        .setWidth(static_cast<float>(render_area.extent.width))
+        .setHeight(static_cast<float>(render_area.extent.height))
+        .setMinDepth(0.0f)
+        .setMaxDepth(1.0f);
 
-        const auto result = device_.createCommandPool(&create_info, nullptr, &swapchain_image.command_pool, dispatch_);
+    cmd_buffer.setViewport(0, 1, &viewport, dispatch_);
+    cmd_buffer.setScissor(0, 1, &render_area, dispatch_);
 
-        EVK_ASSERT_RESULT(result, "Failed to create command pool.");
-    }
+    cmd_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphics_pipeline_, dispatch_);
 
-    SPDLOG_INFO("Created command pools.");
+    cmd_buffer.draw(3, config_.draw_count, 0, 0, dispatch_);
 }
 
-void engine::reset_timeline_semaphore_(vk::Semaphore& timeline_semaphore, std::uint64_t initial_value)
+void engine::destroy_frame_capture_()
 {
-    if (timeline_semaphore != static_cast<vk::Semaphore>(nullptr))
+    if (!frame_capture_)
     {
-        device_.destroySemaphore(timeline_semaphore, nullptr, dispatch_);
-
-        timeline_semaphore = nullptr;
+        return;
     }
 
-    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> chain{};
+    LOG_TRACE(engine, "Destroying frame capture...");
 
-    chain.get<vk::SemaphoreTypeCreateInfo>()
-        .setSemaphoreType(vk::SemaphoreType::eTimeline)
-        .setInitialValue(initial_value);
+    // run() waited for the device to be idle, every recorded copy is done.
+    frame_capture_->collect(completed_timeline_value_());
+    frame_capture_->stop();
+    frame_capture_->destroy();
 
-    const auto result = device_.createSemaphore(&chain.get<vk::SemaphoreCreateInfo>(), nullptr, &timeline_semaphore, dispatch_);
+    LOG_INFO(engine, "Captured {} frame(s), dropped {}.", frame_capture_->captured(), frame_capture_->dropped());
 
-    EVK_ASSERT_RESULT(result, "Failed to create timeline semaphore.");
+    frame_capture_.reset();
+
+    LOG_TRACE(engine, "Destroyed frame capture.");
 }
 
-void engine::record_command_buffer_(frame_in_flight& p_frame_in_flight)
+void engine::destroy_timestamp_queries_()
 {
-    const auto& swapchain_image = swapchain_images_[p_frame_in_flight.swapchain_image_index];
+    if (!timestamp_query_pool_)
+    {
+        return;
+    }
 
-    const auto& cmd_buffer = p_frame_in_flight.command_buffer;
+    LOG_TRACE(engine, "Queueing timestamp queries for destruction...");
 
-    vk::CommandBufferBeginInfo begin_info{};
+    deletion_queue_.push(last_timeline_value_, device_, timestamp_query_pool_, dispatch_);
 
-    cmd_buffer.begin(begin_info, dispatch_);
+    timestamp_query_pool_ = nullptr;
 
-    vk::RenderPassBeginInfo render_pass_begin_info{};
+    LOG_TRACE(engine, "Queued timestamp queries for destruction.");
+}
 
-    vk::ClearValue clear_color{};
+void engine::destroy_render_graph_()
+{
+    if (!render_graph_)
+    {
+        return;
+    }
 
-    clear_color.color.setFloat32({ 0.0f, 0.0f, 0.0f, 1.0f });
+    LOG_TRACE(engine, "Queueing render graph resources for destruction...");
 
-    render_pass_begin_info
-        .setRenderPass(render_pass_)
-        .setFramebuffer(swapchain_image.framebuffer)
-        .setClearValueCount(1)
-        .setClearValues(clear_color);
+    render_graph_->release(last_timeline_value_);
 
-    render_pass_begin_info.renderArea
-        .setOffset(vk::Offset2D{ 0, 0 })
-        .setExtent(swapchain_info_.chosen_extent);
+    render_graph_.reset();
 
-    cmd_buffer.beginRenderPass(render_pass_begin_info, vk::SubpassContents::eInline, dispatch_);
+    LOG_TRACE(engine, "Queued render graph resources for destruction.");
+}
 
-    cmd_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphics_pipeline_, dispatch_);
+void engine::destroy_gpu_completion_()
+{
+    LOG_TRACE(engine, "Stopping GPU completion waiter...");
 
-    cmd_buffer.draw(3, 1, 0, 0, dispatch_);
+    gpu_completion_.reset();
 
-    cmd_buffer.endRenderPass(dispatch_);
+    LOG_TRACE(engine, "Stopped GPU completion waiter.");
+}
 
-    cmd_buffer.end(dispatch_);
+void engine::destroy_frame_timeline_()
+{
+    LOG_TRACE(engine, "Destroying frame timeline semaphore...");
+
+    device_.destroySemaphore(frame_timeline_, nullptr, dispatch_);
+
+    frame_timeline_ = nullptr;
+
+    LOG_TRACE(engine, "Destroyed frame timeline semaphore.");
 }
 
 void engine::destroy_command_pools_()
 {
-    SPDLOG_TRACE("Destroying command pools...");
+    LOG_TRACE(engine, "Queueing command pools for destruction...");
 
     for (const auto& swapchain_image : swapchain_images_)
     {
-        device_.destroyCommandPool(swapchain_image.command_pool, nullptr, dispatch_);
+        deletion_queue_.push(last_timeline_value_, device_, swapchain_image.command_pool, dispatch_);
     }
 
-    SPDLOG_TRACE("Destroyed command pools.");
+    LOG_TRACE(engine, "Queued command pools for destruction.");
 }
 
 void engine::destroy_framebuffers_()
 {
-    SPDLOG_TRACE("Destroying framebuffers...");
+    if (dynamic_rendering_)
+    {
+        return;
+    }
+
+    LOG_TRACE(engine, "Queueing framebuffers for destruction...");
 
     for (const auto& swapchain_image : swapchain_images_)
     {
-        device_.destroyFramebuffer(swapchain_image.framebuffer, nullptr, dispatch_);
+        deletion_queue_.push(last_timeline_value_, device_, swapchain_image.framebuffer, dispatch_);
     }
 
-    SPDLOG_TRACE("Destroyed framebuffers.");
+    LOG_TRACE(engine, "Queued framebuffers for destruction.");
 }
 
 void engine::destroy_graphics_pipeline_()
 {
-    SPDLOG_TRACE("Destroying graphics pipeline...");
+    LOG_TRACE(engine, "Queueing graphics pipeline for destruction...");
 
-    device_.destroyPipelineLayout(pipeline_layout_, nullptr, dispatch_);
+    deletion_queue_.push(last_timeline_value_, device_, graphics_pipeline_, dispatch_);
+    deletion_queue_.push(last_timeline_value_, device_, pipeline_layout_, dispatch_);
 
-    device_.destroyPipeline(graphics_pipeline_, nullptr, dispatch_);
-
-    SPDLOG_TRACE("Destroyed graphics pipeline.");
+    LOG_TRACE(engine, "Queued graphics pipeline for destruction.");
 }
 
 void engine::destroy_render_pass_()
 {
-    SPDLOG_TRACE("Destroying render pass...");
+    if (dynamic_rendering_)
+    {
+        return;
+    }
 
-    device_.destroyRenderPass(render_pass_, nullptr, dispatch_);
+    LOG_TRACE(engine, "Queueing render pass for destruction...");
 
-    SPDLOG_TRACE("Destroyed render pass.");
+    deletion_queue_.push(last_timeline_value_, device_, render_pass_, dispatch_);
+
+    LOG_TRACE(engine, "Queued render pass for destruction.");
 }
 
 void engine::destroy_swapchain_image_views_()
 {
-    SPDLOG_TRACE("Destroying swapchain image views...");
+    LOG_TRACE(engine, "Queueing swapchain image views for destruction...");
 
     for (const auto& swapchain_image : swapchain_images_)
     {
-        device_.destroyImageView(swapchain_image.image_view, nullptr, dispatch_);
+        deletion_queue_.push(last_timeline_value_, device_, swapchain_image.image_view, dispatch_);
+
+        if (swapchain_image.memory)
+        {
+            deletion_queue_.push(last_timeline_value_, device_, swapchain_image.image, dispatch_);
+            deletion_queue_.push(last_timeline_value_, [device = device_, memory = swapchain_image.memory, &dispatch = dispatch_]() { device.freeMemory(memory, nullptr, dispatch); });
+        }
     }
 
     swapchain_images_.clear();
 
-    SPDLOG_TRACE("Destroyed swapchain image views.");
+    LOG_TRACE(engine, "Queued swapchain image views for destruction.");
 }
 
 void engine::destroy_swapchain_()
 {
-    SPDLOG_TRACE("Destroying swapchain...");
+    LOG_TRACE(engine, "Queueing swapchain for destruction...");
 
-    device_.destroySwapchainKHR(swapchain_, nullptr, dispatch_);
+    deletion_queue_.push(last_timeline_value_, device_, swapchain_, dispatch_);
 
-    SPDLOG_TRACE("Destroyed swapchain.");
+    swapchain_ = nullptr;
+
+    LOG_TRACE(engine, "Queued swapchain for destruction.");
 }
 
 void engine::destroy_device_()
 {
-    SPDLOG_TRACE("Destroying device...");
+    LOG_TRACE(engine, "Destroying device...");
 
     device_.destroy(nullptr, dispatch_);
 
-    SPDLOG_TRACE("Destroyed device.");
+    LOG_TRACE(engine, "Destroyed device.");
 }
 
 void engine::destroy_surface_()
 {
-    SPDLOG_TRACE("Destroying surface.");
+    if (!surface_)
+    {
+        return;
+    }
+
+    LOG_TRACE(engine, "Destroying surface.");
 
     instance_.destroySurfaceKHR(surface_, nullptr, dispatch_);
 
-    SPDLOG_TRACE("Destroyed surface.");
+    LOG_TRACE(engine, "Destroyed surface.");
 }
 
 void engine::destroy_debug_utils_ext_()
 {
-    if (!USE_DEBUG_LAYERS)
+    if (!validation_enabled_)
     {
-        SPDLOG_ERROR("DEBUG LAYERS ARE DISABLED!!!!!!!!");
+        LOG_ERROR(engine, "DEBUG LAYERS ARE DISABLED!!!!!!!!");
 
         return;
     }
 
-    if (messages_emitted_ == 0)
+    LOG_TRACE(engine, "Destroying debug utils messenger...");
+
+    instance_.destroy(debug_utils_messenger_, nullptr, dispatch_);
+
+    validation_messages_->stop();
+
+    auto messages_emitted = validation_messages_->messages_emitted();
+
+    if (messages_emitted == 0)
     {
-        SPDLOG_DEBUG("No messages were emitted during the lifetime of the debug messenger callback.");
+        LOG_DEBUG(engine, "No messages were emitted during the lifetime of the debug messenger callback.");
     }
     else
     {
-        SPDLOG_WARN("{} messages were emitted during the lifetime of the debug messenger callback.", messages_emitted_);
+        LOG_WARN(engine, "{} messages were emitted during the lifetime of the debug messenger callback.", messages_emitted);
     }
 
-    SPDLOG_TRACE("Destroying debug utils messenger...");
-
-    instance_.destroy(debug_utils_messenger_, nullptr, dispatch_);
+    validation_messages_.reset();
 }
 
 void engine::destroy_instance_()
 {
-    SPDLOG_TRACE("Destroying Vulkan instance...");
+    LOG_TRACE(engine, "Destroying Vulkan instance...");
 
     instance_.destroy(nullptr, dispatch_);
 
-    SPDLOG_TRACE("Destroyed Vulkan instance.");
+    LOG_TRACE(engine, "Destroyed Vulkan instance.");
 }
 
 void engine::destroy_sdl_window_()
 {
-    SPDLOG_TRACE("Destroying SDL window...");
+    LOG_TRACE(engine, "Destroying SDL window...");
 
     sdl_window_.reset();
 
-    SPDLOG_TRACE("Destroyed SDL window.");
+    LOG_TRACE(engine, "Destroyed SDL window.");
 }
 
 bool engine::is_physical_device_suitable_(const physical_device_info& p_physical_device_info)
@@ -1217,7 +2378,7 @@ bool engine::is_physical_device_suitable_(const physical_device_info& p_physical
     return (p_physical_device_info.properties.properties.deviceType == preferred_physical_device_type_)
         && !p_physical_device_info.graphics_family_queue_indices_.empty()
         && !p_physical_device_info.transfer_family_queue_indices_.empty()
-        && !p_physical_device_info.present_family_queue_indices_.empty();
+        && (config_.headless || !p_physical_device_info.present_family_queue_indices_.empty());
 }
 
 VkBool32 messenger_callback(
@@ -1228,50 +2389,11 @@ VkBool32 messenger_callback(
 {
     auto* thiz = reinterpret_cast<engine*>(pUserData);
 
-    thiz->messages_emitted_++;
-
-    bool trigger_debug_break = false;
-
-    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
-    {
-        SPDLOG_ERROR("{}", pCallbackData->pMessageIdName);
-        SPDLOG_ERROR("\t{}", pCallbackData->pMessage);
-
-        trigger_debug_break = true;
-    }
-    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
-    {
-        SPDLOG_WARN("{}", pCallbackData->pMessageIdName);
-        SPDLOG_WARN("\t{}", pCallbackData->pMessage);
-
-        trigger_debug_break = true;
-    }
-    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
-    {
-        SPDLOG_INFO("{}", pCallbackData->pMessageIdName);
-        SPDLOG_INFO("\t{}", pCallbackData->pMessage);
-    }
-    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
-    {
-        SPDLOG_TRACE("{}", pCallbackData->pMessageIdName);
-        SPDLOG_TRACE("\t{}", pCallbackData->pMessage);
-    }
-
-    for (std::uint64_t object_index = 0; object_index < pCallbackData->objectCount; ++object_index)
-    {
-        auto& object_name_info = pCallbackData->pObjects[object_index];
+    // Runs inside the Vulkan call that triggered it, the message is formatted and logged later.
+    thiz->validation_messages_->push(messageSeverity, pCallbackData);
 
-        vk::ObjectType object_type = static_cast<vk::ObjectType>(object_name_info.objectType);
-
-        if (object_name_info.pObjectName == nullptr)
-        {
-            SPDLOG_DEBUG("\tPrevious message is associated with a '{}' object (no name): {:x}", vk::to_string(object_type).c_str(), object_name_info.objectHandle);
-        }
-        else
-        {
-            SPDLOG_DEBUG("\tPrevious message is associated with a '{}' object: {:x}", vk::to_string(object_type).c_str(), object_name_info.pObjectName);
-        }
-    }
+    bool trigger_debug_break =
+        (messageSeverity & (VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)) != 0;
 
     if (trigger_debug_break)
     {
@@ -1283,10 +2405,9 @@ VkBool32 messenger_callback(
 
 void engine::recreate_swapchain_()
 {
-    SPDLOG_WARN("Recreating swapchain...");
-
-    device_.waitIdle(dispatch_);
+    LOG_WARN_RATE_LIMITED(engine, 1, "Recreating swapchain...");
 
+    // No device wait: the old objects go to the deletion queue with the last submitted frame.
     destroy_frame_in_flight_(new_frame_in_flight);
     destroy_command_pools_();
     destroy_framebuffers_();
@@ -1304,12 +2425,16 @@ void engine::recreate_swapchain_()
 
     out_of_date_ = false;
 
-    SPDLOG_WARN("Recreated swapchain.");
+    // The present ids were those of the old swapchain.
+    last_present_id_ = 0;
+    latency_presents_.clear();
+
+    LOG_WARN_RATE_LIMITED(engine, 1, "Recreated swapchain.");
 }
 
 void engine::render_entrypoint_()
 {
-    SPDLOG_INFO("Render thread reporting in. LETS DO THIS.");
+    LOG_INFO(engine, "Render thread reporting in. LETS DO THIS.");
 
     while (render_thread_active_)
     {
@@ -1319,7 +2444,7 @@ void engine::render_entrypoint_()
 
         if (our_frame_in_flight == nullptr)
         {
-            SPDLOG_INFO("Received nullptr frame_in_flight, stopping render thread.");
+            LOG_INFO(engine, "Received nullptr frame_in_flight, stopping render thread.");
 
             return;
         }
@@ -1329,12 +2454,14 @@ void engine::render_entrypoint_()
         //our_frame_in_flight->frame_done->release();
     }
 
-    SPDLOG_INFO("Render thread done.");
+    LOG_INFO(engine, "Render thread done.");
 }
 
 void engine::present_(frame_in_flight* our_frame_in_flight)
 {
-    vk::PresentInfoKHR present_info{};
+    vk::StructureChain<vk::PresentInfoKHR, vk::PresentIdKHR> chain{};
+
+    auto& present_info = chain.get<vk::PresentInfoKHR>();
 
     present_info
         .setWaitSemaphoreCount(1)
@@ -1343,6 +2470,19 @@ void engine::present_(frame_in_flight* our_frame_in_flight)
         .setPSwapchains(&swapchain_)
         .setPImageIndices(&our_frame_in_flight->swapchain_image_index);
 
+    const std::uint64_t present_id = ++present_id_;
+
+    if (present_wait_)
+    {
+        chain.get<vk::PresentIdKHR>()
+            .setSwapchainCount(1)
+            .setPPresentIds(&present_id);
+    }
+    else
+    {
+        chain.unlink<vk::PresentIdKHR>();
+    }
+
     try
     {
         const auto result = present_queue_.presentKHR(present_info, dispatch_);
@@ -1355,49 +2495,177 @@ void engine::present_(frame_in_flight* our_frame_in_flight)
         {
             EVK_ASSERT_RESULT(result, "Failed to present.");
         }
+
+        last_present_id_ = present_id;
+
+        if (present_wait_ && our_frame_in_flight->input_time)
+        {
+            if (latency_presents_.size() == MAXIMUM_LATENCY_PRESENTS)
+            {
+                latency_presents_.pop_front();
+            }
+
+            latency_presents_.emplace_back(present_id, our_frame_in_flight->input_time.value());
+        }
     }
     catch (vk::OutOfDateKHRError&)
     {
-        SPDLOG_WARN("Surface is out of date.");
+        LOG_WARN_RATE_LIMITED(engine, 1, "Surface is out of date.");
 
         out_of_date_ = true;
     }
 }
 
-void engine::wait_on_fence(vk::Fence fence, const std::string& name)
+void engine::wait_for_previous_present_()
 {
-    vk::Result result;
+    if (!present_wait_ || out_of_date_)
+    {
+        return;
+    }
+
+    const bool pace = low_latency() && last_present_id_ != 0;
 
-    std::uint64_t total_time_waited_{ 0 };
+    if (!pace && latency_presents_.empty())
+    {
+        return;
+    }
 
-    std::uint64_t fence_handle = reinterpret_cast<std::uint64_t>(fence.operator VkFence_T *());
+    const auto wait_start = std::chrono::steady_clock::now();
 
-    do
+    try
     {
-        result = device_.waitForFences(1, &fence, true, WAIT_FOR_FENCES_TIMEOUT_MS * 1000000);
+        if (pace)
+        {
+            // Waits for the last present, the earlier ones are done by then as well.
+            const auto result = device_.waitForPresentKHR(swapchain_, last_present_id_, PRESENT_WAIT_TIMEOUT_MS * 1000000, dispatch_);
+
+            const auto wait_end = std::chrono::steady_clock::now();
 
-        if (result == vk::Result::eSuccess)
+            if (result == vk::Result::eTimeout)
+            {
+                LOG_DEBUG_RATE_LIMITED(engine, 1, "Present {} not done after {} ms, not waiting any longer.", last_present_id_, PRESENT_WAIT_TIMEOUT_MS);
+            }
+            else
+            {
+                if (result == vk::Result::eSuboptimalKHR)
+                {
+                    out_of_date_ = true;
+                }
+
+                add_presented_input_latencies_(last_present_id_, wait_end);
+            }
+
+            last_present_wait_ = wait_end - wait_start;
+        }
+        else
         {
-            return;
+            // The presents with input are only checked for, oldest first. A latency ends at the
+            // first check after it was presented, up to a frame late.
+            while (!latency_presents_.empty())
+            {
+                const auto present_id = latency_presents_.front().first;
+
+                const auto result = device_.waitForPresentKHR(swapchain_, present_id, 0, dispatch_);
+
+                if (result == vk::Result::eTimeout)
+                {
+                    break;
+                }
+
+                if (result == vk::Result::eSuboptimalKHR)
+                {
+                    out_of_date_ = true;
+                }
+
+                add_presented_input_latencies_(present_id, std::chrono::steady_clock::now());
+            }
         }
+    }
+    catch (vk::OutOfDateKHRError&)
+    {
+        LOG_WARN_RATE_LIMITED(engine, 1, "Surface is out of date.");
+
+        out_of_date_ = true;
+    }
+}
+
+void engine::add_input_latency_(std::chrono::steady_clock::time_point input_time, std::chrono::steady_clock::time_point done)
+{
+    last_input_latency_ = done - input_time;
+
+    input_latency_.add(last_input_latency_);
+
+    LOG_TRACE_EVERY_N(engine, 100, "Input latency {:.2f} ms.", last_input_latency_.count());
+}
+
+void engine::add_presented_input_latencies_(std::uint64_t present_id, std::chrono::steady_clock::time_point done)
+{
+    // Presents complete in order, so every pending one up to present_id is done.
+    while (!latency_presents_.empty() && latency_presents_.front().first <= present_id)
+    {
+        add_input_latency_(latency_presents_.front().second, done);
+
+        latency_presents_.pop_front();
+    }
+}
+
+void engine::on_gpu_hang_(std::uint64_t value, std::chrono::milliseconds stalled)
+{
+    const auto message = fmt::format("Stopped waiting on frame timeline value {} after '{}' millisecond(s) without progress, this might indicate something very wrong.", value, stalled.count());
+
+    // Nothing here may wait on the logging thread, it may be what is stuck: the message goes into
+    // the flight recorder, which is dumped first, and to stderr.
+    spdlog::details::flight_recorder::record(spdlog::details::log_msg(spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, "engine", spdlog::level::critical, message));
+
+    spdlog::details::flight_recorder::dump_crash_file();
+
+    fmt::print(stderr, "{}\n", message);
+
+    drain_log(std::chrono::milliseconds(HANG_LOG_DRAIN_TIMEOUT_MS));
+
+    std::abort();
+}
 
-        total_time_waited_ += WAIT_FOR_FENCES_TIMEOUT_MS;
+namespace
+{
+
+struct present_mode_entry
+{
+    vk::PresentModeKHR present_mode;
+    std::string_view name;
+};
+
+constexpr present_mode_entry PRESENT_MODE_NAMES[] = {
+    { vk::PresentModeKHR::eImmediate, "immediate" },
+    { vk::PresentModeKHR::eMailbox, "mailbox" },
+    { vk::PresentModeKHR::eFifo, "fifo" },
+    { vk::PresentModeKHR::eFifoRelaxed, "fifo_relaxed" }
+};
 
-        if ((total_time_waited_ % 50) == 0)
+}
+
+std::optional<vk::PresentModeKHR> present_mode_from_name(std::string_view name)
+{
+    for (const auto& entry : PRESENT_MODE_NAMES)
+    {
+        if (entry.name == name)
         {
-            SPDLOG_WARN("Waited on fence '{}' ({:x}) for '{}' millisecond(s) now.", name.c_str(), fence_handle, total_time_waited_);
+            return entry.present_mode;
         }
+    }
 
-        if (total_time_waited_ >= TOTAL_TIME_ABORT_LEVEL_MS)
-        {
-            SPDLOG_CRITICAL("Stopped waiting on fence '{}' ({:x}) after waiting '{}' millisecond(s), this might indicate something very wrong.", name.c_str(), fence_handle, total_time_waited_);
+    return std::nullopt;
+}
 
-            std::abort();
+std::string_view present_mode_name(vk::PresentModeKHR present_mode)
+{
+    for (const auto& entry : PRESENT_MODE_NAMES)
+    {
+        if (entry.present_mode == present_mode)
+        {
+            return entry.name;
         }
     }
-    while (result == vk::Result::eTimeout);
 
-    SPDLOG_CRITICAL("In waiting for fence '{}' ({:x}), the result code returned was '{}'.", name.c_str(), fence_handle, vk::to_string(result).c_str());
-
-    std::abort();
+    return "unknown";
 }
@@ -3,6 +3,16 @@
 
 #include "core/core.h"
 
+#include "core/deletion_queue.h"
+#include "core/dynamic_resolution.h"
+#include "core/frame_capture.h"
+#include "core/gpu_completion.h"
+#include "core/latency_histogram.h"
+#include "core/render_graph.h"
+#include "core/validation_messages.h"
+
+#include "log/spdlog/sinks/shared_memory_sink.h"
+
 struct physical_device_info
 {
     vk::PhysicalDevice physical_device{ nullptr };
@@ -34,6 +44,9 @@ struct swapchain_image
     vk::Image image{ nullptr };
     vk::ImageView image_view{ nullptr };
 
+    // Headless only, the engine owns the offscreen images. Swapchain images belong to the swapchain.
+    vk::DeviceMemory memory{ nullptr };
+
     vk::Framebuffer framebuffer{ nullptr };
     vk::CommandPool command_pool{ nullptr };
 };
@@ -51,17 +64,77 @@ struct frame_in_flight
 
     std::uint32_t swapchain_image_index{ 0 };
 
+    // frame timeline value signaled by the submission of this frame, 0 if it wasn't submitted
+    std::uint64_t timeline_value{ 0 };
+
+    // earliest input event consumed by this frame, for the input latency
+    std::optional<std::chrono::steady_clock::time_point> input_time;
+
     //std::unique_ptr<std::binary_semaphore> frame_done;
 };
 
+// Timings of one frame, handed to engine_config::frame_callback once the GPU finished the frame.
+struct frame_stats
+{
+    std::uint64_t frame{ 0 };
+
+    // Recording and submitting the frame, without the wait for the GPU.
+    std::chrono::duration<float, std::milli> cpu_time{ 0.0f };
+
+    // Between the timestamps after the swapchain image was acquired and at the end of the command buffer, 0 without timestamps.
+    std::chrono::duration<float, std::milli> gpu_time{ 0.0f };
+
+    // The frame loop was blocked waiting for the GPU to finish the frame, the CPU was idle.
+    std::chrono::duration<float, std::milli> wait_time{ 0.0f };
+
+    float resolution_scale{ 1.0f };
+};
+
+// How the engine runs, the defaults give the window configured by the VKT_* environment variables.
+struct engine_config
+{
+    // No window, surface or swapchain: the frames are rendered to offscreen images of
+    // headless_extent and never presented. Needs dynamic rendering.
+    bool headless{ false };
+    vk::Extent2D headless_extent{ 1024, 512 };
+
+    // The engine stops by itself after this many frames, 0 runs until stop().
+    std::uint64_t frame_limit{ 0 };
+
+    // Instances of the triangle drawn per frame, all on top of each other. Scales the GPU load.
+    std::uint32_t draw_count{ 1 };
+
+    // Override VKT_GPU_TYPE, VKT_DYNAMIC_RESOLUTION and VKT_DISABLE_VALIDATION when set.
+    std::optional<vk::PhysicalDeviceType> gpu_type;
+    std::optional<bool> dynamic_resolution;
+    std::optional<bool> validation;
+
+    // Override VKT_PRESENT_MODE, ignored when headless. Missing present modes fall back to ones
+    // that are there, down to FIFO. Low latency waits for the previous frame to be presented
+    // (VK_KHR_present_wait) before sampling input, FIFO unless a present mode is given.
+    std::optional<vk::PresentModeKHR> present_mode;
+    std::optional<bool> low_latency;
+
+    // Frames to capture (increasing), on top of VKT_CAPTURE. Written to capture_directory when set.
+    std::vector<std::uint64_t> capture_frames;
+    std::optional<std::string> capture_directory;
+
+    // Called by the capture workers for every capture written.
+    frame_capture::result_callback capture_callback;
+
+    // Called by the thread running the engine after every frame.
+    std::function<void(const frame_stats&)> frame_callback;
+};
+
 class engine
 {
 public:
     constexpr static bool USE_DEBUG_LAYERS = true;
     constexpr static bool RENDER_THREAD_ENABLED = false;
 
-    constexpr static std::uint64_t WAIT_FOR_FENCES_TIMEOUT_MS = 25; // milliseconds
+    // The GPU completion watchdog aborts when no frame completed for this long.
     constexpr static std::uint64_t TOTAL_TIME_ABORT_LEVEL_MS = 1000; // milliseconds
+    constexpr static std::uint64_t HANG_LOG_DRAIN_TIMEOUT_MS = 250; // milliseconds
 
     static constexpr int VULKAN_MAJOR{ 1 };
     static constexpr int VULKAN_MINOR{ 2 };
@@ -78,12 +151,26 @@ public:
 #endif
     static constexpr std::uint32_t PREFERRED_EXTRA_IMAGE_COUNT{ 1 };
 
+    // Low latency pacing gives up on a present that takes longer (minimized windows never present).
+    static constexpr std::uint64_t PRESENT_WAIT_TIMEOUT_MS{ 100 };
+    // Presents with input that are still waited for, the oldest are dropped beyond this (minimized windows never present).
+    static constexpr std::size_t MAXIMUM_LATENCY_PRESENTS{ 16 };
+
     static constexpr const char* VERT_SHADER_FILENAME{ "spv/vert.spv" };
     static constexpr const char* FRAG_SHADER_FILENAME{ "spv/frag.spv" };
 
     static constexpr std::uint64_t MAXIMUM_FRAMES_IN_FLIGHT{ 2 };
 
-    engine();
+    // Frames whose timestamps can be pending at once, the queries of older frames are reused.
+    static constexpr std::uint32_t TIMESTAMP_QUERY_FRAMES{ 4 };
+
+    // GPU time budget of the dynamic resolution, overridden by VKT_FRAME_BUDGET_MS.
+    static constexpr float DEFAULT_FRAME_BUDGET_MS{ 15.0f };
+
+    // Where the frame captures go, overridden by VKT_CAPTURE_DIR.
+    static constexpr const char* CAPTURE_DIRECTORY{ "captures" };
+
+    explicit engine(engine_config config = {});
     ~engine();
 
     void initialize();
@@ -94,11 +181,28 @@ public:
 
     void stop();
 
+    // Captures the next frame, needs VKT_CAPTURE. Bound to sdl_window::CAPTURE_KEY.
+    void request_capture();
+
     bool main_loop_running() const { return main_loop_running_; }
 
+    // Valid after initialize().
+    std::string device_name() const;
+    vk::PresentModeKHR present_mode() const { return swapchain_info_.chosen_present_mode; }
+    bool low_latency() const { return low_latency_requested_ && present_wait_; }
+    vk::Extent2D extent() const { return swapchain_info_.chosen_extent; }
+
+    // From the earliest input event a frame consumed until the frame was presented, or until the
+    // GPU finished it without VK_KHR_present_wait (input_latency_to_present()).
+    const latency_histogram& input_latency() const { return input_latency_; }
+    bool input_latency_to_present() const { return present_wait_; }
+
 private:
     void main_loop_();
 
+    void report_log_stats_(const log_queue_stats& stats);
+    void publish_counters_(const log_queue_stats& stats);
+
     void create_frame_in_flight_(frame_in_flight& p_frame_in_flight);
     void destroy_frame_in_flight_(frame_in_flight& p_frame_in_flight, bool final_destroy = false);
 
@@ -110,20 +214,45 @@ private:
     void enumerate_physical_devices_();
     void create_surface_();
     void select_physical_device_();
+    void select_rendering_backend_();
+    void select_present_wait_();
+    void select_dynamic_resolution_();
+    void create_frame_capture_();
     void create_device_();
     void retrieve_queues_();
     void query_swapchain_support_();
+    void choose_present_mode_();
     void create_swapchain_();
     void retrieve_swapchain_images_();
+    void create_offscreen_images_();
     void create_render_pass_();
     void create_graphics_pipeline_();
     vk::ShaderModule create_shader_module_(const std::string& name, const std::vector<char>& binary);
     void create_framebuffers_();
     void create_command_pools_();
+    void create_frame_timeline_();
+    void create_gpu_completion_();
+    void create_render_graph_();
+    void create_timestamp_queries_();
 
     void reset_timeline_semaphore_(vk::Semaphore& timeline_semaphore, std::uint64_t initial_value);
     void record_command_buffer_(frame_in_flight& p_frame_in_flight);
+    void build_render_graph_(const swapchain_image& p_swapchain_image);
+    void add_capture_pass_(render_graph::resource backbuffer);
+    void draw_triangle_(const vk::CommandBuffer& cmd_buffer, const vk::Rect2D& render_area);
     
+    // The GPU is done with everything submitted up to the returned frame timeline value.
+    std::uint64_t completed_timeline_value_();
+
+    // First of the two timestamp queries of the frame with the given timeline value.
+    std::uint32_t timestamp_query_(std::uint64_t timeline_value) const;
+    void read_timestamps_(std::uint64_t completed);
+
+    void destroy_frame_capture_();
+    void destroy_timestamp_queries_();
+    void destroy_render_graph_();
+    void destroy_gpu_completion_();
+    void destroy_frame_timeline_();
     void destroy_command_pools_();
     void destroy_framebuffers_();
     void destroy_graphics_pipeline_();
@@ -146,10 +275,20 @@ private:
 
     void present_(frame_in_flight* our_frame_in_flight);
 
+    void wait_for_previous_present_();
+
+    void add_input_latency_(std::chrono::steady_clock::time_point input_time, std::chrono::steady_clock::time_point done);
+
+    void add_presented_input_latencies_(std::uint64_t present_id, std::chrono::steady_clock::time_point done);
+
     // render thread only end
 
-    void wait_on_fence(vk::Fence fence, const std::string& name);
+    // Watchdog thread, dumps the flight recorder and aborts.
+    void on_gpu_hang_(std::uint64_t value, std::chrono::milliseconds stalled);
+
+    engine_config config_;
 
+    // Null when headless.
     std::unique_ptr<sdl_window> sdl_window_;
 
     bool main_loop_running_{ true };
@@ -163,7 +302,9 @@ private:
     vk::Instance instance_{ nullptr };
     vk::DispatchLoaderDynamic dispatch_;
 
-    std::uint64_t messages_emitted_{ 0 };
+    bool validation_enabled_{ true };
+
+    std::unique_ptr<validation_messages> validation_messages_;
     vk::DebugUtilsMessengerEXT debug_utils_messenger_{ nullptr };
 
     std::vector<physical_device_info> physical_device_infos_;
@@ -172,6 +313,10 @@ private:
 
     vk::Device device_{ nullptr };
 
+    // VK_KHR_dynamic_rendering: attachments are given when recording, there is no render pass
+    // and there are no framebuffers. Used when the device supports it, unless VKT_DISABLE_DYNAMIC_RENDERING is set.
+    bool dynamic_rendering_{ false };
+
     std::uint32_t graphics_queue_family_index_{ 0 };
     vk::Queue graphics_queue_{ nullptr };
     std::uint32_t present_queue_family_index_{ 0 };
@@ -179,6 +324,26 @@ private:
 
     vk::SurfaceKHR surface_{ nullptr };
 
+    // From engine_config, VKT_PRESENT_MODE or PREFERRED_PRESENT_MODE, what the surface supports is chosen later.
+    vk::PresentModeKHR requested_present_mode_{ PREFERRED_PRESENT_MODE };
+    bool low_latency_requested_{ false };
+
+    // VK_KHR_present_id and VK_KHR_present_wait are enabled and the presents carry increasing ids.
+    // In low latency mode the frame loop waits for the last one before sampling input.
+    bool present_wait_{ false };
+    std::uint64_t present_id_{ 0 };
+    // 0 when nothing was presented to the current swapchain yet.
+    std::uint64_t last_present_id_{ 0 };
+    std::chrono::duration<float, std::milli> last_present_wait_{ 0.0f };
+
+    // Input sampled by process_events() for the next frame.
+    std::optional<std::chrono::steady_clock::time_point> frame_input_time_;
+    // Presents of frames with input, oldest first, their latency is added once they are presented.
+    std::deque<std::pair<std::uint64_t, std::chrono::steady_clock::time_point>> latency_presents_;
+
+    latency_histogram input_latency_;
+    std::chrono::duration<float, std::milli> last_input_latency_{ 0.0f };
+
     swapchain_info swapchain_info_;
 
     vk::SwapchainKHR swapchain_{ nullptr };
@@ -192,6 +357,44 @@ private:
 
     vk::Pipeline graphics_pipeline_{ nullptr };
 
+    // Signaled with an increasing value by every frame submission, the deletion queue
+    // destroys objects once the GPU passed the value of their last use.
+    vk::Semaphore frame_timeline_{ nullptr };
+    std::uint64_t last_timeline_value_{ 0 };
+
+    deletion_queue deletion_queue_;
+
+    // Rebuilt for every frame with the acquired swapchain image, dynamic rendering backend only.
+    std::unique_ptr<render_graph> render_graph_;
+
+    // Two timestamps per frame, at the start and the end of its command buffer. Null when the
+    // graphics queue has no timestamps.
+    vk::QueryPool timestamp_query_pool_{ nullptr };
+    float timestamp_period_ns_{ 0.0f };
+    std::uint64_t timestamp_mask_{ 0 };
+    std::uint64_t timestamps_read_{ 0 };
+    std::chrono::duration<float, std::milli> last_gpu_frame_time_{ 0.0f };
+
+    // Tells when frame_timeline_ values are reached, the frame loop waits on it instead of in the driver.
+    std::unique_ptr<gpu_completion> gpu_completion_;
+    std::chrono::duration<float, std::milli> last_gpu_wait_time_{ 0.0f };
+
+    // Set when rendering offscreen at a scale chosen from the GPU frame times, the result is
+    // blitted to the swapchain image. On by default for integrated GPUs, VKT_DYNAMIC_RESOLUTION=on|off.
+    std::unique_ptr<dynamic_resolution> dynamic_resolution_;
+    vk::Filter upscale_filter_{ vk::Filter::eLinear };
+
+    // Set with VKT_CAPTURE=N, every Nth frame is copied to a readback buffer and written to disk
+    // by the capture workers (N = 0 only captures on request, F12). Dynamic rendering backend only.
+    std::unique_ptr<frame_capture> frame_capture_;
+    std::uint64_t capture_interval_{ 0 };
+    std::uint64_t capture_requests_{ 0 };
+
+    // Index of the next of engine_config::capture_frames.
+    std::size_t next_capture_frame_{ 0 };
+
+    std::chrono::duration<float, std::milli> last_cpu_frame_time_{ 0.0f };
+
     //std::uint64_t current_frame_{ 0 };
 
     using clock = std::chrono::system_clock;
@@ -202,6 +405,11 @@ private:
     std::uint64_t second_counter_{ 0 };
     std::uint64_t fps_counter_{ 0 };
 
+    std::size_t last_log_overrun_counter_{ 0 };
+
+    // set when logging to shared memory (VKT_SHARED_MEMORY_LOG), the counters are published every second
+    std::shared_ptr<spdlog::sinks::shared_memory_sink_mt> shared_memory_sink_;
+
     bool out_of_date_{ false };
 
     std::thread render_thread_;
@@ -224,4 +432,9 @@ VkBool32 messenger_callback(
     const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
     void* pUserData);
 
+// "immediate", "mailbox", "fifo" or "fifo_relaxed", nothing for anything else.
+std::optional<vk::PresentModeKHR> present_mode_from_name(std::string_view name);
+
+std::string_view present_mode_name(vk::PresentModeKHR present_mode);
+
 #endif
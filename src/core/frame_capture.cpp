@@ -0,0 +1,297 @@
+#include "frame_capture.h"
+
+#include "image_encoding.h"
+
+frame_capture::frame_capture(vk::Device device, vk::PhysicalDevice physical_device, const vk::DispatchLoaderDynamic& dispatch,
+    std::filesystem::path directory, file_format format, result_callback callback)
+    : device_(device), dispatch_(dispatch), directory_(std::move(directory)), format_(format), callback_(std::move(callback))
+{
+    memory_properties_ = physical_device.getMemoryProperties(dispatch_);
+
+    std::filesystem::create_directories(directory_);
+
+    for (std::size_t index = 0; index < WORKER_COUNT; ++index)
+    {
+        workers_.emplace_back([this]() { this->worker_entrypoint_(); });
+    }
+}
+
+frame_capture::~frame_capture()
+{
+    stop();
+}
+
+bool frame_capture::supports(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eB8G8R8A8Unorm:
+    case vk::Format::eB8G8R8A8Srgb:
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Srgb:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::optional<std::size_t> frame_capture::begin(std::uint64_t frame, const vk::Extent2D& extent, vk::Format format)
+{
+    for (std::size_t index = 0; index < RING_SIZE; ++index)
+    {
+        auto& current_slot = slots_[index];
+
+        if (current_slot.state.load(std::memory_order_acquire) != slot_state::available)
+        {
+            continue;
+        }
+
+        const vk::DeviceSize size = vk::DeviceSize{ extent.width } * extent.height * 4;
+
+        // Available means the GPU and the workers are done with it, a smaller buffer can go right away.
+        if (current_slot.size < size)
+        {
+            destroy_buffer_(current_slot);
+            create_buffer_(current_slot, size);
+        }
+
+        current_slot.frame = frame;
+        current_slot.extent = extent;
+        current_slot.format = format;
+        current_slot.timeline_value = 0;
+
+        return index;
+    }
+
+    dropped_++;
+
+    return std::nullopt;
+}
+
+void frame_capture::recorded(std::size_t slot, std::uint64_t timeline_value)
+{
+    slots_[slot].timeline_value = timeline_value;
+    slots_[slot].state.store(slot_state::recorded, std::memory_order_relaxed);
+}
+
+void frame_capture::collect(std::uint64_t completed)
+{
+    for (std::size_t index = 0; index < RING_SIZE; ++index)
+    {
+        auto& current_slot = slots_[index];
+
+        if (current_slot.state.load(std::memory_order_relaxed) != slot_state::recorded || current_slot.timeline_value > completed)
+        {
+            continue;
+        }
+
+        if (!coherent_)
+        {
+            vk::MappedMemoryRange range{};
+
+            range
+                .setMemory(current_slot.memory)
+                .setOffset(0)
+                .setSize(VK_WHOLE_SIZE);
+
+            const auto result = device_.invalidateMappedMemoryRanges(1, &range, dispatch_);
+
+            EVK_ASSERT_RESULT(result, "Failed to invalidate capture buffer.");
+        }
+
+        current_slot.state.store(slot_state::encoding, std::memory_order_release);
+
+        jobs_.enqueue(job{ index });
+    }
+}
+
+void frame_capture::stop()
+{
+    if (workers_.empty())
+    {
+        return;
+    }
+
+    // Behind the jobs already queued.
+    for (std::size_t index = 0; index < workers_.size(); ++index)
+    {
+        jobs_.enqueue(job{});
+    }
+
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+
+    workers_.clear();
+}
+
+void frame_capture::destroy()
+{
+    for (auto& current_slot : slots_)
+    {
+        destroy_buffer_(current_slot);
+    }
+}
+
+void frame_capture::create_buffer_(slot& p_slot, vk::DeviceSize size)
+{
+    vk::BufferCreateInfo create_info{};
+
+    create_info
+        .setSize(size)
+        .setUsage(vk::BufferUsageFlagBits::eTransferDst)
+        .setSharingMode(vk::SharingMode::eExclusive);
+
+    auto result = device_.createBuffer(&create_info, nullptr, &p_slot.buffer, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create capture buffer.");
+
+    const auto requirements = device_.getBufferMemoryRequirements(p_slot.buffer, dispatch_);
+
+    // Cached memory makes the reads of the workers fast, it may need invalidating.
+    const vk::MemoryPropertyFlags preferred[] = {
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+    };
+
+    auto memory_type = std::numeric_limits<std::uint32_t>::max();
+
+    for (const auto properties : preferred)
+    {
+        for (std::uint32_t index = 0; index < memory_properties_.memoryTypeCount && memory_type == std::numeric_limits<std::uint32_t>::max(); ++index)
+        {
+            if ((requirements.memoryTypeBits & (1u << index)) && (memory_properties_.memoryTypes[index].propertyFlags & properties) == properties)
+            {
+                memory_type = index;
+            }
+        }
+    }
+
+    if (memory_type == std::numeric_limits<std::uint32_t>::max())
+    {
+        throw_exception("No host visible memory for the capture buffers.");
+    }
+
+    coherent_ = static_cast<bool>(memory_properties_.memoryTypes[memory_type].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    vk::MemoryAllocateInfo allocate_info{};
+
+    allocate_info
+        .setAllocationSize(requirements.size)
+        .setMemoryTypeIndex(memory_type);
+
+    result = device_.allocateMemory(&allocate_info, nullptr, &p_slot.memory, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to allocate capture buffer memory.");
+
+    device_.bindBufferMemory(p_slot.buffer, p_slot.memory, 0, dispatch_);
+
+    void* mapped = nullptr;
+
+    result = device_.mapMemory(p_slot.memory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags{}, &mapped, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to map capture buffer memory.");
+
+    p_slot.mapped = static_cast<const std::uint8_t*>(mapped);
+    p_slot.size = size;
+
+    LOG_DEBUG(capture, "Created a {} byte capture buffer ({}).", size, coherent_ ? "coherent" : "cached");
+}
+
+void frame_capture::destroy_buffer_(slot& p_slot)
+{
+    if (p_slot.memory)
+    {
+        device_.unmapMemory(p_slot.memory, dispatch_);
+        device_.freeMemory(p_slot.memory, nullptr, dispatch_);
+    }
+
+    if (p_slot.buffer)
+    {
+        device_.destroyBuffer(p_slot.buffer, nullptr, dispatch_);
+    }
+
+    p_slot.buffer = nullptr;
+    p_slot.memory = nullptr;
+    p_slot.mapped = nullptr;
+    p_slot.size = 0;
+}
+
+void frame_capture::worker_entrypoint_()
+{
+    job current_job;
+
+    while (true)
+    {
+        jobs_.wait_dequeue(current_job);
+
+        if (current_job.slot >= RING_SIZE)
+        {
+            return;
+        }
+
+        encode_(slots_[current_job.slot]);
+    }
+}
+
+void frame_capture::encode_(slot& p_slot)
+{
+    const auto frame = p_slot.frame;
+    const auto extent = p_slot.extent;
+
+    const std::size_t pixel_count = std::size_t{ extent.width } * extent.height;
+
+    std::vector<std::uint8_t> pixels(p_slot.mapped, p_slot.mapped + pixel_count * 4);
+
+    const bool bgra = p_slot.format == vk::Format::eB8G8R8A8Unorm || p_slot.format == vk::Format::eB8G8R8A8Srgb;
+
+    // The pixels are ours now, the buffer can take the next capture.
+    p_slot.state.store(slot_state::available, std::memory_order_release);
+
+    for (std::size_t index = 0; index < pixel_count; ++index)
+    {
+        auto* pixel = &pixels[index * 4];
+
+        if (bgra)
+        {
+            std::swap(pixel[0], pixel[2]);
+        }
+
+        // The swapchain is composited opaque, whatever the alpha is.
+        pixel[3] = 255;
+    }
+
+    result capture_result{};
+
+    capture_result.frame = frame;
+    capture_result.width = extent.width;
+    capture_result.height = extent.height;
+    capture_result.pixel_hash = hash_pixels(pixels.data(), extent.width, extent.height);
+
+    const auto encoded = format_ == file_format::qoi
+        ? encode_qoi(pixels.data(), extent.width, extent.height)
+        : encode_png(pixels.data(), extent.width, extent.height);
+
+    capture_result.path = directory_ / fmt::format("frame_{:06}.{}", frame, format_ == file_format::qoi ? "qoi" : "png");
+
+    std::ofstream file(capture_result.path, std::ios::binary | std::ios::trunc);
+
+    file.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(encoded.size()));
+
+    if (!file)
+    {
+        LOG_ERROR(capture, "Failed to write '{}'.", capture_result.path.string());
+
+        return;
+    }
+
+    captured_.fetch_add(1, std::memory_order_relaxed);
+
+    LOG_DEBUG(capture, "Wrote frame {} to '{}' ({} bytes, pixel hash {:016x}).", frame, capture_result.path.string(), encoded.size(), capture_result.pixel_hash);
+
+    if (callback_)
+    {
+        callback_(capture_result);
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#include "core/core.h"
+
+#include <array>
+#include <filesystem>
+#include <functional>
+
+// Copies of rendered frames written to disk without stalling the frame loop.
+// A frame is copied into one of RING_SIZE persistently mapped host buffers by its own command
+// buffer. Once the frame timeline passes that frame, collect() hands the buffer to a worker, which
+// converts the pixels, frees the buffer and encodes and writes the file. When every buffer is
+// still in use the capture is dropped and counted instead of waiting.
+// Frames are captured from the thread recording them, the workers only touch the buffers handed to them.
+class frame_capture
+{
+public:
+    constexpr static std::size_t RING_SIZE = 3;
+    constexpr static std::size_t WORKER_COUNT = 2;
+
+    enum class file_format
+    {
+        qoi,
+        png
+    };
+
+    struct result
+    {
+        std::uint64_t frame{ 0 };
+        std::filesystem::path path;
+        std::uint32_t width{ 0 };
+        std::uint32_t height{ 0 };
+        std::uint64_t pixel_hash{ 0 };
+    };
+
+    // Called by the workers once a file was written.
+    using result_callback = std::function<void(const result&)>;
+
+    frame_capture(vk::Device device, vk::PhysicalDevice physical_device, const vk::DispatchLoaderDynamic& dispatch,
+        std::filesystem::path directory, file_format format, result_callback callback = {});
+    ~frame_capture();
+
+    frame_capture(const frame_capture&) = delete;
+    frame_capture& operator=(const frame_capture&) = delete;
+
+    // 8 bit RGBA and BGRA images can be captured.
+    static bool supports(vk::Format format);
+
+    // A free buffer for the frame, or nothing when they are all being read back or encoded.
+    std::optional<std::size_t> begin(std::uint64_t frame, const vk::Extent2D& extent, vk::Format format);
+
+    vk::Buffer buffer(std::size_t slot) const { return slots_[slot].buffer; }
+    vk::DeviceSize buffer_size(std::size_t slot) const { return slots_[slot].size; }
+
+    // The copy into the buffer is part of the submission signaling timeline_value.
+    void recorded(std::size_t slot, std::uint64_t timeline_value);
+
+    // Hands the buffers of the frames up to completed to the workers.
+    void collect(std::uint64_t completed);
+
+    // Waits until the files of the collected frames are written and stops the workers.
+    void stop();
+
+    // Destroys the buffers, the GPU and the workers must be done with them (collect() and stop()).
+    void destroy();
+
+    std::uint64_t captured() const { return captured_.load(std::memory_order_relaxed); }
+    std::uint64_t dropped() const { return dropped_; }
+
+private:
+    enum class slot_state
+    {
+        available,
+        recorded,
+        encoding
+    };
+
+    struct slot
+    {
+        std::atomic<slot_state> state{ slot_state::available };
+
+        vk::Buffer buffer{ nullptr };
+        vk::DeviceMemory memory{ nullptr };
+        vk::DeviceSize size{ 0 };
+        const std::uint8_t* mapped{ nullptr };
+
+        std::uint64_t frame{ 0 };
+        std::uint64_t timeline_value{ 0 };
+        vk::Extent2D extent{};
+        vk::Format format{ vk::Format::eUndefined };
+    };
+
+    struct job
+    {
+        // RING_SIZE stops the worker.
+        std::size_t slot{ RING_SIZE };
+    };
+
+    void create_buffer_(slot& p_slot, vk::DeviceSize size);
+    void destroy_buffer_(slot& p_slot);
+
+    void worker_entrypoint_();
+    void encode_(slot& p_slot);
+
+    vk::Device device_{ nullptr };
+    const vk::DispatchLoaderDynamic& dispatch_;
+
+    vk::PhysicalDeviceMemoryProperties memory_properties_{};
+    bool coherent_{ true };
+
+    std::filesystem::path directory_;
+    file_format format_;
+    result_callback callback_;
+
+    std::array<slot, RING_SIZE> slots_;
+
+    std::uint64_t dropped_{ 0 };
+    std::atomic<std::uint64_t> captured_{ 0 };
+
+    moodycamel::BlockingConcurrentQueue<job> jobs_;
+
+    std::vector<std::thread> workers_;
+};
+
+#endif
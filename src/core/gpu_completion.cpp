@@ -0,0 +1,249 @@
+#include "gpu_completion.h"
+
+gpu_completion::gpu_completion(vk::Device device, const vk::DispatchLoaderDynamic& dispatch, vk::Semaphore timeline,
+    std::chrono::milliseconds hang_timeout, hang_handler on_hang)
+    : device_(device), dispatch_(dispatch), timeline_(timeline), hang_timeout_(hang_timeout), on_hang_(std::move(on_hang))
+{
+    vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> chain{};
+
+    chain.get<vk::SemaphoreTypeCreateInfo>()
+        .setSemaphoreType(vk::SemaphoreType::eTimeline)
+        .setInitialValue(0);
+
+    auto result = device_.createSemaphore(&chain.get<vk::SemaphoreCreateInfo>(), nullptr, &wake_timeline_, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to create wake timeline semaphore.");
+
+    std::uint64_t value{ 0 };
+
+    result = device_.getSemaphoreCounterValue(timeline_, &value, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to get timeline semaphore value.");
+
+    completed_.store(value, std::memory_order_release);
+
+    waiter_ = std::thread([this]() { this->waiter_entrypoint_(); });
+    watchdog_ = std::thread([this]() { this->watchdog_entrypoint_(); });
+}
+
+gpu_completion::~gpu_completion()
+{
+    stop();
+
+    device_.destroySemaphore(wake_timeline_, nullptr, dispatch_);
+}
+
+void gpu_completion::on_complete(std::uint64_t value, callback p_callback)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const auto completed = completed_.load(std::memory_order_relaxed);
+
+    if (value <= completed)
+    {
+        lock.unlock();
+
+        p_callback(completed);
+
+        return;
+    }
+
+    if (requests_.empty())
+    {
+        last_progress_ = std::chrono::steady_clock::now();
+    }
+
+    requests_.emplace(value, std::move(p_callback));
+
+    requests_changed_.notify_one();
+
+    // The waiter is blocked on a later value.
+    if (waiting_for_ > value)
+    {
+        wake_();
+    }
+}
+
+std::future<std::uint64_t> gpu_completion::when_complete(std::uint64_t value)
+{
+    auto promise = std::make_shared<std::promise<std::uint64_t>>();
+
+    auto future = promise->get_future();
+
+    on_complete(value, [promise](std::uint64_t completed) { promise->set_value(completed); });
+
+    return future;
+}
+
+std::chrono::duration<float, std::milli> gpu_completion::wait(std::uint64_t value)
+{
+    if (value <= completed())
+    {
+        return std::chrono::duration<float, std::milli>{ 0.0f };
+    }
+
+    const auto wait_start = std::chrono::steady_clock::now();
+
+    // Also returns when stop() dropped the request.
+    when_complete(value).wait();
+
+    return std::chrono::steady_clock::now() - wait_start;
+}
+
+void gpu_completion::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (stopping_)
+        {
+            return;
+        }
+
+        stopping_ = true;
+
+        requests_changed_.notify_one();
+        stopped_.notify_one();
+
+        wake_();
+    }
+
+    waiter_.join();
+    watchdog_.join();
+
+    requests_.clear();
+}
+
+void gpu_completion::wake_()
+{
+    vk::SemaphoreSignalInfo signal_info{};
+
+    signal_info
+        .setSemaphore(wake_timeline_)
+        .setValue(++wake_value_);
+
+    const auto result = device_.signalSemaphore(&signal_info, dispatch_);
+
+    EVK_ASSERT_RESULT(result, "Failed to signal wake timeline semaphore.");
+}
+
+void gpu_completion::waiter_entrypoint_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+        requests_changed_.wait(lock, [this]() { return stopping_ || !requests_.empty(); });
+
+        if (stopping_)
+        {
+            return;
+        }
+
+        // A wake after the values are taken leaves the wake timeline past its value, nothing is missed.
+        const vk::Semaphore semaphores[2] = { timeline_, wake_timeline_ };
+        const std::uint64_t values[2] = { requests_.begin()->first, wake_value_ + 1 };
+
+        waiting_for_ = values[0];
+
+        lock.unlock();
+
+        vk::SemaphoreWaitInfo wait_info{};
+
+        wait_info
+            .setFlags(vk::SemaphoreWaitFlagBits::eAny)
+            .setSemaphoreCount(2)
+            .setPSemaphores(semaphores)
+            .setPValues(values);
+
+        // Without a timeout, the watchdog reports waits that take too long.
+        auto result = device_.waitSemaphores(&wait_info, std::numeric_limits<std::uint64_t>::max(), dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to wait for the timeline semaphore.");
+
+        std::uint64_t value{ 0 };
+
+        result = device_.getSemaphoreCounterValue(timeline_, &value, dispatch_);
+
+        EVK_ASSERT_RESULT(result, "Failed to get timeline semaphore value.");
+
+        lock.lock();
+
+        waiting_for_ = 0;
+
+        if (value > completed_.load(std::memory_order_relaxed))
+        {
+            completed_.store(value, std::memory_order_release);
+
+            last_progress_ = std::chrono::steady_clock::now();
+        }
+
+        const auto done_end = requests_.upper_bound(value);
+
+        std::vector<callback> done;
+
+        for (auto it = requests_.begin(); it != done_end; ++it)
+        {
+            done.push_back(std::move(it->second));
+        }
+
+        requests_.erase(requests_.begin(), done_end);
+
+        if (done.empty())
+        {
+            continue;
+        }
+
+        LOG_TRACE_EVERY_N(gpu, 100, "Timeline reached {}, {} request(s) done.", value, done.size());
+
+        // The callbacks may ask for more.
+        lock.unlock();
+
+        for (auto& current_callback : done)
+        {
+            current_callback(value);
+        }
+
+        lock.lock();
+    }
+}
+
+void gpu_completion::watchdog_entrypoint_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (!stopped_.wait_for(lock, WATCHDOG_INTERVAL, [this]() { return stopping_; }))
+    {
+        if (requests_.empty())
+        {
+            continue;
+        }
+
+        const auto stalled = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - last_progress_);
+
+        if (stalled < WATCHDOG_INTERVAL)
+        {
+            continue;
+        }
+
+        const auto value = requests_.begin()->first;
+
+        if (stalled >= hang_timeout_)
+        {
+            lock.unlock();
+
+            on_hang_(value, stalled);
+
+            return;
+        }
+
+        if (value == warned_value_)
+        {
+            continue;
+        }
+
+        warned_value_ = value;
+
+        LOG_WARN(gpu, "Waited for timeline value {} for {} millisecond(s) now, the GPU is at {}.", value, stalled.count(), completed());
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef GPU_COMPLETION_H_
+#define GPU_COMPLETION_H_
+
+#include "core/core.h"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+// Tells when the GPU reached values of a timeline semaphore, without the threads asking sleeping in the driver.
+// The waiter thread blocks on the timeline for the lowest value asked for, then runs the callbacks
+// and fulfills the futures of every value up to the one reached. A second timeline, signaled from
+// the host, wakes it early for lower values and for stopping.
+// The watchdog thread checks every WATCHDOG_INTERVAL, warns once per value when nothing completed
+// for an interval while it is waited for, and calls the hang handler once that lasted hang_timeout.
+class gpu_completion
+{
+public:
+    constexpr static std::chrono::milliseconds WATCHDOG_INTERVAL{ 50 };
+
+    // Called on the waiter thread with the value the timeline reached.
+    using callback = std::function<void(std::uint64_t completed)>;
+
+    // Called on the watchdog thread with the lowest value waited for, the watchdog stops afterwards.
+    using hang_handler = std::function<void(std::uint64_t value, std::chrono::milliseconds stalled)>;
+
+    gpu_completion(vk::Device device, const vk::DispatchLoaderDynamic& dispatch, vk::Semaphore timeline,
+        std::chrono::milliseconds hang_timeout, hang_handler on_hang);
+    ~gpu_completion();
+
+    gpu_completion(const gpu_completion&) = delete;
+    gpu_completion& operator=(const gpu_completion&) = delete;
+
+    // Right away (on the calling thread) when the value was already reached.
+    void on_complete(std::uint64_t value, callback p_callback);
+
+    std::future<std::uint64_t> when_complete(std::uint64_t value);
+
+    // Blocks the calling thread until the value is reached, returns how long it was blocked.
+    std::chrono::duration<float, std::milli> wait(std::uint64_t value);
+
+    // The last value the waiter thread saw the timeline reach.
+    std::uint64_t completed() const { return completed_.load(std::memory_order_acquire); }
+
+    // Stops both threads, callbacks of values not reached by then are dropped.
+    void stop();
+
+private:
+    void wake_();
+
+    void waiter_entrypoint_();
+    void watchdog_entrypoint_();
+
+    vk::Device device_{ nullptr };
+    const vk::DispatchLoaderDynamic& dispatch_;
+
+    vk::Semaphore timeline_{ nullptr };
+    vk::Semaphore wake_timeline_{ nullptr };
+
+    std::chrono::milliseconds hang_timeout_;
+    hang_handler on_hang_;
+
+    std::atomic<std::uint64_t> completed_{ 0 };
+
+    // Everything below is guarded by mutex_.
+    std::mutex mutex_;
+    std::condition_variable requests_changed_;
+    std::condition_variable stopped_;
+
+    std::multimap<std::uint64_t, callback> requests_;
+
+    // The value the waiter thread is blocked on in the driver, 0 when it isn't.
+    std::uint64_t waiting_for_{ 0 };
+    std::uint64_t wake_value_{ 0 };
+
+    // Since when nothing completed while values are waited for.
+    std::chrono::steady_clock::time_point last_progress_{};
+
+    // The stalled value the watchdog warned about, watchdog thread only.
+    std::uint64_t warned_value_{ 0 };
+
+    bool stopping_{ false };
+
+    std::thread waiter_;
+    std::thread watchdog_;
+};
+
+#endif
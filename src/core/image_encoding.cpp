@@ -0,0 +1,245 @@
+#include "image_encoding.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace
+{
+
+void put_u32_be(std::vector<std::uint8_t>& out, std::uint32_t value)
+{
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+struct crc32_table
+{
+    std::array<std::uint32_t, 256> entries{};
+
+    crc32_table()
+    {
+        for (std::uint32_t index = 0; index < 256; ++index)
+        {
+            std::uint32_t value = index;
+
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+            }
+
+            entries[index] = value;
+        }
+    }
+};
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0)
+{
+    static const crc32_table table;
+
+    crc = ~crc;
+
+    for (std::size_t index = 0; index < size; ++index)
+    {
+        crc = table.entries[(crc ^ data[index]) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+void put_png_chunk(std::vector<std::uint8_t>& out, const char* type, const std::uint8_t* data, std::size_t size)
+{
+    put_u32_be(out, static_cast<std::uint32_t>(size));
+
+    const auto type_offset = out.size();
+
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+
+    put_u32_be(out, crc32(out.data() + type_offset, size + 4));
+}
+
+}
+
+std::vector<std::uint8_t> encode_qoi(const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height)
+{
+    constexpr std::uint8_t OP_INDEX = 0x00;
+    constexpr std::uint8_t OP_DIFF = 0x40;
+    constexpr std::uint8_t OP_LUMA = 0x80;
+    constexpr std::uint8_t OP_RUN = 0xc0;
+    constexpr std::uint8_t OP_RGB = 0xfe;
+    constexpr std::uint8_t OP_RGBA = 0xff;
+
+    const std::size_t pixel_count = std::size_t{ width } * height;
+
+    std::vector<std::uint8_t> out;
+
+    out.reserve(14 + pixel_count * 2 + 8);
+
+    out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+    put_u32_be(out, width);
+    put_u32_be(out, height);
+    out.push_back(4); // channels
+    out.push_back(0); // sRGB with linear alpha
+
+    std::array<std::array<std::uint8_t, 4>, 64> index{};
+    std::array<std::uint8_t, 4> previous{ 0, 0, 0, 255 };
+    std::uint8_t run{ 0 };
+
+    for (std::size_t pixel_index = 0; pixel_index < pixel_count; ++pixel_index)
+    {
+        std::array<std::uint8_t, 4> pixel;
+
+        std::memcpy(pixel.data(), rgba + pixel_index * 4, 4);
+
+        if (pixel == previous)
+        {
+            run++;
+
+            if (run == 62 || pixel_index + 1 == pixel_count)
+            {
+                out.push_back(OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            continue;
+        }
+
+        if (run > 0)
+        {
+            out.push_back(OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        const auto hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+
+        if (index[hash] == pixel)
+        {
+            out.push_back(static_cast<std::uint8_t>(OP_INDEX | hash));
+        }
+        else
+        {
+            index[hash] = pixel;
+
+            if (pixel[3] == previous[3])
+            {
+                const auto vr = static_cast<std::int8_t>(pixel[0] - previous[0]);
+                const auto vg = static_cast<std::int8_t>(pixel[1] - previous[1]);
+                const auto vb = static_cast<std::int8_t>(pixel[2] - previous[2]);
+
+                const auto vg_r = vr - vg;
+                const auto vg_b = vb - vg;
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                {
+                    out.push_back(static_cast<std::uint8_t>(OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+                }
+                else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+                {
+                    out.push_back(static_cast<std::uint8_t>(OP_LUMA | (vg + 32)));
+                    out.push_back(static_cast<std::uint8_t>((vg_r + 8) << 4 | (vg_b + 8)));
+                }
+                else
+                {
+                    out.insert(out.end(), { OP_RGB, pixel[0], pixel[1], pixel[2] });
+                }
+            }
+            else
+            {
+                out.insert(out.end(), { OP_RGBA, pixel[0], pixel[1], pixel[2], pixel[3] });
+            }
+        }
+
+        previous = pixel;
+    }
+
+    out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+
+    return out;
+}
+
+std::vector<std::uint8_t> encode_png(const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height)
+{
+    constexpr std::size_t MAX_STORED_BLOCK = 65535;
+
+    const std::size_t row_size = std::size_t{ width } * 4;
+
+    // Every row starts with its filter type, 0 (none).
+    std::vector<std::uint8_t> raw;
+
+    raw.reserve((row_size + 1) * height);
+
+    for (std::uint32_t row = 0; row < height; ++row)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba + row * row_size, rgba + (row + 1) * row_size);
+    }
+
+    std::vector<std::uint8_t> zlib;
+
+    zlib.reserve(raw.size() + raw.size() / MAX_STORED_BLOCK * 5 + 16);
+
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    std::size_t offset{ 0 };
+
+    do
+    {
+        const auto size = std::min(MAX_STORED_BLOCK, raw.size() - offset);
+        const bool last = offset + size == raw.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<std::uint8_t>(size));
+        zlib.push_back(static_cast<std::uint8_t>(size >> 8));
+        zlib.push_back(static_cast<std::uint8_t>(~size));
+        zlib.push_back(static_cast<std::uint8_t>(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+
+        offset += size;
+    }
+    while (offset < raw.size());
+
+    std::uint32_t adler_a{ 1 };
+    std::uint32_t adler_b{ 0 };
+
+    for (const auto byte : raw)
+    {
+        adler_a = (adler_a + byte) % 65521;
+        adler_b = (adler_b + adler_a) % 65521;
+    }
+
+    put_u32_be(zlib, adler_b << 16 | adler_a);
+
+    std::vector<std::uint8_t> out{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    std::vector<std::uint8_t> header;
+
+    put_u32_be(header, width);
+    put_u32_be(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bit RGBA, deflate, no filtering, no interlace
+
+    out.reserve(zlib.size() + 64);
+
+    put_png_chunk(out, "IHDR", header.data(), header.size());
+    put_png_chunk(out, "IDAT", zlib.data(), zlib.size());
+    put_png_chunk(out, "IEND", nullptr, 0);
+
+    return out;
+}
+
+std::uint64_t hash_pixels(const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height)
+{
+    std::uint64_t hash{ 0xcbf29ce484222325ull };
+
+    const std::size_t size = std::size_t{ width } * height * 4;
+
+    for (std::size_t index = 0; index < size; ++index)
+    {
+        hash = (hash ^ rgba[index]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
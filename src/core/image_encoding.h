@@ -0,0 +1,19 @@
+#ifndef IMAGE_ENCODING_H_
+#define IMAGE_ENCODING_H_
+
+#include <cstdint>
+#include <vector>
+
+// Encoders for tightly packed 8 bit RGBA pixels, for the frame captures.
+
+// QOI (https://qoiformat.org), fast and reasonably small.
+std::vector<std::uint8_t> encode_qoi(const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height);
+
+// PNG with stored (uncompressed) deflate blocks, there is no zlib in the tree. Big, but every
+// image viewer and diff tool reads it.
+std::vector<std::uint8_t> encode_png(const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height);
+
+// FNV-1a of the pixels, compared against golden values by the regression runs.
+std::uint64_t hash_pixels(const std::uint8_t* rgba, std::uint32_t width, std::uint32_t height);
+
+#endif
@@ -0,0 +1,54 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+void latency_histogram::add(std::chrono::duration<float, std::milli> latency)
+{
+    const auto milliseconds = std::max(latency.count(), 0.0f);
+
+    const auto bucket = std::min(static_cast<std::size_t>(milliseconds / BUCKET_WIDTH_MS), BUCKET_COUNT - 1);
+
+    buckets_[bucket]++;
+
+    min_ = count_ == 0 ? milliseconds : std::min(min_, milliseconds);
+    max_ = std::max(max_, milliseconds);
+    sum_ += milliseconds;
+
+    count_++;
+}
+
+void latency_histogram::reset()
+{
+    *this = latency_histogram{};
+}
+
+float latency_histogram::mean() const
+{
+    return count_ == 0 ? 0.0f : static_cast<float>(sum_ / static_cast<double>(count_));
+}
+
+float latency_histogram::percentile(float fraction) const
+{
+    if (count_ == 0)
+    {
+        return 0.0f;
+    }
+
+    const auto rank = std::clamp<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(fraction * static_cast<double>(count_))), 1, count_);
+
+    std::uint64_t seen{ 0 };
+
+    for (std::size_t index = 0; index < BUCKET_COUNT; ++index)
+    {
+        seen += buckets_[index];
+
+        if (seen >= rank)
+        {
+            // The overflow bucket has no upper edge, the maximum is in there.
+            return index == BUCKET_COUNT - 1 ? max_ : std::min(static_cast<float>(index + 1) * BUCKET_WIDTH_MS, max_);
+        }
+    }
+
+    return max_;
+}
@@ -0,0 +1,41 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Counts of latencies in BUCKET_WIDTH_MS wide buckets, the last bucket also holds everything longer.
+// Adding is constant time without allocating, so it runs every frame. The percentiles are the
+// upper edges of the buckets they fall in, count, mean, min and max are exact.
+class latency_histogram
+{
+public:
+    constexpr static std::size_t BUCKET_COUNT = 200;
+    constexpr static float BUCKET_WIDTH_MS = 1.0f;
+
+    void add(std::chrono::duration<float, std::milli> latency);
+
+    void reset();
+
+    std::uint64_t count() const { return count_; }
+
+    float mean() const;
+    float min() const { return count_ == 0 ? 0.0f : min_; }
+    float max() const { return max_; }
+
+    // Nearest rank, 0 when empty.
+    float percentile(float fraction) const;
+
+    const std::array<std::uint64_t, BUCKET_COUNT>& buckets() const { return buckets_; }
+
+private:
+    std::array<std::uint64_t, BUCKET_COUNT> buckets_{};
+
+    std::uint64_t count_{ 0 };
+    double sum_{ 0.0 };
+    float min_{ 0.0f };
+    float max_{ 0.0f };
+};
+
+#endif
@@ -0,0 +1,1057 @@
+#include "render_graph.h"
+
+namespace
+{
+
+struct usage_info
+{
+    vk::PipelineStageFlags stages{};
+    vk::AccessFlags read_access{};
+    vk::AccessFlags write_access{};
+    vk::ImageLayout read_layout{ vk::ImageLayout::eUndefined };
+    vk::ImageLayout write_layout{ vk::ImageLayout::eUndefined };
+    vk::ImageUsageFlags image_usage{};
+    vk::BufferUsageFlags buffer_usage{};
+};
+
+constexpr vk::AccessFlags WRITE_ACCESS =
+    vk::AccessFlagBits::eShaderWrite |
+    vk::AccessFlagBits::eColorAttachmentWrite |
+    vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+    vk::AccessFlagBits::eTransferWrite |
+    vk::AccessFlagBits::eHostWrite |
+    vk::AccessFlagBits::eMemoryWrite;
+
+constexpr vk::ImageUsageFlags ATTACHMENT_USAGE =
+    vk::ImageUsageFlagBits::eColorAttachment |
+    vk::ImageUsageFlagBits::eDepthStencilAttachment |
+    vk::ImageUsageFlagBits::eInputAttachment;
+
+usage_info get_usage_info(render_graph::usage how)
+{
+    using stage = vk::PipelineStageFlagBits;
+    using access = vk::AccessFlagBits;
+    using layout = vk::ImageLayout;
+
+    const vk::PipelineStageFlags shader_stages = stage::eVertexShader | stage::eFragmentShader | stage::eComputeShader;
+    const vk::PipelineStageFlags fragment_tests = stage::eEarlyFragmentTests | stage::eLateFragmentTests;
+
+    switch (how)
+    {
+    case render_graph::usage::color_attachment:
+        return { stage::eColorAttachmentOutput, access::eColorAttachmentRead, access::eColorAttachmentRead | access::eColorAttachmentWrite,
+            layout::eColorAttachmentOptimal, layout::eColorAttachmentOptimal, vk::ImageUsageFlagBits::eColorAttachment, {} };
+    case render_graph::usage::depth_attachment:
+        return { fragment_tests, access::eDepthStencilAttachmentRead, access::eDepthStencilAttachmentRead | access::eDepthStencilAttachmentWrite,
+            layout::eDepthStencilReadOnlyOptimal, layout::eDepthStencilAttachmentOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, {} };
+    case render_graph::usage::sampled:
+        return { shader_stages, access::eShaderRead, {},
+            layout::eShaderReadOnlyOptimal, layout::eUndefined, vk::ImageUsageFlagBits::eSampled, {} };
+    case render_graph::usage::storage:
+        return { shader_stages, access::eShaderRead, access::eShaderRead | access::eShaderWrite,
+            layout::eGeneral, layout::eGeneral, vk::ImageUsageFlagBits::eStorage, vk::BufferUsageFlagBits::eStorageBuffer };
+    case render_graph::usage::transfer_src:
+        return { stage::eTransfer, access::eTransferRead, {},
+            layout::eTransferSrcOptimal, layout::eUndefined, vk::ImageUsageFlagBits::eTransferSrc, vk::BufferUsageFlagBits::eTransferSrc };
+    case render_graph::usage::transfer_dst:
+        return { stage::eTransfer, {}, access::eTransferWrite,
+            layout::eUndefined, layout::eTransferDstOptimal, vk::ImageUsageFlagBits::eTransferDst, vk::BufferUsageFlagBits::eTransferDst };
+    case render_graph::usage::vertex_buffer:
+        return { stage::eVertexInput, access::eVertexAttributeRead, {},
+            layout::eUndefined, layout::eUndefined, {}, vk::BufferUsageFlagBits::eVertexBuffer };
+    case render_graph::usage::index_buffer:
+        return { stage::eVertexInput, access::eIndexRead, {},
+            layout::eUndefined, layout::eUndefined, {}, vk::BufferUsageFlagBits::eIndexBuffer };
+    case render_graph::usage::uniform_buffer:
+        return { shader_stages, access::eUniformRead, {},
+            layout::eUndefined, layout::eUndefined, {}, vk::BufferUsageFlagBits::eUniformBuffer };
+    case render_graph::usage::indirect_buffer:
+        return { stage::eDrawIndirect, access::eIndirectCommandRead, {},
+            layout::eUndefined, layout::eUndefined, {}, vk::BufferUsageFlagBits::eIndirectBuffer };
+    }
+
+    return {};
+}
+
+vk::ImageAspectFlags get_aspect(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+        return vk::ImageAspectFlagBits::eDepth;
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+    case vk::Format::eS8Uint:
+        return vk::ImageAspectFlagBits::eStencil;
+    default:
+        return vk::ImageAspectFlagBits::eColor;
+    }
+}
+
+}
+
+render_graph::pass_builder& render_graph::pass_builder::color_attachment(resource image, std::optional<vk::ClearColorValue> clear)
+{
+    graph_.add_access_(pass_index_, image, usage::color_attachment, true);
+
+    auto& new_attachment = graph_.passes_[pass_index_].attachments.emplace_back();
+
+    new_attachment.target = image;
+
+    if (clear)
+    {
+        new_attachment.clear = vk::ClearValue{ clear.value() };
+    }
+
+    return *this;
+}
+
+render_graph::pass_builder& render_graph::pass_builder::depth_attachment(resource image, std::optional<vk::ClearDepthStencilValue> clear)
+{
+    graph_.add_access_(pass_index_, image, usage::depth_attachment, true);
+
+    auto& new_attachment = graph_.passes_[pass_index_].attachments.emplace_back();
+
+    new_attachment.target = image;
+    new_attachment.depth = true;
+
+    if (clear)
+    {
+        vk::ClearValue clear_value{};
+
+        clear_value.setDepthStencil(clear.value());
+
+        new_attachment.clear = clear_value;
+    }
+
+    return *this;
+}
+
+render_graph::pass_builder& render_graph::pass_builder::read(resource target, usage how)
+{
+    graph_.add_access_(pass_index_, target, how, false);
+
+    return *this;
+}
+
+render_graph::pass_builder& render_graph::pass_builder::write(resource target, usage how)
+{
+    graph_.add_access_(pass_index_, target, how, true);
+
+    return *this;
+}
+
+render_graph::pass_builder& render_graph::pass_builder::render_area(const vk::Rect2D& area)
+{
+    graph_.passes_[pass_index_].render_area = area;
+
+    return *this;
+}
+
+render_graph::pass_builder& render_graph::pass_builder::side_effect()
+{
+    graph_.passes_[pass_index_].side_effect = true;
+
+    return *this;
+}
+
+bool render_graph::transient_key::operator==(const transient_key& other) const
+{
+    return image == other.image
+        && format == other.format
+        && extent == other.extent
+        && image_usage == other.image_usage
+        && size == other.size
+        && buffer_usage == other.buffer_usage
+        && first_use == other.first_use
+        && last_use == other.last_use;
+}
+
+render_graph::render_graph(vk::Device device, vk::PhysicalDevice physical_device, const vk::DispatchLoaderDynamic& dispatch, deletion_queue& p_deletion_queue, bool dynamic_rendering)
+    : device_(device), dispatch_(dispatch), deletion_queue_(p_deletion_queue), dynamic_rendering_(dynamic_rendering)
+{
+    memory_properties_ = physical_device.getMemoryProperties(dispatch_);
+}
+
+void render_graph::reset()
+{
+    passes_.clear();
+    resources_.clear();
+    steps_.clear();
+    final_barriers_ = barrier_batch{};
+    culled_pass_count_ = 0;
+}
+
+render_graph::resource render_graph::import_image(std::string name, vk::Image image, vk::ImageView image_view, const image_desc& desc, const external_state& initial, const external_state& final)
+{
+    resource_entry entry{};
+
+    entry.name = std::move(name);
+    entry.imported = true;
+    entry.image_info = desc;
+    entry.initial = initial;
+    entry.final = final;
+    entry.image_handle = image;
+    entry.image_view_handle = image_view;
+
+    return add_resource_(std::move(entry));
+}
+
+render_graph::resource render_graph::import_buffer(std::string name, vk::Buffer buffer, vk::DeviceSize size, const external_state& initial, const external_state& final)
+{
+    resource_entry entry{};
+
+    entry.name = std::move(name);
+    entry.image = false;
+    entry.imported = true;
+    entry.buffer_info.size = size;
+    entry.initial = initial;
+    entry.final = final;
+    entry.buffer_handle = buffer;
+
+    return add_resource_(std::move(entry));
+}
+
+render_graph::resource render_graph::create_image(std::string name, const image_desc& desc)
+{
+    resource_entry entry{};
+
+    entry.name = std::move(name);
+    entry.image_info = desc;
+
+    return add_resource_(std::move(entry));
+}
+
+render_graph::resource render_graph::create_buffer(std::string name, const buffer_desc& desc)
+{
+    resource_entry entry{};
+
+    entry.name = std::move(name);
+    entry.image = false;
+    entry.buffer_info = desc;
+
+    return add_resource_(std::move(entry));
+}
+
+render_graph::pass_builder render_graph::add_pass(std::string name, record_function record)
+{
+    auto& new_pass = passes_.emplace_back();
+
+    new_pass.name = std::move(name);
+    new_pass.record = std::move(record);
+
+    return pass_builder{ *this, passes_.size() - 1 };
+}
+
+void render_graph::compile(std::uint64_t last_use)
+{
+    for (const auto& graph_pass : passes_)
+    {
+        if (!graph_pass.attachments.empty() && !dynamic_rendering_)
+        {
+            throw_exception(fmt::format("Render graph pass '{}' has attachments, those need dynamic rendering.", graph_pass.name));
+        }
+    }
+
+    cull_();
+    sort_();
+    allocate_transients_(last_use);
+    place_barriers_();
+}
+
+void render_graph::execute(const vk::CommandBuffer& cmd_buffer)
+{
+    std::vector<vk::RenderingAttachmentInfoKHR> color_attachments;
+
+    for (const auto& current_step : steps_)
+    {
+        emit_(cmd_buffer, current_step.barriers);
+
+        const auto& graph_pass = passes_[current_step.pass_index];
+
+        if (graph_pass.attachments.empty())
+        {
+            graph_pass.record(pass_context{ cmd_buffer, *this, vk::Rect2D{} });
+
+            continue;
+        }
+
+        color_attachments.clear();
+
+        vk::RenderingAttachmentInfoKHR depth_attachment{};
+        bool has_depth{ false };
+
+        for (const auto& pass_attachment : graph_pass.attachments)
+        {
+            vk::RenderingAttachmentInfoKHR info{};
+
+            info
+                .setImageView(resource_(pass_attachment.target).image_view_handle)
+                .setImageLayout(pass_attachment.depth ? vk::ImageLayout::eDepthStencilAttachmentOptimal : vk::ImageLayout::eColorAttachmentOptimal)
+                .setLoadOp(pass_attachment.load_op)
+                .setStoreOp(pass_attachment.store_op);
+
+            if (pass_attachment.clear)
+            {
+                info.setClearValue(pass_attachment.clear.value());
+            }
+
+            if (pass_attachment.depth)
+            {
+                depth_attachment = info;
+                has_depth = true;
+            }
+            else
+            {
+                color_attachments.push_back(info);
+            }
+        }
+
+        vk::Rect2D render_area{};
+
+        render_area.setExtent(resource_(graph_pass.attachments.front().target).image_info.extent);
+
+        if (graph_pass.render_area)
+        {
+            render_area = graph_pass.render_area.value();
+        }
+
+        vk::RenderingInfoKHR rendering_info{};
+
+        rendering_info
+            .setRenderArea(render_area)
+            .setLayerCount(1)
+            .setColorAttachmentCount(static_cast<std::uint32_t>(color_attachments.size()))
+            .setPColorAttachments(color_attachments.data())
+            .setPDepthAttachment(has_depth ? &depth_attachment : nullptr);
+
+        cmd_buffer.beginRenderingKHR(rendering_info, dispatch_);
+
+        graph_pass.record(pass_context{ cmd_buffer, *this, render_area });
+
+        cmd_buffer.endRenderingKHR(dispatch_);
+    }
+
+    emit_(cmd_buffer, final_barriers_);
+}
+
+void render_graph::release(std::uint64_t last_use)
+{
+    for (const auto& objects : transient_objects_)
+    {
+        deletion_queue_.push(last_use, device_, objects.image_view, dispatch_);
+        deletion_queue_.push(last_use, device_, objects.image, dispatch_);
+        deletion_queue_.push(last_use, device_, objects.buffer, dispatch_);
+    }
+
+    for (const auto memory : transient_memory_)
+    {
+        deletion_queue_.push(last_use, [device = device_, memory, &dispatch = dispatch_]() { device.freeMemory(memory, nullptr, dispatch); });
+    }
+
+    transient_keys_.clear();
+    transient_objects_.clear();
+    transient_aliases_.clear();
+    transient_memory_.clear();
+}
+
+vk::Image render_graph::image(resource target) const
+{
+    return resource_(target).image_handle;
+}
+
+vk::ImageView render_graph::image_view(resource target) const
+{
+    return resource_(target).image_view_handle;
+}
+
+vk::Buffer render_graph::buffer(resource target) const
+{
+    return resource_(target).buffer_handle;
+}
+
+const render_graph::image_desc& render_graph::image_info(resource target) const
+{
+    return resource_(target).image_info;
+}
+
+render_graph::resource render_graph::add_resource_(resource_entry entry)
+{
+    resources_.push_back(std::move(entry));
+
+    return static_cast<resource>(resources_.size() - 1);
+}
+
+const render_graph::resource_entry& render_graph::resource_(resource target) const
+{
+    if (target >= resources_.size())
+    {
+        throw_exception(fmt::format("Unknown render graph resource {}.", target));
+    }
+
+    return resources_[target];
+}
+
+void render_graph::add_access_(std::size_t pass_index, resource target, usage how, bool write)
+{
+    auto& graph_pass = passes_[pass_index];
+
+    if (target >= resources_.size())
+    {
+        throw_exception(fmt::format("Render graph pass '{}' uses unknown resource {}.", graph_pass.name, target));
+    }
+
+    auto& entry = resources_[target];
+
+    const auto info = get_usage_info(how);
+
+    if (write ? !info.write_access : !info.read_access)
+    {
+        throw_exception(fmt::format("Render graph pass '{}' can't {} '{}' that way.", graph_pass.name, write ? "write" : "read", entry.name));
+    }
+
+    if (entry.image ? !info.image_usage : !info.buffer_usage)
+    {
+        throw_exception(fmt::format("Render graph pass '{}' uses '{}' in a way only {} can be used.", graph_pass.name, entry.name, entry.image ? "buffers" : "images"));
+    }
+
+    access new_access{};
+
+    new_access.target = target;
+    new_access.stages = info.stages;
+    new_access.access_mask = write ? info.write_access : info.read_access;
+    new_access.layout = entry.image ? (write ? info.write_layout : info.read_layout) : vk::ImageLayout::eUndefined;
+    new_access.write = write;
+
+    if (entry.image)
+    {
+        entry.image_info.usage |= info.image_usage;
+    }
+    else
+    {
+        entry.buffer_info.usage |= info.buffer_usage;
+    }
+
+    if (how != usage::color_attachment && how != usage::depth_attachment)
+    {
+        entry.attachment_only = false;
+    }
+
+    // One access per resource and pass, a pass can't have an image in two layouts at once.
+    for (auto& existing : graph_pass.accesses)
+    {
+        if (existing.target != target)
+        {
+            continue;
+        }
+
+        if (existing.layout != new_access.layout)
+        {
+            // A depth attachment that is read and written is in the writable layout.
+            if (how == usage::depth_attachment && (existing.layout == vk::ImageLayout::eDepthStencilReadOnlyOptimal || existing.layout == vk::ImageLayout::eDepthStencilAttachmentOptimal))
+            {
+                existing.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            }
+            else
+            {
+                throw_exception(fmt::format("Render graph pass '{}' uses '{}' in two layouts.", graph_pass.name, entry.name));
+            }
+        }
+
+        existing.stages |= new_access.stages;
+        existing.access_mask |= new_access.access_mask;
+        existing.write = existing.write || new_access.write;
+
+        return;
+    }
+
+    graph_pass.accesses.push_back(new_access);
+}
+
+void render_graph::cull_()
+{
+    // Reference counting from the outputs back: a pass is culled once nothing reads what it writes.
+    std::vector<std::uint32_t> pass_references(passes_.size(), 0);
+    std::vector<std::uint32_t> readers(resources_.size(), 0);
+
+    for (std::size_t pass_index = 0; pass_index < passes_.size(); ++pass_index)
+    {
+        passes_[pass_index].culled = false;
+
+        for (const auto& pass_access : passes_[pass_index].accesses)
+        {
+            if (pass_access.write)
+            {
+                pass_references[pass_index]++;
+            }
+            else
+            {
+                readers[pass_access.target]++;
+            }
+        }
+    }
+
+    // The imported resources are used after the graph.
+    for (std::size_t index = 0; index < resources_.size(); ++index)
+    {
+        if (resources_[index].imported)
+        {
+            readers[index]++;
+        }
+    }
+
+    std::vector<resource> unused;
+
+    auto cull_pass = [&](std::size_t pass_index) {
+        passes_[pass_index].culled = true;
+
+        for (const auto& pass_access : passes_[pass_index].accesses)
+        {
+            if (!pass_access.write && --readers[pass_access.target] == 0)
+            {
+                unused.push_back(pass_access.target);
+            }
+        }
+    };
+
+    // Before culling anything: cull_pass() queues the resources whose readers it takes to 0,
+    // every resource is queued once.
+    for (std::size_t index = 0; index < resources_.size(); ++index)
+    {
+        if (readers[index] == 0)
+        {
+            unused.push_back(static_cast<resource>(index));
+        }
+    }
+
+    for (std::size_t pass_index = 0; pass_index < passes_.size(); ++pass_index)
+    {
+        if (pass_references[pass_index] == 0 && !passes_[pass_index].side_effect)
+        {
+            cull_pass(pass_index);
+        }
+    }
+
+    while (!unused.empty())
+    {
+        const auto target = unused.back();
+
+        unused.pop_back();
+
+        for (std::size_t pass_index = 0; pass_index < passes_.size(); ++pass_index)
+        {
+            auto& graph_pass = passes_[pass_index];
+
+            if (graph_pass.culled)
+            {
+                continue;
+            }
+
+            for (const auto& pass_access : graph_pass.accesses)
+            {
+                if (pass_access.target == target && pass_access.write && --pass_references[pass_index] == 0 && !graph_pass.side_effect)
+                {
+                    cull_pass(pass_index);
+
+                    break;
+                }
+            }
+        }
+    }
+
+    culled_pass_count_ = static_cast<std::size_t>(std::count_if(passes_.begin(), passes_.end(), [](const pass& graph_pass) { return graph_pass.culled; }));
+}
+
+void render_graph::sort_()
+{
+    // A pass depends on the last pass before it writing what it uses, and a write on the reads
+    // before it. Ordered by dependency level, so independent passes get recorded between a
+    // producer and its consumers instead of right before the barrier waiting on the producer.
+    std::vector<std::size_t> last_writer(resources_.size(), std::numeric_limits<std::size_t>::max());
+    std::vector<std::uint32_t> read_level(resources_.size(), 0);
+
+    std::vector<std::size_t> order;
+
+    for (std::size_t pass_index = 0; pass_index < passes_.size(); ++pass_index)
+    {
+        auto& graph_pass = passes_[pass_index];
+
+        if (graph_pass.culled)
+        {
+            continue;
+        }
+
+        graph_pass.level = 0;
+
+        for (const auto& pass_access : graph_pass.accesses)
+        {
+            const auto writer = last_writer[pass_access.target];
+
+            if (writer != std::numeric_limits<std::size_t>::max())
+            {
+                graph_pass.level = std::max(graph_pass.level, passes_[writer].level + 1);
+            }
+
+            if (pass_access.write)
+            {
+                graph_pass.level = std::max(graph_pass.level, read_level[pass_access.target]);
+            }
+        }
+
+        for (const auto& pass_access : graph_pass.accesses)
+        {
+            if (pass_access.write)
+            {
+                last_writer[pass_access.target] = pass_index;
+                read_level[pass_access.target] = 0;
+            }
+            else
+            {
+                read_level[pass_access.target] = std::max(read_level[pass_access.target], graph_pass.level + 1);
+            }
+        }
+
+        order.push_back(pass_index);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) { return passes_[a].level < passes_[b].level; });
+
+    steps_.clear();
+
+    for (auto& entry : resources_)
+    {
+        entry.first_use = std::numeric_limits<std::size_t>::max();
+        entry.last_use = 0;
+    }
+
+    for (std::size_t position = 0; position < order.size(); ++position)
+    {
+        steps_.push_back(step{ order[position], barrier_batch{} });
+
+        for (const auto& pass_access : passes_[order[position]].accesses)
+        {
+            auto& entry = resources_[pass_access.target];
+
+            entry.first_use = std::min(entry.first_use, position);
+            entry.last_use = std::max(entry.last_use, position);
+        }
+    }
+}
+
+void render_graph::allocate_transients_(std::uint64_t last_use)
+{
+    std::vector<resource> transients;
+    std::vector<transient_key> keys;
+
+    for (std::size_t index = 0; index < resources_.size(); ++index)
+    {
+        auto& entry = resources_[index];
+
+        if (entry.imported || entry.first_use == std::numeric_limits<std::size_t>::max())
+        {
+            continue;
+        }
+
+        // Lazily allocated memory only backs images that are nothing but (transient) attachments.
+        entry.attachment_only = entry.attachment_only && entry.image && !(entry.image_info.usage & ~ATTACHMENT_USAGE);
+
+        if (entry.attachment_only)
+        {
+            entry.image_info.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+        }
+
+        transients.push_back(static_cast<resource>(index));
+
+        keys.push_back(transient_key{ entry.image, entry.image_info.format, entry.image_info.extent, entry.image_info.usage,
+            entry.buffer_info.size, entry.buffer_info.usage, entry.first_use, entry.last_use });
+    }
+
+    if (keys != transient_keys_)
+    {
+        release(last_use);
+
+        struct block
+        {
+            std::uint32_t memory_type{ 0 };
+            bool image{ true };
+            vk::DeviceSize size{ 0 };
+            std::vector<std::size_t> members;
+        };
+
+        std::vector<block> blocks;
+        std::vector<vk::MemoryRequirements> requirements(transients.size());
+        std::vector<std::uint32_t> memory_types(transients.size());
+
+        transient_objects_.resize(transients.size());
+        transient_aliases_.assign(transients.size(), std::numeric_limits<std::size_t>::max());
+
+        for (std::size_t index = 0; index < transients.size(); ++index)
+        {
+            const auto& entry = resources_[transients[index]];
+            auto& objects = transient_objects_[index];
+
+            vk::Result result;
+
+            if (entry.image)
+            {
+                vk::ImageCreateInfo create_info{};
+
+                create_info
+                    .setImageType(vk::ImageType::e2D)
+                    .setFormat(entry.image_info.format)
+                    .setExtent(vk::Extent3D{ entry.image_info.extent.width, entry.image_info.extent.height, 1 })
+                    .setMipLevels(1)
+                    .setArrayLayers(1)
+                    .setSamples(vk::SampleCountFlagBits::e1)
+                    .setTiling(vk::ImageTiling::eOptimal)
+                    .setUsage(entry.image_info.usage)
+                    .setSharingMode(vk::SharingMode::eExclusive)
+                    .setInitialLayout(vk::ImageLayout::eUndefined);
+
+                result = device_.createImage(&create_info, nullptr, &objects.image, dispatch_);
+
+                EVK_ASSERT_RESULT(result, fmt::format("Failed to create render graph image '{}'.", entry.name));
+
+                requirements[index] = device_.getImageMemoryRequirements(objects.image, dispatch_);
+            }
+            else
+            {
+                vk::BufferCreateInfo create_info{};
+
+                create_info
+                    .setSize(entry.buffer_info.size)
+                    .setUsage(entry.buffer_info.usage)
+                    .setSharingMode(vk::SharingMode::eExclusive);
+
+                result = device_.createBuffer(&create_info, nullptr, &objects.buffer, dispatch_);
+
+                EVK_ASSERT_RESULT(result, fmt::format("Failed to create render graph buffer '{}'.", entry.name));
+
+                requirements[index] = device_.getBufferMemoryRequirements(objects.buffer, dispatch_);
+            }
+
+            auto memory_type = std::numeric_limits<std::uint32_t>::max();
+
+            if (entry.attachment_only)
+            {
+                memory_type = find_memory_type_(requirements[index].memoryTypeBits, vk::MemoryPropertyFlagBits::eLazilyAllocated);
+            }
+
+            if (memory_type == std::numeric_limits<std::uint32_t>::max())
+            {
+                memory_type = find_memory_type_(requirements[index].memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+            }
+
+            if (memory_type == std::numeric_limits<std::uint32_t>::max())
+            {
+                memory_type = find_memory_type_(requirements[index].memoryTypeBits, vk::MemoryPropertyFlags{});
+            }
+
+            memory_types[index] = memory_type;
+        }
+
+        // Biggest first, each one goes into the first block of its memory type whose members are
+        // all dead before it starts or born after it ends. Everything is bound at offset 0.
+        std::vector<std::size_t> by_size(transients.size());
+
+        for (std::size_t index = 0; index < by_size.size(); ++index)
+        {
+            by_size[index] = index;
+        }
+
+        std::stable_sort(by_size.begin(), by_size.end(), [&](std::size_t a, std::size_t b) { return requirements[a].size > requirements[b].size; });
+
+        for (const auto index : by_size)
+        {
+            const auto& key = keys[index];
+
+            auto fits = [&](const block& candidate) {
+                if (candidate.memory_type != memory_types[index] || candidate.image != key.image)
+                {
+                    return false;
+                }
+
+                return std::all_of(candidate.members.begin(), candidate.members.end(), [&](std::size_t member) {
+                    return keys[member].last_use < key.first_use || key.last_use < keys[member].first_use;
+                });
+            };
+
+            auto found = std::find_if(blocks.begin(), blocks.end(), fits);
+
+            if (found == blocks.end())
+            {
+                found = blocks.insert(blocks.end(), block{ memory_types[index], key.image, 0, {} });
+            }
+
+            found->size = std::max(found->size, requirements[index].size);
+            found->members.push_back(index);
+        }
+
+        for (auto& memory_block : blocks)
+        {
+            vk::MemoryAllocateInfo allocate_info{};
+
+            allocate_info
+                .setAllocationSize(memory_block.size)
+                .setMemoryTypeIndex(memory_block.memory_type);
+
+            vk::DeviceMemory memory{ nullptr };
+
+            auto result = device_.allocateMemory(&allocate_info, nullptr, &memory, dispatch_);
+
+            EVK_ASSERT_RESULT(result, "Failed to allocate render graph memory.");
+
+            transient_memory_.push_back(memory);
+
+            std::sort(memory_block.members.begin(), memory_block.members.end(), [&](std::size_t a, std::size_t b) { return keys[a].first_use < keys[b].first_use; });
+
+            for (std::size_t member_index = 0; member_index < memory_block.members.size(); ++member_index)
+            {
+                const auto member = memory_block.members[member_index];
+                auto& objects = transient_objects_[member];
+
+                if (member_index > 0)
+                {
+                    transient_aliases_[member] = memory_block.members[member_index - 1];
+                }
+
+                if (objects.image)
+                {
+                    device_.bindImageMemory(objects.image, memory, 0, dispatch_);
+
+                    const auto& entry = resources_[transients[member]];
+
+                    vk::ImageViewCreateInfo create_info{};
+
+                    create_info
+                        .setImage(objects.image)
+                        .setViewType(vk::ImageViewType::e2D)
+                        .setFormat(entry.image_info.format)
+                        .setSubresourceRange(vk::ImageSubresourceRange{ get_aspect(entry.image_info.format), 0, 1, 0, 1 });
+
+                    result = device_.createImageView(&create_info, nullptr, &objects.image_view, dispatch_);
+
+                    EVK_ASSERT_RESULT(result, fmt::format("Failed to create render graph image view '{}'.", entry.name));
+                }
+                else
+                {
+                    device_.bindBufferMemory(objects.buffer, memory, 0, dispatch_);
+                }
+            }
+        }
+
+        transient_keys_ = keys;
+
+        LOG_DEBUG(render_graph, "Created {} transient resource(s) in {} allocation(s), {} pass(es) and {} culled.",
+            transients.size(), blocks.size(), passes_.size() - culled_pass_count_, culled_pass_count_);
+    }
+
+    for (std::size_t index = 0; index < transients.size(); ++index)
+    {
+        auto& entry = resources_[transients[index]];
+        const auto& objects = transient_objects_[index];
+
+        entry.image_handle = objects.image;
+        entry.image_view_handle = objects.image_view;
+        entry.buffer_handle = objects.buffer;
+        entry.alias_of = transient_aliases_[index] != std::numeric_limits<std::size_t>::max() ? transients[transient_aliases_[index]] : INVALID_RESOURCE;
+    }
+}
+
+void render_graph::place_barriers_()
+{
+    for (auto& entry : resources_)
+    {
+        entry.state = resource_state{};
+
+        if (entry.imported)
+        {
+            entry.state.layout = entry.initial.layout;
+            entry.state.write_stages = entry.initial.stages;
+            entry.state.write_access = entry.initial.access;
+        }
+    }
+
+    for (std::size_t position = 0; position < steps_.size(); ++position)
+    {
+        auto& current_step = steps_[position];
+        auto& graph_pass = passes_[current_step.pass_index];
+
+        for (auto& pass_attachment : graph_pass.attachments)
+        {
+            const auto& entry = resources_[pass_attachment.target];
+
+            const bool has_contents = entry.imported ? position != entry.first_use || entry.initial.layout != vk::ImageLayout::eUndefined : position != entry.first_use;
+
+            pass_attachment.load_op = pass_attachment.clear ? vk::AttachmentLoadOp::eClear : (has_contents ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eDontCare);
+            pass_attachment.store_op = entry.imported || position != entry.last_use ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+        }
+
+        for (const auto& pass_access : graph_pass.accesses)
+        {
+            auto& entry = resources_[pass_access.target];
+
+            // Memory taken over from another transient: wait for its last users, its contents are garbage.
+            if (position == entry.first_use && entry.alias_of != INVALID_RESOURCE)
+            {
+                const auto& previous = resources_[entry.alias_of].state;
+
+                entry.state.write_stages = previous.write_stages | previous.read_stages;
+                entry.state.write_access = previous.write_access;
+            }
+
+            synchronize_(entry, pass_access, current_step.barriers);
+        }
+    }
+
+    for (auto& entry : resources_)
+    {
+        if (!entry.imported || entry.first_use == std::numeric_limits<std::size_t>::max())
+        {
+            continue;
+        }
+
+        access final_access{};
+
+        final_access.stages = entry.final.stages;
+        final_access.access_mask = entry.final.access;
+        final_access.layout = entry.image && entry.final.layout != vk::ImageLayout::eUndefined ? entry.final.layout : entry.state.layout;
+
+        // Without a layout change and an access to make the writes visible to, the next user synchronizes by itself.
+        if (final_access.layout == entry.state.layout && !final_access.access_mask)
+        {
+            continue;
+        }
+
+        synchronize_(entry, final_access, final_barriers_);
+    }
+}
+
+void render_graph::synchronize_(resource_entry& entry, const access& p_access, barrier_batch& batch)
+{
+    auto& state = entry.state;
+
+    const bool layout_change = entry.image && state.layout != p_access.layout;
+
+    vk::PipelineStageFlags src_stages{};
+    vk::AccessFlags src_access{};
+    bool needed{ false };
+
+    if (p_access.write || layout_change)
+    {
+        // Write after write or read, or a layout transition: wait for everyone before it.
+        src_stages = state.write_stages | state.read_stages;
+        src_access = state.write_access;
+        needed = layout_change || src_stages;
+    }
+    else if (state.write_stages && ((p_access.stages & ~state.visible_stages) || (p_access.access_mask & ~state.visible_access)))
+    {
+        // Read after write, once per stage and access.
+        src_stages = state.write_stages;
+        src_access = state.write_access;
+        needed = true;
+    }
+
+    if (needed)
+    {
+        batch.src_stages |= src_stages ? src_stages : vk::PipelineStageFlags{ vk::PipelineStageFlagBits::eTopOfPipe };
+        batch.dst_stages |= p_access.stages;
+
+        // Write after read only needs the execution dependency of the stage masks.
+        if (entry.image && (layout_change || src_access))
+        {
+            vk::ImageMemoryBarrier barrier{};
+
+            barrier
+                .setSrcAccessMask(src_access)
+                .setDstAccessMask(p_access.access_mask)
+                .setOldLayout(state.layout)
+                .setNewLayout(p_access.layout)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setImage(entry.image_handle)
+                .setSubresourceRange(vk::ImageSubresourceRange{ get_aspect(entry.image_info.format), 0, vk::RemainingMipLevels, 0, vk::RemainingArrayLayers });
+
+            batch.image_barriers.push_back(barrier);
+        }
+        else if (!entry.image && src_access)
+        {
+            vk::BufferMemoryBarrier barrier{};
+
+            barrier
+                .setSrcAccessMask(src_access)
+                .setDstAccessMask(p_access.access_mask)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(entry.buffer_handle)
+                .setOffset(0)
+                .setSize(VK_WHOLE_SIZE);
+
+            batch.buffer_barriers.push_back(barrier);
+        }
+    }
+
+    if (p_access.write)
+    {
+        state.write_stages = p_access.stages;
+        state.write_access = p_access.access_mask & WRITE_ACCESS;
+        state.read_stages = {};
+        state.visible_stages = {};
+        state.visible_access = {};
+    }
+    else if (layout_change)
+    {
+        // The transition is the last write, it is visible to this access only.
+        state.write_stages = p_access.stages;
+        state.write_access = {};
+        state.read_stages = p_access.stages;
+        state.visible_stages = p_access.stages;
+        state.visible_access = p_access.access_mask;
+    }
+    else
+    {
+        state.read_stages |= p_access.stages;
+
+        if (needed)
+        {
+            state.visible_stages |= p_access.stages;
+            state.visible_access |= p_access.access_mask;
+        }
+    }
+
+    if (entry.image)
+    {
+        state.layout = p_access.layout;
+    }
+}
+
+void render_graph::emit_(const vk::CommandBuffer& cmd_buffer, const barrier_batch& batch) const
+{
+    if (!batch.src_stages)
+    {
+        return;
+    }
+
+    cmd_buffer.pipelineBarrier(batch.src_stages, batch.dst_stages, vk::DependencyFlags{},
+        0, nullptr,
+        static_cast<std::uint32_t>(batch.buffer_barriers.size()), batch.buffer_barriers.data(),
+        static_cast<std::uint32_t>(batch.image_barriers.size()), batch.image_barriers.data(),
+        dispatch_);
+}
+
+std::uint32_t render_graph::find_memory_type_(std::uint32_t type_bits, vk::MemoryPropertyFlags properties) const
+{
+    for (std::uint32_t index = 0; index < memory_properties_.memoryTypeCount; ++index)
+    {
+        if ((type_bits & (1u << index)) && (memory_properties_.memoryTypes[index].propertyFlags & properties) == properties)
+        {
+            return index;
+        }
+    }
+
+    return std::numeric_limits<std::uint32_t>::max();
+}
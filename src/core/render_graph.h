@@ -0,0 +1,280 @@
+#ifndef RENDER_GRAPH_H_
+#define RENDER_GRAPH_H_
+
+#include "core/core.h"
+
+#include "core/deletion_queue.h"
+
+#include <functional>
+#include <limits>
+
+// The passes of a frame and the images and buffers they read and write, rebuilt every frame.
+// compile() drops the passes whose results are never used, orders the rest by their dependencies,
+// and works out the pipeline barriers and layout transitions between them, execute() records it all.
+// Transient resources only live inside the graph: resources whose lifetimes don't overlap share
+// their memory, attachments that are never copied or sampled use lazily allocated memory where
+// the device has it. Their objects are kept as long as the frames keep the same shape.
+// Passes with attachments are rendered with VK_KHR_dynamic_rendering.
+class render_graph
+{
+public:
+    using resource = std::uint32_t;
+
+    constexpr static resource INVALID_RESOURCE = std::numeric_limits<resource>::max();
+
+    // How a pass uses a resource, read() or write() tells whether it is written.
+    enum class usage
+    {
+        color_attachment,
+        depth_attachment,
+        sampled,
+        storage,
+        transfer_src,
+        transfer_dst,
+        vertex_buffer,
+        index_buffer,
+        uniform_buffer,
+        indirect_buffer
+    };
+
+    struct image_desc
+    {
+        vk::Format format{ vk::Format::eUndefined };
+        vk::Extent2D extent{};
+        // On top of the usage flags the passes need.
+        vk::ImageUsageFlags usage{};
+    };
+
+    struct buffer_desc
+    {
+        vk::DeviceSize size{ 0 };
+        vk::BufferUsageFlags usage{};
+    };
+
+    // What happened to an imported resource before the graph, or has to happen after it.
+    // An undefined final layout leaves the image in the layout of its last use.
+    struct external_state
+    {
+        vk::PipelineStageFlags stages{ vk::PipelineStageFlagBits::eTopOfPipe };
+        vk::AccessFlags access{};
+        vk::ImageLayout layout{ vk::ImageLayout::eUndefined };
+    };
+
+    struct pass_context
+    {
+        const vk::CommandBuffer& cmd_buffer;
+        const render_graph& graph;
+        // Where the attachments are rendered to, empty for passes without attachments.
+        vk::Rect2D render_area{};
+    };
+
+    using record_function = std::function<void(const pass_context&)>;
+
+    class pass_builder
+    {
+    public:
+        // Cleared when a clear value is given, loaded otherwise (unless there is nothing to load).
+        pass_builder& color_attachment(resource image, std::optional<vk::ClearColorValue> clear = {});
+        pass_builder& depth_attachment(resource image, std::optional<vk::ClearDepthStencilValue> clear = {});
+
+        pass_builder& read(resource target, usage how);
+        pass_builder& write(resource target, usage how);
+
+        // Renders to part of the attachments only, the whole attachment extent by default.
+        pass_builder& render_area(const vk::Rect2D& area);
+
+        // Never culled, for passes with results outside of the graph.
+        pass_builder& side_effect();
+
+    private:
+        friend class render_graph;
+
+        pass_builder(render_graph& graph, std::size_t pass_index) : graph_(graph), pass_index_(pass_index) {}
+
+        render_graph& graph_;
+        std::size_t pass_index_;
+    };
+
+    // Call release() before the deletion queue is flushed for the last time.
+    render_graph(vk::Device device, vk::PhysicalDevice physical_device, const vk::DispatchLoaderDynamic& dispatch, deletion_queue& p_deletion_queue, bool dynamic_rendering);
+
+    render_graph(const render_graph&) = delete;
+    render_graph& operator=(const render_graph&) = delete;
+
+    // Forgets the passes and resources of the previous frame, the transient objects are kept.
+    void reset();
+
+    resource import_image(std::string name, vk::Image image, vk::ImageView image_view, const image_desc& desc, const external_state& initial, const external_state& final);
+    resource import_buffer(std::string name, vk::Buffer buffer, vk::DeviceSize size, const external_state& initial, const external_state& final);
+
+    resource create_image(std::string name, const image_desc& desc);
+    resource create_buffer(std::string name, const buffer_desc& desc);
+
+    pass_builder add_pass(std::string name, record_function record);
+
+    // Transient objects replaced by this compile go to the deletion queue with last_use.
+    void compile(std::uint64_t last_use);
+
+    void execute(const vk::CommandBuffer& cmd_buffer);
+
+    // Destroys the transient objects once the GPU passed last_use.
+    void release(std::uint64_t last_use);
+
+    vk::Image image(resource target) const;
+    vk::ImageView image_view(resource target) const;
+    vk::Buffer buffer(resource target) const;
+    const image_desc& image_info(resource target) const;
+
+    std::size_t culled_pass_count() const { return culled_pass_count_; }
+
+private:
+    struct access
+    {
+        resource target{ INVALID_RESOURCE };
+        vk::PipelineStageFlags stages{};
+        vk::AccessFlags access_mask{};
+        vk::ImageLayout layout{ vk::ImageLayout::eUndefined };
+        bool write{ false };
+    };
+
+    struct attachment
+    {
+        resource target{ INVALID_RESOURCE };
+        bool depth{ false };
+        std::optional<vk::ClearValue> clear;
+
+        // Set by compile().
+        vk::AttachmentLoadOp load_op{ vk::AttachmentLoadOp::eDontCare };
+        vk::AttachmentStoreOp store_op{ vk::AttachmentStoreOp::eStore };
+    };
+
+    struct pass
+    {
+        std::string name;
+        record_function record;
+
+        std::vector<access> accesses;
+        std::vector<attachment> attachments;
+        std::optional<vk::Rect2D> render_area;
+
+        bool side_effect{ false };
+        bool culled{ false };
+        std::uint32_t level{ 0 };
+    };
+
+    // The synchronization state of a resource while the passes are walked.
+    struct resource_state
+    {
+        vk::ImageLayout layout{ vk::ImageLayout::eUndefined };
+        vk::PipelineStageFlags write_stages{};
+        vk::AccessFlags write_access{};
+        // Readers since the last write, and what the last write was made visible to.
+        vk::PipelineStageFlags read_stages{};
+        vk::PipelineStageFlags visible_stages{};
+        vk::AccessFlags visible_access{};
+    };
+
+    struct resource_entry
+    {
+        std::string name;
+        bool image{ true };
+        bool imported{ false };
+
+        image_desc image_info{};
+        buffer_desc buffer_info{};
+
+        external_state initial{};
+        external_state final{};
+
+        vk::Image image_handle{ nullptr };
+        vk::ImageView image_view_handle{ nullptr };
+        vk::Buffer buffer_handle{ nullptr };
+
+        // Positions in the execution order of the first and last pass using it.
+        std::size_t first_use{ std::numeric_limits<std::size_t>::max() };
+        std::size_t last_use{ 0 };
+
+        // The transient resource that used the same memory before this one.
+        resource alias_of{ INVALID_RESOURCE };
+
+        // Only used as attachments, so the contents never have to be in memory.
+        bool attachment_only{ true };
+
+        resource_state state{};
+    };
+
+    struct barrier_batch
+    {
+        vk::PipelineStageFlags src_stages{};
+        vk::PipelineStageFlags dst_stages{};
+        std::vector<vk::ImageMemoryBarrier> image_barriers;
+        std::vector<vk::BufferMemoryBarrier> buffer_barriers;
+    };
+
+    struct step
+    {
+        std::size_t pass_index{ 0 };
+        barrier_batch barriers;
+    };
+
+    // What the transient objects were made for, equal keys get the same objects again.
+    struct transient_key
+    {
+        bool image{ true };
+        vk::Format format{ vk::Format::eUndefined };
+        vk::Extent2D extent{};
+        vk::ImageUsageFlags image_usage{};
+        vk::DeviceSize size{ 0 };
+        vk::BufferUsageFlags buffer_usage{};
+        std::size_t first_use{ 0 };
+        std::size_t last_use{ 0 };
+
+        bool operator==(const transient_key& other) const;
+    };
+
+    struct transient_objects
+    {
+        vk::Image image{ nullptr };
+        vk::ImageView image_view{ nullptr };
+        vk::Buffer buffer{ nullptr };
+    };
+
+    resource add_resource_(resource_entry entry);
+    const resource_entry& resource_(resource target) const;
+
+    void add_access_(std::size_t pass_index, resource target, usage how, bool write);
+
+    void cull_();
+    void sort_();
+    void allocate_transients_(std::uint64_t last_use);
+    void place_barriers_();
+
+    // Adds what the access needs to the batch and updates the state of the resource.
+    void synchronize_(resource_entry& entry, const access& p_access, barrier_batch& batch);
+    void emit_(const vk::CommandBuffer& cmd_buffer, const barrier_batch& batch) const;
+
+    std::uint32_t find_memory_type_(std::uint32_t type_bits, vk::MemoryPropertyFlags properties) const;
+
+    vk::Device device_{ nullptr };
+    const vk::DispatchLoaderDynamic& dispatch_;
+    deletion_queue& deletion_queue_;
+    bool dynamic_rendering_{ false };
+
+    vk::PhysicalDeviceMemoryProperties memory_properties_{};
+
+    std::vector<pass> passes_;
+    std::vector<resource_entry> resources_;
+
+    std::vector<step> steps_;
+    barrier_batch final_barriers_;
+
+    std::size_t culled_pass_count_{ 0 };
+
+    std::vector<transient_key> transient_keys_;
+    std::vector<transient_objects> transient_objects_;
+    // Per transient, the index of the one using the same memory before it, or SIZE_MAX.
+    std::vector<std::size_t> transient_aliases_;
+    std::vector<vk::DeviceMemory> transient_memory_;
+};
+
+#endif
@@ -16,10 +16,14 @@ sdl_window::sdl_window(engine& p_engine)
 #endif
 
     sdl_window_ = &sdl_context_->create_window("Vulkan Testing", x, 200, width_, height_,SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE);
+
+    SDL_AddEventWatch(&sdl_window::event_watch_, this);
 }
 
 sdl_window::~sdl_window()
 {
+    SDL_DelEventWatch(&sdl_window::event_watch_, this);
+
     sdl_context_->destroy_window(*sdl_window_);
 
     sdl_context_.reset();
@@ -30,6 +34,20 @@ void sdl_window::process_events()
     sdl_context_->process_event_queue();
 }
 
+std::optional<std::chrono::steady_clock::time_point> sdl_window::take_earliest_input()
+{
+    std::lock_guard<std::mutex> lock(input_mutex_);
+
+    return std::exchange(earliest_input_, std::nullopt);
+}
+
+bool sdl_window::take_capture_request()
+{
+    std::lock_guard<std::mutex> lock(input_mutex_);
+
+    return std::exchange(capture_requested_, false);
+}
+
 SDL_SysWMinfo sdl_window::get_system_wm_info()
 {
     return sdl_window_->get_system_wm_info();
@@ -42,9 +60,38 @@ void sdl_window::set_title(const std::string& title)
 
 void sdl_window::on_quit_()
 {
-    SPDLOG_INFO("SDL is quitting.");
+    LOG_INFO(window, "SDL is quitting.");
 
     engine_->stop();
 }
 
 
+
+int sdl_window::event_watch_(void* user_data, SDL_Event* event)
+{
+    // Keyboard, mouse, joystick, controller, touch and gesture events.
+    if (event->type < SDL_KEYDOWN || event->type >= SDL_CLIPBOARDUPDATE)
+    {
+        return 0;
+    }
+
+    // SDL only sees an event once it is pumped from the OS queue, the time spent in there is
+    // not part of the measured latency.
+    const auto now = std::chrono::steady_clock::now();
+
+    auto* window = static_cast<sdl_window*>(user_data);
+
+    std::lock_guard<std::mutex> lock(window->input_mutex_);
+
+    if (!window->earliest_input_)
+    {
+        window->earliest_input_ = now;
+    }
+
+    if (event->type == SDL_KEYDOWN && event->key.repeat == 0 && event->key.keysym.sym == CAPTURE_KEY)
+    {
+        window->capture_requested_ = true;
+    }
+
+    return 0;
+}
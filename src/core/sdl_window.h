@@ -3,9 +3,14 @@
 
 #include "core/core.h"
 
+#include <mutex>
+
 class sdl_window
 {
 public:
+    // Requests a frame capture (engine::request_capture()).
+    constexpr static SDL_Keycode CAPTURE_KEY{ SDLK_F12 };
+
     sdl_window() = delete;
     sdl_window(engine& p_engine);
     ~sdl_window();
@@ -15,6 +20,12 @@ public:
 
     void process_events();
 
+    // When the earliest input event since the last call was pumped, nothing without input.
+    std::optional<std::chrono::steady_clock::time_point> take_earliest_input();
+
+    // Whether CAPTURE_KEY was pressed since the last call.
+    bool take_capture_request();
+
     SDL_SysWMinfo get_system_wm_info();
 
     void set_title(const std::string& title);
@@ -22,6 +33,13 @@ public:
 private:
     void on_quit_();
 
+    static int event_watch_(void* user_data, SDL_Event* event);
+
+    // Written by the event watch, which may run on another thread than process_events().
+    std::mutex input_mutex_;
+    std::optional<std::chrono::steady_clock::time_point> earliest_input_;
+    bool capture_requested_{ false };
+
     engine* engine_{ nullptr };
 
     sdl::context_pointer_type sdl_context_;
@@ -0,0 +1,39 @@
+#include "timing_summary.h"
+
+#include <algorithm>
+#include <cmath>
+
+timing_summary summarize_timings(std::vector<float> times)
+{
+    timing_summary summary{};
+
+    if (times.empty())
+    {
+        return summary;
+    }
+
+    std::sort(times.begin(), times.end());
+
+    auto percentile = [&times](double fraction) {
+        const auto rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(times.size())));
+
+        return static_cast<double>(times[std::clamp<std::size_t>(rank, 1, times.size()) - 1]);
+    };
+
+    double sum{ 0.0 };
+
+    for (const auto time : times)
+    {
+        sum += time;
+    }
+
+    summary.count = times.size();
+    summary.mean = sum / static_cast<double>(times.size());
+    summary.min = times.front();
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = times.back();
+
+    return summary;
+}
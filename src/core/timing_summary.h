@@ -0,0 +1,23 @@
+#ifndef TIMING_SUMMARY_H_
+#define TIMING_SUMMARY_H_
+
+#include <cstddef>
+#include <vector>
+
+// Distribution of a series of times (milliseconds), for the benchmark mode and the perf harness.
+// The percentiles are nearest rank, all zero for an empty series.
+struct timing_summary
+{
+    std::size_t count{ 0 };
+
+    double mean{ 0.0 };
+    double min{ 0.0 };
+    double p50{ 0.0 };
+    double p95{ 0.0 };
+    double p99{ 0.0 };
+    double max{ 0.0 };
+};
+
+timing_summary summarize_timings(std::vector<float> times);
+
+#endif
@@ -0,0 +1,248 @@
+#include "validation_messages.h"
+
+#include <functional>
+#include <string_view>
+
+namespace
+{
+
+spdlog::level::level_enum to_log_level(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+{
+    if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        return spdlog::level::err;
+    }
+    else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        return spdlog::level::warn;
+    }
+    else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+    {
+        return spdlog::level::info;
+    }
+
+    return spdlog::level::trace;
+}
+
+}
+
+validation_messages::validation_messages()
+{
+    slot_names_[OTHER_SLOT] = "Other message ids";
+
+    worker_ = std::thread([this]() { this->worker_entrypoint_(); });
+}
+
+validation_messages::~validation_messages()
+{
+    stop();
+}
+
+void validation_messages::push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* data)
+{
+    messages_emitted_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!log_category_validation.should_log(to_log_level(severity)))
+    {
+        return;
+    }
+
+    // Some messages have no id number, those are told apart by their id name.
+    std::uint64_t key{ static_cast<std::uint32_t>(data->messageIdNumber) };
+
+    if (key == 0 && data->pMessageIdName != nullptr)
+    {
+        key = std::hash<std::string_view>{}(data->pMessageIdName) | (std::uint64_t{ 1 } << 32);
+    }
+
+    auto [slot, count] = count_(key);
+
+    if (count >= FULL_MESSAGES_PER_ID)
+    {
+        return;
+    }
+
+    message new_message;
+
+    new_message.severity = severity;
+    new_message.id = data->messageIdNumber;
+    new_message.slot = slot;
+    new_message.id_name = data->pMessageIdName != nullptr ? data->pMessageIdName : "";
+    new_message.text = data->pMessage != nullptr ? data->pMessage : "";
+    new_message.object_count = data->objectCount;
+
+    for (std::uint32_t object_index = 0; object_index < data->objectCount && object_index < MAX_OBJECTS; ++object_index)
+    {
+        auto& object_name_info = data->pObjects[object_index];
+        auto& new_object = new_message.objects[object_index];
+
+        new_object.type = static_cast<vk::ObjectType>(object_name_info.objectType);
+        new_object.handle = object_name_info.objectHandle;
+
+        if (object_name_info.pObjectName != nullptr)
+        {
+            new_object.name = object_name_info.pObjectName;
+        }
+    }
+
+    queue_.enqueue(std::move(new_message));
+}
+
+void validation_messages::stop()
+{
+    if (!worker_.joinable())
+    {
+        return;
+    }
+
+    message stop_message;
+
+    stop_message.stop = true;
+
+    queue_.enqueue(std::move(stop_message));
+
+    worker_.join();
+}
+
+std::pair<std::size_t, std::uint64_t> validation_messages::count_(std::uint64_t key)
+{
+    // Key 0 marks a free entry, messages without any id are never deduplicated.
+    if (key == 0)
+    {
+        return { NO_SLOT, 0 };
+    }
+
+    auto hash = static_cast<std::size_t>(key * 0x9e3779b97f4a7c15ull >> 32);
+
+    for (std::size_t probe = 0; probe < ID_TABLE_SIZE; ++probe)
+    {
+        auto slot = (hash + probe) & (ID_TABLE_SIZE - 1);
+        auto& entry = ids_[slot];
+
+        auto entry_key = entry.key.load(std::memory_order_relaxed);
+
+        if (entry_key == 0 && entry.key.compare_exchange_strong(entry_key, key, std::memory_order_relaxed))
+        {
+            entry_key = key;
+        }
+
+        if (entry_key == key)
+        {
+            return { slot, entry.count.fetch_add(1, std::memory_order_relaxed) };
+        }
+    }
+
+    // Only the first FULL_MESSAGES_PER_ID messages of all the ids that didn't fit are logged in full.
+    return { OTHER_SLOT, ids_[OTHER_SLOT].count.fetch_add(1, std::memory_order_relaxed) };
+}
+
+void validation_messages::worker_entrypoint_()
+{
+    auto last_report = std::chrono::steady_clock::now();
+
+    bool stopping{ false };
+
+    message current_message;
+
+    while (!stopping)
+    {
+        if (queue_.wait_dequeue_timed(current_message, REPORT_INTERVAL))
+        {
+            if (current_message.stop)
+            {
+                stopping = true;
+
+                // The messenger is gone, whatever the other threads queued is already in there.
+                while (queue_.try_dequeue(current_message))
+                {
+                    log_(current_message);
+                }
+            }
+            else
+            {
+                log_(current_message);
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+
+        if (stopping || now - last_report >= REPORT_INTERVAL)
+        {
+            report_repeats_();
+
+            last_report = now;
+        }
+    }
+}
+
+void validation_messages::log_(const message& p_message)
+{
+    if (p_message.stop)
+    {
+        return;
+    }
+
+    if (p_message.slot < ID_TABLE_SIZE)
+    {
+        slot_names_[p_message.slot] = p_message.id_name;
+    }
+
+    if (p_message.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        LOG_ERROR(validation, "{}", p_message.id_name);
+        LOG_ERROR(validation, "\t{}", p_message.text);
+    }
+    else if (p_message.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        LOG_WARN(validation, "{}", p_message.id_name);
+        LOG_WARN(validation, "\t{}", p_message.text);
+    }
+    else if (p_message.severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+    {
+        LOG_INFO(validation, "{}", p_message.id_name);
+        LOG_INFO(validation, "\t{}", p_message.text);
+    }
+    else
+    {
+        LOG_TRACE(validation, "{}", p_message.id_name);
+        LOG_TRACE(validation, "\t{}", p_message.text);
+    }
+
+    for (std::uint32_t object_index = 0; object_index < p_message.object_count && object_index < MAX_OBJECTS; ++object_index)
+    {
+        auto& message_object = p_message.objects[object_index];
+
+        if (message_object.name.empty())
+        {
+            LOG_DEBUG(validation, "\tPrevious message is associated with a '{}' object (no name): {:x}", vk::to_string(message_object.type), message_object.handle);
+        }
+        else
+        {
+            LOG_DEBUG(validation, "\tPrevious message is associated with a '{}' object: '{}'", vk::to_string(message_object.type), message_object.name);
+        }
+    }
+
+    if (p_message.object_count > MAX_OBJECTS)
+    {
+        LOG_DEBUG(validation, "\t... and {} more object(s).", p_message.object_count - MAX_OBJECTS);
+    }
+}
+
+void validation_messages::report_repeats_()
+{
+    for (std::size_t slot = 0; slot < ids_.size(); ++slot)
+    {
+        auto count = ids_[slot].count.load(std::memory_order_relaxed);
+
+        if (count <= FULL_MESSAGES_PER_ID + slot_reported_[slot])
+        {
+            continue;
+        }
+
+        auto repeats = count - FULL_MESSAGES_PER_ID - slot_reported_[slot];
+
+        LOG_INFO(validation, "'{}' was repeated {} more time(s).", slot_names_[slot], repeats);
+
+        slot_reported_[slot] += repeats;
+    }
+}
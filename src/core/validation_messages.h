@@ -0,0 +1,94 @@
+#ifndef VALIDATION_MESSAGES_H_
+#define VALIDATION_MESSAGES_H_
+
+#include "core/core.h"
+
+#include <array>
+
+// Validation layer messages, formatted and logged on a worker thread instead of inside the
+// Vulkan call that triggered them.
+// The messenger callback counts the message by its messageIdNumber, only the first
+// FULL_MESSAGES_PER_ID messages of an id are copied into a lock-free queue (text, severity and
+// object handles), later ones just bump the counter. The worker logs the queued messages and
+// reports the repeats of each id every REPORT_INTERVAL. Once the id table is full, new ids
+// share one "other" counter instead.
+class validation_messages
+{
+public:
+    constexpr static std::uint64_t FULL_MESSAGES_PER_ID = 4;
+    constexpr static std::size_t MAX_OBJECTS = 4;
+    constexpr static std::size_t ID_TABLE_SIZE = 1024; // power of two
+    constexpr static std::chrono::milliseconds REPORT_INTERVAL{ 1000 };
+
+    validation_messages();
+    ~validation_messages();
+
+    validation_messages(const validation_messages&) = delete;
+    validation_messages& operator=(const validation_messages&) = delete;
+
+    // Called by the messenger callback, from any thread.
+    void push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* data);
+
+    // Logs everything queued so far and the remaining repeats, then stops the worker.
+    // Call after destroying the messenger.
+    void stop();
+
+    std::uint64_t messages_emitted() const { return messages_emitted_.load(std::memory_order_relaxed); }
+
+private:
+    // Counts the ids that found no free entry in the table.
+    constexpr static std::size_t OTHER_SLOT = ID_TABLE_SIZE;
+    // Messages without any id.
+    constexpr static std::size_t NO_SLOT = ID_TABLE_SIZE + 1;
+
+    struct object
+    {
+        vk::ObjectType type{ vk::ObjectType::eUnknown };
+        std::uint64_t handle{ 0 };
+        std::string name;
+    };
+
+    struct message
+    {
+        bool stop{ false };
+
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity{ VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT };
+        std::int32_t id{ 0 };
+        std::size_t slot{ NO_SLOT };
+
+        std::string id_name;
+        std::string text;
+
+        std::uint32_t object_count{ 0 };
+        std::array<object, MAX_OBJECTS> objects;
+    };
+
+    // Occurrences per message id, filled in by the callbacks without locking.
+    struct id_entry
+    {
+        std::atomic<std::uint64_t> key{ 0 };
+        std::atomic<std::uint64_t> count{ 0 };
+    };
+
+    // Returns the slot of the id and its count before this message, OTHER_SLOT and the shared count
+    // when the table is full.
+    std::pair<std::size_t, std::uint64_t> count_(std::uint64_t key);
+
+    void worker_entrypoint_();
+    void log_(const message& p_message);
+    void report_repeats_();
+
+    std::atomic<std::uint64_t> messages_emitted_{ 0 };
+
+    std::array<id_entry, ID_TABLE_SIZE + 1> ids_;
+
+    moodycamel::BlockingConcurrentQueue<message> queue_;
+
+    std::thread worker_;
+
+    // worker thread only
+    std::array<std::string, ID_TABLE_SIZE + 1> slot_names_;
+    std::array<std::uint64_t, ID_TABLE_SIZE + 1> slot_reported_{};
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <spdlog/async_logger.h>
 #include <spdlog/sinks/sink.h>
 #include <spdlog/details/thread_pool.h>
+#include <spdlog/details/flight_recorder.h>
 
 #include <memory>
 #include <string>
@@ -18,12 +19,42 @@ spdlog::async_logger::async_logger(
     : async_logger(std::move(logger_name), {std::move(single_sink)}, std::move(tp), overflow_policy)
 {}
 
+spdlog::async_logger::~async_logger()
+{
+    if (thread_pool_)
+    {
+        SPDLOG_TRY
+        {
+            thread_pool_->drain();
+        }
+        SPDLOG_CATCH_ALL() {}
+    }
+}
+
 // send the log message to the thread pool
 void spdlog::async_logger::sink_it_(const details::log_msg &msg)
 {
-    if (auto pool_ptr = thread_pool_.lock())
+    details::flight_recorder::record(msg);
+
+    // the logger's level may be lower than the sinks' (to feed the flight recorder),
+    // don't use a queue slot for messages no sink wants.
+    bool any_sink_should_log = false;
+    for (auto &sink : sinks_)
+    {
+        if (sink->should_log(msg.level))
+        {
+            any_sink_should_log = true;
+            break;
+        }
+    }
+    if (!any_sink_should_log)
+    {
+        return;
+    }
+
+    if (thread_pool_)
     {
-        pool_ptr->post_log(shared_from_this(), msg, overflow_policy_);
+        thread_pool_->post_log(this, msg, overflow_policy_);
     }
     else
     {
@@ -34,9 +65,9 @@ void spdlog::async_logger::sink_it_(const details::log_msg &msg)
 // send flush request to the thread pool
 void spdlog::async_logger::flush_()
 {
-    if (auto pool_ptr = thread_pool_.lock())
+    if (thread_pool_)
     {
-        pool_ptr->post_flush(shared_from_this(), overflow_policy_);
+        thread_pool_->post_flush(this, overflow_policy_);
     }
     else
     {
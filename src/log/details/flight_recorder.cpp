@@ -0,0 +1,510 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <spdlog/details/flight_recorder.h>
+#include <spdlog/details/tsc_clock.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog {
+namespace details {
+
+std::atomic<bool> flight_recorder::enabled_{false};
+std::atomic<int> flight_recorder::min_level_{level::trace};
+
+namespace {
+
+constexpr std::uint8_t tsc_flag = 1;
+constexpr std::uint8_t truncated_flag = 2;
+
+struct record_slot
+{
+    // 2n+1 while record n is being written, 2n+2 once it is complete
+    std::atomic<std::uint64_t> seq{0};
+    // nanoseconds since epoch, or tsc ticks if flags & tsc_flag
+    std::uint64_t timestamp = 0;
+    std::uint64_t thread_id = 0;
+    const char *filename = nullptr;
+    const char *funcname = nullptr;
+    std::int32_t line = 0;
+    std::uint8_t level = 0;
+    std::uint8_t flags = 0;
+    std::uint8_t logger_name_size = 0;
+    std::uint16_t payload_size = 0;
+    char logger_name[flight_recorder::logger_name_capacity];
+    char payload[flight_recorder::payload_capacity];
+};
+
+// One per thread. The list of rings only grows: when a thread exits its ring goes back to a
+// pool and keeps the records for dump() until another thread claims it. Beyond max_idle_rings
+// idle rings, the exiting thread's records are released instead (the ring itself stays listed).
+struct thread_ring
+{
+    // null once released, only changed by the owning thread
+    std::atomic<record_slot *> slots{nullptr};
+    size_t mask = 0;
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<bool> in_use{true};
+    // set before the ring is published, never changed afterwards
+    thread_ring *next = nullptr;
+};
+
+constexpr size_t max_idle_rings = 8;
+
+std::atomic<thread_ring *> rings{nullptr};
+std::atomic<size_t> ring_capacity{0};
+// idle rings that still have their records
+std::atomic<size_t> idle_rings{0};
+// dump() calls in progress, records are not freed while one reads them
+std::atomic<int> active_dumps{0};
+
+bool allocate_slots(thread_ring *ring)
+{
+    auto capacity = ring_capacity.load(std::memory_order_relaxed);
+    auto *slots = new (std::nothrow) record_slot[capacity];
+    if (slots == nullptr)
+    {
+        return false;
+    }
+    ring->mask = capacity - 1;
+    ring->slots.store(slots, std::memory_order_release);
+    return true;
+}
+
+// the seq_cst exchange and load pair with the ones in dump(): either the dump sees the
+// null slots or this sees the dump, in which case the records are kept.
+void release_slots(thread_ring *ring)
+{
+    auto *slots = ring->slots.exchange(nullptr);
+    if (active_dumps.load() == 0)
+    {
+        delete[] slots;
+    }
+    else
+    {
+        ring->slots.store(slots, std::memory_order_relaxed);
+    }
+}
+
+thread_ring *claim_ring()
+{
+    for (auto *ring = rings.load(std::memory_order_acquire); ring != nullptr; ring = ring->next)
+    {
+        bool expected = false;
+        if (!ring->in_use.load(std::memory_order_relaxed) &&
+            ring->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            if (ring->slots.load(std::memory_order_relaxed) != nullptr)
+            {
+                idle_rings.fetch_sub(1, std::memory_order_relaxed);
+            }
+            else if (!allocate_slots(ring))
+            {
+                ring->in_use.store(false, std::memory_order_release);
+                return nullptr;
+            }
+            return ring;
+        }
+    }
+
+    std::unique_ptr<thread_ring> ring(new (std::nothrow) thread_ring());
+    if (!ring || !allocate_slots(ring.get()))
+    {
+        return nullptr;
+    }
+
+    auto *head = rings.load(std::memory_order_relaxed);
+    do
+    {
+        ring->next = head;
+    } while (!rings.compare_exchange_weak(head, ring.get(), std::memory_order_release, std::memory_order_relaxed));
+    return ring.release();
+}
+
+// gives the ring back when its thread exits
+struct ring_owner
+{
+    thread_ring *ring = nullptr;
+
+    ~ring_owner()
+    {
+        if (ring == nullptr)
+        {
+            return;
+        }
+        if (idle_rings.fetch_add(1, std::memory_order_relaxed) >= max_idle_rings)
+        {
+            idle_rings.fetch_sub(1, std::memory_order_relaxed);
+            release_slots(ring);
+        }
+        ring->in_use.store(false, std::memory_order_release);
+    }
+};
+
+thread_local ring_owner tls_ring_owner;
+
+size_t round_up_pow2(size_t n)
+{
+    size_t result = 1;
+    while (result < n)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Line buffered writer for dump(), async signal safe (no allocation, no stdio).
+class dump_writer
+{
+public:
+    explicit dump_writer(int fd)
+        : fd_(fd)
+    {}
+
+    void append(const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            if (size_ == sizeof(buf_))
+            {
+                flush();
+            }
+            auto n = (std::min)(size, sizeof(buf_) - size_);
+            std::memcpy(buf_ + size_, data, n);
+            size_ += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    void append(const char *str)
+    {
+        append(str, std::strlen(str));
+    }
+
+    void append_uint(std::uint64_t value, int min_width = 0)
+    {
+        char digits[20];
+        int count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        for (; count < min_width && count < 20; ++count)
+        {
+            digits[count] = '0';
+        }
+        while (count > 0)
+        {
+            append(&digits[--count], 1);
+        }
+    }
+
+    bool flush()
+    {
+        const char *data = buf_;
+        while (size_ > 0 && !failed_)
+        {
+#ifdef _WIN32
+            auto written = ::_write(fd_, data, static_cast<unsigned int>(size_));
+#else
+            auto written = ::write(fd_, data, size_);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+#endif
+            if (written <= 0)
+            {
+                failed_ = true;
+                break;
+            }
+            data += written;
+            size_ -= static_cast<size_t>(written);
+        }
+        size_ = 0;
+        return !failed_;
+    }
+
+private:
+    int fd_;
+    char buf_[4096];
+    size_t size_ = 0;
+    bool failed_ = false;
+};
+
+void append_timestamp(dump_writer &writer, std::uint64_t timestamp, bool tsc)
+{
+    if (tsc)
+    {
+        // only tsc_clock can have produced the ticks, so it is calibrated already
+        auto time_point = tsc_clock::to_time_point(timestamp, false);
+        timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count());
+    }
+    writer.append_uint(timestamp / 1000000000);
+    writer.append(".", 1);
+    writer.append_uint(timestamp % 1000000000, 9);
+}
+
+void dump_record(dump_writer &writer, const record_slot &slot, std::uint64_t seq)
+{
+    // copy the record, then make sure it was not overwritten meanwhile (seqlock)
+    if (slot.seq.load(std::memory_order_acquire) != seq)
+    {
+        return;
+    }
+    auto timestamp = slot.timestamp;
+    auto thread_id = slot.thread_id;
+    auto filename = slot.filename;
+    auto funcname = slot.funcname;
+    auto line = slot.line;
+    auto lvl = slot.level;
+    auto flags = slot.flags;
+    size_t logger_name_size = (std::min)(static_cast<size_t>(slot.logger_name_size), flight_recorder::logger_name_capacity);
+    size_t payload_size = (std::min)(static_cast<size_t>(slot.payload_size), flight_recorder::payload_capacity);
+    char logger_name[flight_recorder::logger_name_capacity];
+    char payload[flight_recorder::payload_capacity];
+    std::memcpy(logger_name, slot.logger_name, logger_name_size);
+    std::memcpy(payload, slot.payload, payload_size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq)
+    {
+        return;
+    }
+
+    append_timestamp(writer, timestamp, (flags & tsc_flag) != 0);
+    writer.append(" [", 2);
+    auto &level_name = level::to_string_view(static_cast<level::level_enum>(lvl < static_cast<int>(level::n_levels) ? lvl : static_cast<int>(level::off)));
+    writer.append(level_name.data(), level_name.size());
+    writer.append("] [", 3);
+    writer.append_uint(thread_id);
+    writer.append("] [", 3);
+    writer.append(logger_name, logger_name_size);
+    writer.append("]", 1);
+    if (filename != nullptr)
+    {
+        writer.append(" [", 2);
+        writer.append(filename);
+        writer.append(":", 1);
+        writer.append_uint(static_cast<std::uint64_t>(line < 0 ? 0 : line));
+        if (funcname != nullptr)
+        {
+            writer.append(" ", 1);
+            writer.append(funcname);
+        }
+        writer.append("]", 1);
+    }
+    writer.append(" ", 1);
+    writer.append(payload, payload_size);
+    if (flags & truncated_flag)
+    {
+        writer.append("...");
+    }
+    writer.append("\n", 1);
+}
+
+char crash_filename[1024] = {};
+std::atomic<bool> crash_dumped{false};
+
+const int crash_signals[] = {
+    SIGSEGV,
+    SIGILL,
+    SIGFPE,
+    SIGABRT,
+#ifdef SIGBUS
+    SIGBUS,
+#endif
+};
+constexpr size_t crash_signal_count = sizeof(crash_signals) / sizeof(crash_signals[0]);
+
+#ifdef _WIN32
+using previous_handler_t = void (*)(int);
+#else
+using previous_handler_t = struct sigaction;
+#endif
+previous_handler_t previous_handlers[crash_signal_count];
+
+extern "C" void crash_signal_handler(int sig)
+{
+    flight_recorder::dump_crash_file();
+
+    for (size_t i = 0; i < crash_signal_count; i++)
+    {
+        if (crash_signals[i] == sig)
+        {
+#ifdef _WIN32
+            std::signal(sig, previous_handlers[i] == SIG_ERR ? SIG_DFL : previous_handlers[i]);
+#else
+            ::sigaction(sig, &previous_handlers[i], nullptr);
+#endif
+            break;
+        }
+    }
+    std::raise(sig);
+}
+
+} // namespace
+
+void flight_recorder::enable(size_t records_per_thread, level::level_enum min_level)
+{
+    size_t expected = 0;
+    ring_capacity.compare_exchange_strong(expected, round_up_pow2((std::max)(records_per_thread, size_t{2})));
+    min_level_.store(min_level, std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void flight_recorder::disable()
+{
+    enabled_.store(false, std::memory_order_relaxed);
+}
+
+void flight_recorder::record_(const log_msg &msg) noexcept
+{
+    auto *ring = tls_ring_owner.ring;
+    if (ring == nullptr)
+    {
+        ring = claim_ring();
+        if (ring == nullptr)
+        {
+            return;
+        }
+        tls_ring_owner.ring = ring;
+    }
+
+    auto n = ring->head.load(std::memory_order_relaxed);
+    auto &slot = ring->slots.load(std::memory_order_relaxed)[n & ring->mask];
+
+    slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.flags = 0;
+    if (msg.tsc != 0)
+    {
+        slot.timestamp = msg.tsc;
+        slot.flags |= tsc_flag;
+    }
+    else
+    {
+        slot.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count());
+    }
+    slot.thread_id = msg.thread_id;
+    slot.filename = msg.source.filename;
+    slot.funcname = msg.source.funcname;
+    slot.line = msg.source.line;
+    slot.level = static_cast<std::uint8_t>(msg.level);
+
+    auto logger_name_size = (std::min)(msg.logger_name.size(), logger_name_capacity);
+    std::memcpy(slot.logger_name, msg.logger_name.data(), logger_name_size);
+    slot.logger_name_size = static_cast<std::uint8_t>(logger_name_size);
+
+    auto payload_size = msg.payload.size();
+    if (payload_size > payload_capacity)
+    {
+        payload_size = payload_capacity;
+        slot.flags |= truncated_flag;
+    }
+    std::memcpy(slot.payload, msg.payload.data(), payload_size);
+    slot.payload_size = static_cast<std::uint16_t>(payload_size);
+
+    slot.seq.store(2 * n + 2, std::memory_order_release);
+    ring->head.store(n + 1, std::memory_order_release);
+}
+
+bool flight_recorder::dump(const char *filename) noexcept
+{
+#ifdef _WIN32
+    int fd = ::_open(filename, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    dump_writer writer(fd);
+    writer.append("# flight recorder dump: timestamp (seconds since epoch, UTC) [level] [thread] [logger] [source] message\n");
+
+    active_dumps.fetch_add(1);
+
+    size_t ring_index = 0;
+    for (auto *ring = rings.load(std::memory_order_acquire); ring != nullptr; ring = ring->next, ring_index++)
+    {
+        auto *slots = ring->slots.load();
+        if (slots == nullptr)
+        {
+            continue; // thread exited, records released
+        }
+        auto head = ring->head.load(std::memory_order_acquire);
+        auto capacity = static_cast<std::uint64_t>(ring->mask) + 1;
+
+        writer.append("# ring ");
+        writer.append_uint(ring_index);
+        writer.append(ring->in_use.load(std::memory_order_relaxed) ? " (thread running), " : " (thread exited), ");
+        writer.append_uint(head);
+        writer.append(" record(s)\n");
+
+        for (auto n = head > capacity ? head - capacity : 0; n < head; n++)
+        {
+            dump_record(writer, slots[n & ring->mask], 2 * n + 2);
+        }
+    }
+
+    active_dumps.fetch_sub(1);
+
+    bool ok = writer.flush();
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+    return ok;
+}
+
+void flight_recorder::install_crash_handler(const std::string &filename)
+{
+    auto size = (std::min)(filename.size(), sizeof(crash_filename) - 1);
+    std::memcpy(crash_filename, filename.data(), size);
+    crash_filename[size] = '\0';
+
+    for (size_t i = 0; i < crash_signal_count; i++)
+    {
+#ifdef _WIN32
+        previous_handlers[i] = std::signal(crash_signals[i], crash_signal_handler);
+#else
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = crash_signal_handler;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(crash_signals[i], &action, &previous_handlers[i]);
+#endif
+    }
+}
+
+bool flight_recorder::dump_crash_file() noexcept
+{
+    if (crash_filename[0] == '\0' || crash_dumped.exchange(true))
+    {
+        return false;
+    }
+    return dump(crash_filename);
+}
+
+} // namespace details
+} // namespace spdlog
@@ -3,6 +3,7 @@
 
 #include <spdlog/details/log_msg.h>
 #include <spdlog/details/os.h>
+#include <spdlog/details/tsc_clock.h>
 
 namespace spdlog {
 namespace details {
@@ -19,6 +20,36 @@ log_msg::log_msg(spdlog::log_clock::time_point log_time, spdlog::source_loc loc,
     , payload(msg)
 {}
 
+#ifdef SPDLOG_CLOCK_TSC
+
+namespace {
+void capture_time(log_msg &msg)
+{
+    if (tsc_clock::available())
+    {
+        msg.tsc = tsc_clock::ticks();
+    }
+    else
+    {
+        msg.time = os::now();
+    }
+}
+} // namespace
+
+log_msg::log_msg(spdlog::source_loc loc, string_view_t a_logger_name, spdlog::level::level_enum lvl, spdlog::string_view_t msg)
+    : log_msg(log_clock::time_point{}, loc, a_logger_name, lvl, msg)
+{
+    capture_time(*this);
+}
+
+log_msg::log_msg(string_view_t a_logger_name, spdlog::level::level_enum lvl, spdlog::string_view_t msg)
+    : log_msg(log_clock::time_point{}, source_loc{}, a_logger_name, lvl, msg)
+{
+    capture_time(*this);
+}
+
+#else
+
 log_msg::log_msg(spdlog::source_loc loc, string_view_t a_logger_name, spdlog::level::level_enum lvl, spdlog::string_view_t msg)
     : log_msg(os::now(), loc, a_logger_name, lvl, msg)
 {}
@@ -27,5 +58,12 @@ log_msg::log_msg(string_view_t a_logger_name, spdlog::level::level_enum lvl, spd
     : log_msg(os::now(), source_loc{}, a_logger_name, lvl, msg)
 {}
 
+#endif // SPDLOG_CLOCK_TSC
+
+log_clock::time_point log_msg::resolved_time() const
+{
+    return tsc != 0 ? tsc_clock::to_time_point(tsc) : time;
+}
+
 } // namespace details
 } // namespace spdlog
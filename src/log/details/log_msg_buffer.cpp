@@ -46,6 +46,15 @@ log_msg_buffer &log_msg_buffer::operator=(log_msg_buffer &&other) noexcept
     return *this;
 }
 
+void log_msg_buffer::assign(const log_msg &orig_msg)
+{
+    log_msg::operator=(orig_msg);
+    buffer.clear();
+    buffer.append(logger_name.begin(), logger_name.end());
+    buffer.append(payload.begin(), payload.end());
+    update_string_views();
+}
+
 void log_msg_buffer::update_string_views()
 {
     logger_name = string_view_t{buffer.data(), logger_name.size()};
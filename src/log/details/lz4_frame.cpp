@@ -0,0 +1,287 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <spdlog/details/lz4_frame.h>
+#include <spdlog/details/os.h>
+#include <spdlog/common.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace spdlog {
+namespace details {
+namespace lz4 {
+
+namespace {
+
+constexpr std::size_t min_match = 4;
+// the last 5 bytes of a block are always literals
+constexpr std::size_t last_literals = 5;
+// the last match must start at least 12 bytes before the end of the block
+constexpr std::size_t mf_limit = 12;
+constexpr std::size_t max_distance = 65535;
+constexpr int hash_log = 12;
+
+constexpr std::uint32_t frame_magic = 0x184D2204;
+// version 01, independent blocks, no checksums
+constexpr std::uint8_t frame_flg = 0x60;
+// 64KB maximum block size
+constexpr std::uint8_t frame_bd = 0x40;
+constexpr std::size_t frame_block_size = 64 * 1024;
+constexpr std::uint32_t uncompressed_block_flag = 0x80000000u;
+
+inline std::uint32_t read32(const std::uint8_t *p) noexcept
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint32_t hash4(std::uint32_t sequence) noexcept
+{
+    return (sequence * 2654435761u) >> (32 - hash_log);
+}
+
+inline void write_length(std::uint8_t *&op, std::size_t length) noexcept
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<std::uint8_t>(length);
+}
+
+inline void write_le32(std::uint8_t *p, std::uint32_t v) noexcept
+{
+    p[0] = static_cast<std::uint8_t>(v);
+    p[1] = static_cast<std::uint8_t>(v >> 8);
+    p[2] = static_cast<std::uint8_t>(v >> 16);
+    p[3] = static_cast<std::uint8_t>(v >> 24);
+}
+
+inline std::uint32_t rotl32(std::uint32_t v, int r) noexcept
+{
+    return (v << r) | (v >> (32 - r));
+}
+
+// xxh32 (seed 0) of a short (< 16 bytes) input, as required by the frame header checksum
+std::uint32_t xxh32_short(const std::uint8_t *p, std::size_t len) noexcept
+{
+    constexpr std::uint32_t prime1 = 2654435761u;
+    constexpr std::uint32_t prime2 = 2246822519u;
+    constexpr std::uint32_t prime3 = 3266489917u;
+    constexpr std::uint32_t prime4 = 668265263u;
+    constexpr std::uint32_t prime5 = 374761393u;
+
+    std::uint32_t h32 = prime5 + static_cast<std::uint32_t>(len);
+    const std::uint8_t *end = p + len;
+    while (p + 4 <= end)
+    {
+        h32 += read32(p) * prime3;
+        h32 = rotl32(h32, 17) * prime4;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h32 += (*p++) * prime5;
+        h32 = rotl32(h32, 11) * prime1;
+    }
+    h32 ^= h32 >> 15;
+    h32 *= prime2;
+    h32 ^= h32 >> 13;
+    h32 *= prime3;
+    h32 ^= h32 >> 16;
+    return h32;
+}
+
+void write_all(std::FILE *fd, const void *data, std::size_t size, const filename_t &filename)
+{
+    if (std::fwrite(data, 1, size, fd) != size)
+    {
+        throw_spdlog_ex("lz4: failed writing to file " + os::filename_to_str(filename), errno);
+    }
+}
+
+struct file_closer
+{
+    void operator()(std::FILE *fd) const
+    {
+        std::fclose(fd);
+    }
+};
+
+using file_ptr = std::unique_ptr<std::FILE, file_closer>;
+
+} // namespace
+
+const filename_t &extension()
+{
+    static const filename_t ext = SPDLOG_FILENAME_T(".lz4");
+    return ext;
+}
+
+std::size_t compress_bound(std::size_t source_size) noexcept
+{
+    return source_size + source_size / 255 + 16;
+}
+
+std::size_t compress_block(const char *source, std::size_t source_size, char *dest, std::size_t dest_capacity) noexcept
+{
+    if (dest_capacity < compress_bound(source_size))
+    {
+        return 0;
+    }
+
+    const auto *base = reinterpret_cast<const std::uint8_t *>(source);
+    const auto *end = base + source_size;
+    const auto *ip = base;
+    const auto *anchor = base;
+    auto *op = reinterpret_cast<std::uint8_t *>(dest);
+
+    if (source_size > mf_limit)
+    {
+        std::array<std::uint32_t, std::size_t{1} << hash_log> table{};
+        const auto *match_limit = end - last_literals;
+        const auto *ip_limit = end - mf_limit;
+
+        while (ip <= ip_limit)
+        {
+            const auto sequence = read32(ip);
+            const auto h = hash4(sequence);
+            const auto *ref = base + table[h];
+            table[h] = static_cast<std::uint32_t>(ip - base);
+
+            if (ref >= ip || static_cast<std::size_t>(ip - ref) > max_distance || read32(ref) != sequence)
+            {
+                ++ip;
+                continue;
+            }
+
+            // extend the match backwards into the pending literals, then forwards
+            while (ip > anchor && ref > base && ip[-1] == ref[-1])
+            {
+                --ip;
+                --ref;
+            }
+            const auto *match_end = ip + min_match;
+            const auto *ref_end = ref + min_match;
+            while (match_end < match_limit && *match_end == *ref_end)
+            {
+                ++match_end;
+                ++ref_end;
+            }
+
+            const auto literal_length = static_cast<std::size_t>(ip - anchor);
+            const auto match_length = static_cast<std::size_t>(match_end - ip) - min_match;
+            const auto offset = static_cast<std::uint16_t>(ip - ref);
+
+            auto *token = op++;
+            *token = static_cast<std::uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+            if (literal_length >= 15)
+            {
+                write_length(op, literal_length - 15);
+            }
+            std::memcpy(op, anchor, literal_length);
+            op += literal_length;
+
+            *op++ = static_cast<std::uint8_t>(offset);
+            *op++ = static_cast<std::uint8_t>(offset >> 8);
+
+            *token |= static_cast<std::uint8_t>(match_length >= 15 ? 15 : match_length);
+            if (match_length >= 15)
+            {
+                write_length(op, match_length - 15);
+            }
+
+            ip = match_end;
+            anchor = ip;
+        }
+    }
+
+    // trailing literals
+    const auto literal_length = static_cast<std::size_t>(end - anchor);
+    *op++ = static_cast<std::uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15)
+    {
+        write_length(op, literal_length - 15);
+    }
+    std::memcpy(op, anchor, literal_length);
+    op += literal_length;
+
+    return static_cast<std::size_t>(op - reinterpret_cast<std::uint8_t *>(dest));
+}
+
+void compress_file(const filename_t &source_filename, const filename_t &target_filename)
+{
+    std::FILE *raw_fd = nullptr;
+    if (os::fopen_s(&raw_fd, source_filename, SPDLOG_FILENAME_T("rb")))
+    {
+        throw_spdlog_ex("lz4: failed opening file " + os::filename_to_str(source_filename) + " for reading", errno);
+    }
+    file_ptr source_fd(raw_fd);
+
+    raw_fd = nullptr;
+    if (os::fopen_s(&raw_fd, target_filename, SPDLOG_FILENAME_T("wb")))
+    {
+        throw_spdlog_ex("lz4: failed opening file " + os::filename_to_str(target_filename) + " for writing", errno);
+    }
+    file_ptr target_fd(raw_fd);
+
+    std::uint8_t header[7];
+    write_le32(header, frame_magic);
+    header[4] = frame_flg;
+    header[5] = frame_bd;
+    header[6] = static_cast<std::uint8_t>(xxh32_short(header + 4, 2) >> 8);
+    write_all(target_fd.get(), header, sizeof(header), target_filename);
+
+    std::vector<char> in_buf(frame_block_size);
+    std::vector<char> out_buf(compress_bound(frame_block_size));
+    std::uint8_t block_header[4];
+
+    for (;;)
+    {
+        const auto n_read = std::fread(in_buf.data(), 1, in_buf.size(), source_fd.get());
+        if (n_read == 0)
+        {
+            if (std::ferror(source_fd.get()))
+            {
+                throw_spdlog_ex("lz4: failed reading file " + os::filename_to_str(source_filename), errno);
+            }
+            break;
+        }
+
+        const auto compressed_size = compress_block(in_buf.data(), n_read, out_buf.data(), out_buf.size());
+        if (compressed_size == 0 || compressed_size >= n_read)
+        {
+            // incompressible - store as is
+            write_le32(block_header, static_cast<std::uint32_t>(n_read) | uncompressed_block_flag);
+            write_all(target_fd.get(), block_header, sizeof(block_header), target_filename);
+            write_all(target_fd.get(), in_buf.data(), n_read, target_filename);
+        }
+        else
+        {
+            write_le32(block_header, static_cast<std::uint32_t>(compressed_size));
+            write_all(target_fd.get(), block_header, sizeof(block_header), target_filename);
+            write_all(target_fd.get(), out_buf.data(), compressed_size, target_filename);
+        }
+    }
+
+    // end mark
+    write_le32(block_header, 0);
+    write_all(target_fd.get(), block_header, sizeof(block_header), target_filename);
+
+    if (std::fflush(target_fd.get()) != 0)
+    {
+        throw_spdlog_ex("lz4: failed flushing file " + os::filename_to_str(target_filename), errno);
+    }
+}
+
+} // namespace lz4
+} // namespace details
+} // namespace spdlog
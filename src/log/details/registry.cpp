@@ -3,7 +3,10 @@
 
 #include <spdlog/details/registry.h>
 #include <spdlog/common.h>
+#include <spdlog/details/call_site_limiter.h>
 #include <spdlog/details/periodic_worker.h>
+#include <spdlog/details/thread_pool.h>
+#include <spdlog/details/tsc_clock.h>
 #include <spdlog/logger.h>
 #include <spdlog/pattern_formatter.h>
 
@@ -20,14 +23,57 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 namespace spdlog {
 namespace details {
 
+// Pins the current snapshot for the lifetime of the guard.
+// The reader announces itself in the counter of the current epoch *before* loading
+// the snapshot pointer, which is what synchronize_() relies on.
+class registry::read_guard
+{
+public:
+    explicit read_guard(registry &r)
+        : counter_(r.readers_[r.epoch_.load() & 1].count)
+    {
+        counter_.fetch_add(1);
+        snapshot_ = r.snapshot_.load();
+    }
+
+    ~read_guard()
+    {
+        counter_.fetch_sub(1, std::memory_order_release);
+    }
+
+    read_guard(const read_guard &) = delete;
+    read_guard &operator=(const read_guard &) = delete;
+
+    const snapshot &operator*() const
+    {
+        return *snapshot_;
+    }
+
+    const snapshot *operator->() const
+    {
+        return snapshot_;
+    }
+
+private:
+    std::atomic<size_t> &counter_;
+    const snapshot *snapshot_;
+};
+
 registry::registry()
     : formatter_(new pattern_formatter())
 {
+#ifdef SPDLOG_CLOCK_TSC
+    // calibrate now, not in the first log call
+    (void)tsc_clock::available();
+#endif
+
+    auto initial = std::make_shared<snapshot>();
 
 #ifndef SPDLOG_DISABLE_DEFAULT_LOGGER
     // create default logger (ansicolor_stdout_sink_mt or wincolor_stdout_sink_mt in windows).
@@ -38,10 +84,14 @@ registry::registry()
 #endif
 
     const char *default_logger_name = "";
-    default_logger_ = std::make_shared<spdlog::logger>(default_logger_name, std::move(color_sink));
-    loggers_[default_logger_name] = default_logger_;
+    initial->default_logger = std::make_shared<spdlog::logger>(default_logger_name, std::move(color_sink));
+    initial->loggers[default_logger_name] = initial->default_logger;
 
 #endif // SPDLOG_DISABLE_DEFAULT_LOGGER
+
+    default_logger_raw_.store(initial->default_logger.get());
+    snapshot_.store(initial.get());
+    current_ = std::move(initial);
 }
 
 registry::~registry() = default;
@@ -49,7 +99,9 @@ registry::~registry() = default;
 void registry::register_logger(std::shared_ptr<logger> new_logger)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    register_logger_(std::move(new_logger));
+    auto next = copy_snapshot_();
+    register_logger_(*next, std::move(new_logger));
+    publish_(std::move(next));
 }
 
 void registry::initialize_logger(std::shared_ptr<logger> new_logger)
@@ -67,21 +119,23 @@ void registry::initialize_logger(std::shared_ptr<logger> new_logger)
 
     if (automatic_registration_)
     {
-        register_logger_(std::move(new_logger));
+        auto next = copy_snapshot_();
+        register_logger_(*next, std::move(new_logger));
+        publish_(std::move(next));
     }
 }
 
 std::shared_ptr<logger> registry::get(const std::string &logger_name)
 {
-    std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    auto found = loggers_.find(logger_name);
-    return found == loggers_.end() ? nullptr : found->second;
+    read_guard snap(*this);
+    auto found = snap->loggers.find(logger_name);
+    return found == snap->loggers.end() ? nullptr : found->second;
 }
 
 std::shared_ptr<logger> registry::default_logger()
 {
-    std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    return default_logger_;
+    read_guard snap(*this);
+    return snap->default_logger;
 }
 
 // Return raw ptr to the default logger.
@@ -90,36 +144,47 @@ std::shared_ptr<logger> registry::default_logger()
 // e.g do not call set_default_logger() from one thread while calling spdlog::info() from another.
 logger *registry::get_default_raw()
 {
-    return default_logger_.get();
+    return default_logger_raw_.load(std::memory_order_acquire);
 }
 
 // set default logger.
-// default logger is stored in default_logger_ (for faster retrieval) and in the loggers_ map.
+// default logger is stored in the snapshot and in its loggers map.
 void registry::set_default_logger(std::shared_ptr<logger> new_default_logger)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
+    auto next = copy_snapshot_();
     // remove previous default logger from the map
-    if (default_logger_ != nullptr)
+    if (next->default_logger != nullptr)
     {
-        loggers_.erase(default_logger_->name());
+        next->loggers.erase(next->default_logger->name());
     }
     if (new_default_logger != nullptr)
     {
-        loggers_[new_default_logger->name()] = new_default_logger;
+        next->loggers[new_default_logger->name()] = new_default_logger;
     }
-    default_logger_ = std::move(new_default_logger);
+    next->default_logger = std::move(new_default_logger);
+    publish_(std::move(next));
 }
 
 void registry::set_tp(std::shared_ptr<thread_pool> tp)
 {
-    std::lock_guard<std::recursive_mutex> lock(tp_mutex_);
-    tp_ = std::move(tp);
+    std::lock_guard<std::recursive_mutex> tp_lock(tp_mutex_);
+    if (tp && flush_interval_.count() > 0)
+    {
+        auto policy = tp->get_flush_policy();
+        policy.max_age = flush_interval_;
+        tp->set_flush_policy(policy);
+    }
+    std::lock_guard<std::mutex> lock(logger_map_mutex_);
+    auto next = copy_snapshot_();
+    next->tp = std::move(tp);
+    publish_(std::move(next));
 }
 
 std::shared_ptr<thread_pool> registry::get_tp()
 {
-    std::lock_guard<std::recursive_mutex> lock(tp_mutex_);
-    return tp_;
+    read_guard snap(*this);
+    return snap->tp;
 }
 
 // Set global formatter. Each sink in each logger will get a clone of this object
@@ -127,7 +192,7 @@ void registry::set_formatter(std::unique_ptr<formatter> formatter)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
     formatter_ = std::move(formatter);
-    for (auto &l : loggers_)
+    for (auto &l : current_->loggers)
     {
         l.second->set_formatter(formatter_->clone());
     }
@@ -136,7 +201,7 @@ void registry::set_formatter(std::unique_ptr<formatter> formatter)
 void registry::set_level(level::level_enum log_level)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    for (auto &l : loggers_)
+    for (auto &l : current_->loggers)
     {
         l.second->set_level(log_level);
     }
@@ -146,7 +211,7 @@ void registry::set_level(level::level_enum log_level)
 void registry::flush_on(level::level_enum log_level)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    for (auto &l : loggers_)
+    for (auto &l : current_->loggers)
     {
         l.second->flush_on(log_level);
     }
@@ -155,6 +220,19 @@ void registry::flush_on(level::level_enum log_level)
 
 void registry::flush_every(std::chrono::seconds interval)
 {
+    {
+        std::lock_guard<std::recursive_mutex> tp_lock(tp_mutex_);
+        flush_interval_ = interval;
+        if (auto tp = get_tp())
+        {
+            auto policy = tp->get_flush_policy();
+            policy.max_age = interval;
+            tp->set_flush_policy(policy);
+        }
+    }
+
+    // the thread pool only sees the async loggers, the synchronous ones are still flushed
+    // by the periodic flusher thread.
     std::lock_guard<std::mutex> lock(flusher_mutex_);
     auto clbk = [this]() { this->flush_all(); };
     periodic_flusher_ = std::make_unique<periodic_worker>(clbk, interval);
@@ -163,7 +241,7 @@ void registry::flush_every(std::chrono::seconds interval)
 void registry::set_error_handler(void (*handler)(const std::string &msg))
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    for (auto &l : loggers_)
+    for (auto &l : current_->loggers)
     {
         l.second->set_error_handler(handler);
     }
@@ -172,8 +250,14 @@ void registry::set_error_handler(void (*handler)(const std::string &msg))
 
 void registry::apply_all(const std::function<void(const std::shared_ptr<logger>)> &fun)
 {
-    std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    for (auto &l : loggers_)
+    // keep the snapshot alive but leave the read section before running user code,
+    // so fun() is free to register or drop loggers.
+    std::shared_ptr<const snapshot> snap;
+    {
+        read_guard guard(*this);
+        snap = guard->shared_from_this();
+    }
+    for (auto &l : snap->loggers)
     {
         fun(l.second);
     }
@@ -181,28 +265,48 @@ void registry::apply_all(const std::function<void(const std::shared_ptr<logger>)
 
 void registry::flush_all()
 {
-    std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    for (auto &l : loggers_)
+    std::shared_ptr<const snapshot> snap;
+    {
+        read_guard guard(*this);
+        snap = guard->shared_from_this();
+    }
+    report_suppressed_(snap->default_logger.get());
+    for (auto &l : snap->loggers)
     {
         l.second->flush();
     }
 }
 
+void registry::report_suppressed_(logger *default_logger)
+{
+    if (default_logger == nullptr)
+    {
+        return;
+    }
+    token_bucket_limiter::take_suppressed([default_logger](const source_loc &loc, level::level_enum lvl, std::size_t count) {
+        default_logger->log(loc, lvl, "Suppressed {} message(s) from this call site.", count);
+    });
+}
+
 void registry::drop(const std::string &logger_name)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    loggers_.erase(logger_name);
-    if (default_logger_ && default_logger_->name() == logger_name)
+    auto next = copy_snapshot_();
+    next->loggers.erase(logger_name);
+    if (next->default_logger && next->default_logger->name() == logger_name)
     {
-        default_logger_.reset();
+        next->default_logger.reset();
     }
+    publish_(std::move(next));
 }
 
 void registry::drop_all()
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
-    loggers_.clear();
-    default_logger_.reset();
+    auto next = copy_snapshot_();
+    next->loggers.clear();
+    next->default_logger.reset();
+    publish_(std::move(next));
 }
 
 // clean all resources and threads started by the registry
@@ -213,12 +317,14 @@ void registry::shutdown()
         periodic_flusher_.reset();
     }
 
-    drop_all();
-
     {
-        std::lock_guard<std::recursive_mutex> lock(tp_mutex_);
-        tp_.reset();
+        read_guard guard(*this);
+        report_suppressed_(guard->default_logger.get());
     }
+
+    drop_all();
+
+    set_tp(nullptr);
 }
 
 std::recursive_mutex &registry::tp_mutex()
@@ -236,7 +342,7 @@ void registry::update_levels(cfg::log_levels levels)
 {
     std::lock_guard<std::mutex> lock(logger_map_mutex_);
     levels_ = std::move(levels);
-    for (auto &l : loggers_)
+    for (auto &l : current_->loggers)
     {
         auto &logger = l.second;
         logger->set_level(levels_.get(logger->name()));
@@ -255,19 +361,55 @@ registry &registry::instance()
     return *s_instance;
 }
 
-void registry::throw_if_exists_(const std::string &logger_name)
+std::shared_ptr<registry::snapshot> registry::copy_snapshot_() const
+{
+    auto next = std::make_shared<snapshot>();
+    next->loggers = current_->loggers;
+    next->default_logger = current_->default_logger;
+    next->tp = current_->tp;
+    return next;
+}
+
+void registry::publish_(std::shared_ptr<snapshot> next)
+{
+    default_logger_raw_.store(next->default_logger.get(), std::memory_order_release);
+    snapshot_.store(next.get());
+    synchronize_();
+    // no reader can reach the previous snapshot through snapshot_ anymore,
+    // the ones that took a reference (apply_all, flush_all) keep it alive on their own.
+    current_ = std::move(next);
+}
+
+// Wait until every reader that might have loaded a replaced snapshot pointer has left its read section.
+// Readers register in the counter of the epoch they observed before loading the pointer, so flipping
+// the epoch twice and waiting for each counter to drain in turn covers all of them. New readers always
+// go to the counter that is not being waited on, so they can't starve the writer.
+void registry::synchronize_()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        auto epoch = epoch_.load();
+        epoch_.store(epoch + 1);
+        while (readers_[epoch & 1].count.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void registry::throw_if_exists_(const snapshot &snap, const std::string &logger_name)
 {
-    if (loggers_.find(logger_name) != loggers_.end())
+    if (snap.loggers.find(logger_name) != snap.loggers.end())
     {
         throw_spdlog_ex("logger with name '" + logger_name + "' already exists");
     }
 }
 
-void registry::register_logger_(std::shared_ptr<logger> new_logger)
+void registry::register_logger_(snapshot &snap, std::shared_ptr<logger> new_logger)
 {
     auto logger_name = new_logger->name();
-    throw_if_exists_(logger_name);
-    loggers_[logger_name] = std::move(new_logger);
+    throw_if_exists_(snap, logger_name);
+    snap.loggers[logger_name] = std::move(new_logger);
 }
 
 } // namespace details
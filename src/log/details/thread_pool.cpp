@@ -3,6 +3,7 @@
 
 #include <spdlog/details/thread_pool.h>
 #include <spdlog/common.h>
+#include <algorithm>
 #include <cassert>
 
 namespace spdlog {
@@ -10,7 +11,10 @@ namespace details {
 
 thread_pool::thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start)
     : q_(q_max_items)
+    , q_max_items_(q_max_items)
 {
+    set_flush_policy(flush_policy{});
+
     if (threads_n == 0 || threads_n > 1000)
     {
         throw_spdlog_ex("spdlog::thread_pool(): invalid threads_n param (valid "
@@ -36,7 +40,7 @@ thread_pool::~thread_pool()
     {
         for (size_t i = 0; i < threads_.size(); i++)
         {
-            post_async_msg_(async_msg(async_msg_type::terminate), async_overflow_policy::block);
+            post_async_msg_([](async_msg &slot) { slot.assign(nullptr, async_msg_type::terminate); }, async_overflow_policy::block);
         }
 
         for (auto &t : threads_)
@@ -47,15 +51,60 @@ thread_pool::~thread_pool()
     SPDLOG_CATCH_ALL() {}
 }
 
-void thread_pool::post_log(async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy)
+void thread_pool::post_log(async_logger *worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy)
+{
+    auto fill = [worker_ptr, &msg](async_msg &slot) { slot.assign(worker_ptr, async_msg_type::log, msg); };
+#if SPDLOG_ENQUEUE_SAMPLE_INTERVAL > 0
+    static thread_local unsigned posted = 0;
+    if (++posted % SPDLOG_ENQUEUE_SAMPLE_INTERVAL == 0)
+    {
+        auto start = std::chrono::steady_clock::now();
+        post_async_msg_(fill, overflow_policy);
+        record_enqueue_(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+        return;
+    }
+#endif
+    post_async_msg_(fill, overflow_policy);
+}
+
+void thread_pool::post_flush(async_logger *worker_ptr, async_overflow_policy)
+{
+    // control messages always block, they must not be dropped by the overrun policy
+    post_async_msg_([worker_ptr](async_msg &slot) { slot.assign(worker_ptr, async_msg_type::flush); }, async_overflow_policy::block);
+}
+
+void thread_pool::drain()
+{
+    auto barrier = std::make_shared<std::barrier<>>(static_cast<std::ptrdiff_t>(threads_.size() + 1));
+    {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        for (size_t i = 0; i < threads_.size(); i++)
+        {
+            post_async_msg_(
+                [&barrier](async_msg &slot) {
+                    slot.assign(nullptr, async_msg_type::barrier);
+                    slot.barrier = barrier;
+                },
+                async_overflow_policy::block);
+        }
+    }
+    barrier->arrive_and_wait();
+}
+
+void thread_pool::set_flush_policy(const flush_policy &policy)
 {
-    async_msg async_m(std::move(worker_ptr), async_msg_type::log, msg);
-    post_async_msg_(std::move(async_m), overflow_policy);
+    flush_max_bytes_.store(policy.max_bytes, std::memory_order_relaxed);
+    flush_max_age_ms_.store(static_cast<std::int64_t>(policy.max_age.count()), std::memory_order_relaxed);
+    flush_level_.store(static_cast<int>(policy.flush_level), std::memory_order_relaxed);
 }
 
-void thread_pool::post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy)
+flush_policy thread_pool::get_flush_policy() const
 {
-    post_async_msg_(async_msg(std::move(worker_ptr), async_msg_type::flush), overflow_policy);
+    flush_policy policy;
+    policy.max_bytes = flush_max_bytes_.load(std::memory_order_relaxed);
+    policy.max_age = std::chrono::milliseconds(flush_max_age_ms_.load(std::memory_order_relaxed));
+    policy.flush_level = static_cast<level::level_enum>(flush_level_.load(std::memory_order_relaxed));
+    return policy;
 }
 
 size_t thread_pool::overrun_counter()
@@ -63,43 +112,124 @@ size_t thread_pool::overrun_counter()
     return q_.overrun_counter();
 }
 
-void thread_pool::post_async_msg_(async_msg &&new_msg, async_overflow_policy overflow_policy)
+size_t thread_pool::queue_size()
+{
+    return q_.size();
+}
+
+size_t thread_pool::queue_capacity() const
+{
+    return q_max_items_;
+}
+
+enqueue_stats thread_pool::take_enqueue_stats()
+{
+    enqueue_stats stats;
+    stats.count = enqueue_count_.exchange(0, std::memory_order_relaxed);
+    stats.total = std::chrono::nanoseconds(enqueue_ns_total_.exchange(0, std::memory_order_relaxed));
+    stats.max = std::chrono::nanoseconds(enqueue_ns_max_.exchange(0, std::memory_order_relaxed));
+    return stats;
+}
+
+void thread_pool::record_enqueue_(std::chrono::nanoseconds elapsed)
+{
+    const auto ns = static_cast<std::int64_t>(elapsed.count());
+    enqueue_count_.fetch_add(1, std::memory_order_relaxed);
+    enqueue_ns_total_.fetch_add(ns, std::memory_order_relaxed);
+    auto current_max = enqueue_ns_max_.load(std::memory_order_relaxed);
+    while (ns > current_max && !enqueue_ns_max_.compare_exchange_weak(current_max, ns, std::memory_order_relaxed)) {}
+}
+
+template<typename Fill>
+void thread_pool::post_async_msg_(Fill &&fill, async_overflow_policy overflow_policy)
 {
     if (overflow_policy == async_overflow_policy::block)
     {
-        q_.enqueue(std::move(new_msg));
+        q_.enqueue_fill(std::forward<Fill>(fill));
     }
     else
     {
-        q_.enqueue_nowait(std::move(new_msg));
+        // only log messages are overrun: a lost barrier, flush or terminate would hang whoever waits for it
+        q_.enqueue_fill_nowait(std::forward<Fill>(fill), [](const async_msg &oldest) { return oldest.msg_type != async_msg_type::log; });
     }
 }
 
 void thread_pool::worker_loop_()
 {
-    while (process_next_msg_()) {}
+    async_msg incoming_async_msg;
+    unflushed_state unflushed;
+    while (process_next_msg_(incoming_async_msg, unflushed)) {}
+    flush_unflushed_(unflushed);
 }
 
 // process next message in the queue
 // return true if this thread should still be active (while no terminate msg
 // was received)
-bool thread_pool::process_next_msg_()
+bool thread_pool::process_next_msg_(async_msg &incoming_async_msg, unflushed_state &unflushed)
 {
-    async_msg incoming_async_msg;
-    bool dequeued = q_.dequeue_for(incoming_async_msg, std::chrono::seconds(10));
+    // with nothing to flush, just wait for messages. otherwise wake up in time for the age limit.
+    auto max_age = std::chrono::milliseconds(flush_max_age_ms_.load(std::memory_order_relaxed));
+    auto wait_duration = std::chrono::milliseconds(std::chrono::seconds(10));
+    if (!unflushed.loggers.empty())
+    {
+        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - unflushed.oldest);
+        wait_duration = (std::max)(max_age - age, std::chrono::milliseconds(0));
+    }
+
+    bool dequeued = q_.dequeue_copy_for(incoming_async_msg, wait_duration);
     if (!dequeued)
     {
+        if (!unflushed.loggers.empty() && std::chrono::steady_clock::now() - unflushed.oldest >= max_age)
+        {
+            flush_unflushed_(unflushed);
+        }
         return true;
     }
 
     switch (incoming_async_msg.msg_type)
     {
     case async_msg_type::log: {
-        incoming_async_msg.worker_ptr->backend_sink_it_(incoming_async_msg);
+        auto *logger = incoming_async_msg.worker_ptr;
+        logger->backend_sink_it_(incoming_async_msg);
+
+        auto now = std::chrono::steady_clock::now();
+        if (unflushed.loggers.empty())
+        {
+            unflushed.oldest = now;
+        }
+        if (std::find(unflushed.loggers.begin(), unflushed.loggers.end(), logger) == unflushed.loggers.end())
+        {
+            unflushed.loggers.push_back(logger);
+        }
+        // the payload size stands in for the formatted size, close enough for a limit
+        unflushed.bytes += incoming_async_msg.payload.size();
+
+        if (unflushed.bytes >= flush_max_bytes_.load(std::memory_order_relaxed) ||
+            static_cast<int>(incoming_async_msg.level) >= flush_level_.load(std::memory_order_relaxed) || now - unflushed.oldest >= max_age)
+        {
+            flush_unflushed_(unflushed);
+        }
         return true;
     }
     case async_msg_type::flush: {
         incoming_async_msg.worker_ptr->backend_flush_();
+        auto it = std::find(unflushed.loggers.begin(), unflushed.loggers.end(), incoming_async_msg.worker_ptr);
+        if (it != unflushed.loggers.end())
+        {
+            unflushed.loggers.erase(it);
+        }
+        if (unflushed.loggers.empty())
+        {
+            unflushed.bytes = 0;
+        }
+        return true;
+    }
+
+    case async_msg_type::barrier: {
+        // the logger being destroyed may be in the unflushed list, it must not be touched afterwards
+        flush_unflushed_(unflushed);
+        incoming_async_msg.barrier->arrive_and_wait();
+        incoming_async_msg.barrier.reset();
         return true;
     }
 
@@ -115,5 +245,15 @@ bool thread_pool::process_next_msg_()
     return true;
 }
 
+void thread_pool::flush_unflushed_(unflushed_state &unflushed)
+{
+    for (auto *logger : unflushed.loggers)
+    {
+        logger->backend_flush_();
+    }
+    unflushed.loggers.clear();
+    unflushed.bytes = 0;
+}
+
 } // namespace details
 } // namespace spdlog
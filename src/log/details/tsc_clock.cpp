@@ -0,0 +1,236 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <spdlog/details/tsc_clock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#if defined(SPDLOG_TSC_SUPPORTED) && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+namespace spdlog {
+namespace details {
+
+namespace {
+
+// initial calibration, blocks the first caller of tsc_clock::available() (the registry's constructor)
+constexpr auto calibration_period = std::chrono::milliseconds(10);
+// how often the tick rate is refined over the whole period since startup (a 10ms calibration
+// alone drifts by up to ~100ppm) and the conversion is steered towards the wall clock
+constexpr auto recalibration_interval = std::chrono::seconds(1);
+// the steering rate limit, like adjtime(): a wall clock step (ntp, the user) is slewed in
+// instead of making the timestamps jump
+constexpr double max_slew = 0.0005;
+
+bool has_invariant_tsc() noexcept
+{
+#if defined(SPDLOG_TSC_SUPPORTED) && defined(_MSC_VER)
+    int regs[4] = {};
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007u)
+    {
+        return false;
+    }
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#elif defined(SPDLOG_TSC_SUPPORTED)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000007u || !__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// read the tsc as close as possible to the clock sample (middle of the two tsc reads)
+template<typename Clock>
+std::uint64_t sample(typename Clock::time_point &time_point) noexcept
+{
+    auto before = tsc_clock::ticks();
+    time_point = Clock::now();
+    auto after = tsc_clock::ticks();
+    return before + (after - before) / 2;
+}
+
+template<typename Duration>
+std::int64_t to_ns(Duration d) noexcept
+{
+    return static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+// Conversion parameters, published with a seqlock: written by one thread at a time
+// (under recalibration_mutex_), read lock-free by the formatting threads.
+//
+// The conversion is anchored to the wall clock once. Recalibrating starts a new linear segment
+// at the current tick, continuing the previous one there, so a timestamp never jumps backwards.
+// The previous segment is kept for the ticks before it (messages formatted late).
+class calibration
+{
+public:
+    calibration() noexcept
+    {
+        if (!has_invariant_tsc())
+        {
+            return;
+        }
+
+        first_ticks_ = sample<std::chrono::steady_clock>(first_steady_);
+        std::this_thread::sleep_for(calibration_period);
+
+        std::chrono::steady_clock::time_point steady_now;
+        std::chrono::system_clock::time_point wall_now;
+        auto ticks_now = sample<std::chrono::steady_clock>(steady_now);
+        auto wall_ticks = sample<std::chrono::system_clock>(wall_now);
+
+        auto elapsed_ns = to_ns(steady_now - first_steady_);
+        if (ticks_now <= first_ticks_ || elapsed_ns <= 0)
+        {
+            return;
+        }
+
+        segment anchor{wall_ticks, to_ns(wall_now.time_since_epoch()), static_cast<double>(elapsed_ns) / static_cast<double>(ticks_now - first_ticks_)};
+        publish_(anchor, anchor);
+        valid_ = true;
+    }
+
+    bool valid() const noexcept
+    {
+        return valid_;
+    }
+
+    log_clock::time_point to_time_point(std::uint64_t ticks, bool recalibrate) noexcept
+    {
+        segment previous, current;
+        read_(previous, current);
+
+        auto ns = ticks < current.base_ticks ? previous.at(ticks) : current.at(ticks);
+
+        if (recalibrate && static_cast<std::int64_t>(ticks - current.base_ticks) > 0 &&
+            ns - current.base_ns > to_ns(recalibration_interval) && recalibration_mutex_.try_lock())
+        {
+            std::lock_guard<std::mutex> lock(recalibration_mutex_, std::adopt_lock);
+            recalibrate_();
+        }
+
+        return log_clock::time_point(std::chrono::duration_cast<log_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+private:
+    struct segment
+    {
+        std::uint64_t base_ticks;
+        std::int64_t base_ns;
+        double ns_per_tick;
+
+        std::int64_t at(std::uint64_t ticks) const noexcept
+        {
+            auto delta_ticks = static_cast<std::int64_t>(ticks - base_ticks);
+            return base_ns + static_cast<std::int64_t>(static_cast<double>(delta_ticks) * ns_per_tick);
+        }
+    };
+
+    void read_(segment &previous, segment &current) const noexcept
+    {
+        for (;;)
+        {
+            auto seq = seq_.load(std::memory_order_acquire);
+            if (seq & 1)
+            {
+                continue;
+            }
+            previous = {previous_base_ticks_.load(std::memory_order_relaxed), previous_base_ns_.load(std::memory_order_relaxed),
+                previous_ns_per_tick_.load(std::memory_order_relaxed)};
+            current = {base_ticks_.load(std::memory_order_relaxed), base_ns_.load(std::memory_order_relaxed),
+                ns_per_tick_.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == seq)
+            {
+                return;
+            }
+        }
+    }
+
+    void publish_(const segment &previous, const segment &current) noexcept
+    {
+        auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        previous_base_ticks_.store(previous.base_ticks, std::memory_order_relaxed);
+        previous_base_ns_.store(previous.base_ns, std::memory_order_relaxed);
+        previous_ns_per_tick_.store(previous.ns_per_tick, std::memory_order_relaxed);
+        base_ticks_.store(current.base_ticks, std::memory_order_relaxed);
+        base_ns_.store(current.base_ns, std::memory_order_relaxed);
+        ns_per_tick_.store(current.ns_per_tick, std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    // measure the tick rate since first_ticks_ and start a new segment at the current tick, with the
+    // rate adjusted (by at most max_slew) to catch up with the wall clock over the next interval.
+    void recalibrate_() noexcept
+    {
+        std::chrono::steady_clock::time_point steady_now;
+        std::chrono::system_clock::time_point wall_now;
+        auto ticks_now = sample<std::chrono::steady_clock>(steady_now);
+        auto wall_ticks = sample<std::chrono::system_clock>(wall_now);
+
+        auto elapsed_ns = to_ns(steady_now - first_steady_);
+        if (ticks_now <= first_ticks_ || elapsed_ns <= 0)
+        {
+            return;
+        }
+        auto measured_ns_per_tick = static_cast<double>(elapsed_ns) / static_cast<double>(ticks_now - first_ticks_);
+
+        segment previous, current;
+        read_(previous, current);
+
+        segment next{ticks_now, current.at(ticks_now), measured_ns_per_tick};
+        auto wall_ns = to_ns(wall_now.time_since_epoch()) + static_cast<std::int64_t>(static_cast<double>(static_cast<std::int64_t>(ticks_now - wall_ticks)) * measured_ns_per_tick);
+        auto slew = static_cast<double>(wall_ns - next.base_ns) / static_cast<double>(to_ns(recalibration_interval));
+        next.ns_per_tick *= 1.0 + std::max(-max_slew, std::min(max_slew, slew));
+
+        publish_(current, next);
+    }
+
+    bool valid_ = false;
+    std::uint64_t first_ticks_ = 0;
+    std::chrono::steady_clock::time_point first_steady_{};
+
+    std::atomic<std::uint32_t> seq_{0};
+    std::atomic<std::uint64_t> previous_base_ticks_{0};
+    std::atomic<std::int64_t> previous_base_ns_{0};
+    std::atomic<double> previous_ns_per_tick_{0.0};
+    std::atomic<std::uint64_t> base_ticks_{0};
+    std::atomic<std::int64_t> base_ns_{0};
+    std::atomic<double> ns_per_tick_{0.0};
+
+    std::mutex recalibration_mutex_;
+};
+
+calibration &get_calibration() noexcept
+{
+    static calibration instance;
+    return instance;
+}
+
+} // namespace
+
+bool tsc_clock::available() noexcept
+{
+    return get_calibration().valid();
+}
+
+log_clock::time_point tsc_clock::to_time_point(std::uint64_t ticks, bool recalibrate) noexcept
+{
+    return get_calibration().to_time_point(ticks, recalibrate);
+}
+
+} // namespace details
+} // namespace spdlog
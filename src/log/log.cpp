@@ -1 +1,137 @@
 #include "log.h"
+
+#include <future>
+#include <string>
+#include <thread>
+
+log_category::log_category(const char* name, spdlog::level::level_enum level)
+    : name_(name), level_(static_cast<int>(level))
+{
+    next_ = first_();
+    first_() = this;
+}
+
+log_category*& log_category::first_()
+{
+    static log_category* first{ nullptr };
+
+    return first;
+}
+
+log_category* log_category::find(std::string_view name)
+{
+    for (auto* category = first_(); category != nullptr; category = category->next_)
+    {
+        if (name == category->name_)
+        {
+            return category;
+        }
+    }
+
+    return nullptr;
+}
+
+void log_category::configure(std::string_view spec)
+{
+    while (!spec.empty())
+    {
+        auto end = spec.find(',');
+        auto entry = spec.substr(0, end);
+        spec = end == std::string_view::npos ? std::string_view{} : spec.substr(end + 1);
+
+        if (entry.empty())
+        {
+            continue;
+        }
+
+        auto separator = entry.find('=');
+        auto level_name = separator == std::string_view::npos ? entry : entry.substr(separator + 1);
+        auto level = spdlog::level::from_str(std::string(level_name));
+
+        // from_str() returns off for anything it doesn't know
+        if (level == spdlog::level::off && level_name != "off")
+        {
+            SPDLOG_WARN("Unknown log level '{}' in log category spec.", level_name);
+            continue;
+        }
+
+        if (separator == std::string_view::npos)
+        {
+            for (auto* category = first_(); category != nullptr; category = category->next_)
+            {
+                category->set_level(level);
+            }
+
+            continue;
+        }
+
+        auto name = entry.substr(0, separator);
+
+        if (auto* category = find(name))
+        {
+            category->set_level(level);
+        }
+        else
+        {
+            SPDLOG_WARN("Unknown log category '{}'.", name);
+        }
+    }
+}
+
+log_queue_stats take_log_queue_stats()
+{
+    log_queue_stats stats;
+
+    auto thread_pool = spdlog::thread_pool();
+
+    if (!thread_pool || !std::dynamic_pointer_cast<spdlog::async_logger>(spdlog::default_logger()))
+    {
+        return stats;
+    }
+
+    auto enqueue_stats = thread_pool->take_enqueue_stats();
+
+    stats.asynchronous = true;
+    stats.queue_depth = thread_pool->queue_size();
+    stats.queue_capacity = thread_pool->queue_capacity();
+    stats.overrun_counter = thread_pool->overrun_counter();
+    stats.enqueued = enqueue_stats.count * SPDLOG_ENQUEUE_SAMPLE_INTERVAL;
+    stats.enqueue_latency_max = enqueue_stats.max;
+
+    if (enqueue_stats.count > 0)
+    {
+        stats.enqueue_latency_average = enqueue_stats.total / enqueue_stats.count;
+    }
+
+    return stats;
+}
+
+void drain_log()
+{
+    auto thread_pool = spdlog::thread_pool();
+
+    if (thread_pool)
+    {
+        thread_pool->drain();
+    }
+}
+
+bool drain_log(std::chrono::milliseconds timeout)
+{
+    auto thread_pool = spdlog::thread_pool();
+
+    if (!thread_pool)
+    {
+        return true;
+    }
+
+    auto drained = std::make_shared<std::promise<void>>();
+    auto future = drained->get_future();
+
+    std::thread([thread_pool, drained]() {
+        thread_pool->drain();
+        drained->set_value();
+    }).detach();
+
+    return future.wait_for(timeout) == std::future_status::ready;
+}
@@ -3,8 +3,171 @@
 
 #include "log/spdlog/spdlog.h"
 #include "log/spdlog/async.h"
+#include "log/spdlog/details/flight_recorder.h"
 
-//#define DECLARE_LOG_CATEGORY(name) ;
-//#define DEFINE_LOG_CATEGORY(name) ;
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+
+// A log category groups the messages of one module, it has two levels:
+// - a compile-time floor, given to DECLARE_LOG_CATEGORY. Calls below it (or below SPDLOG_ACTIVE_LEVEL)
+//   are discarded by 'if constexpr', their arguments are never evaluated.
+// - a runtime level, checked with one relaxed atomic load before anything else is done.
+//   Disabled calls cost that one (well predicted) branch, again without evaluating the arguments.
+// Messages that pass both go to the default logger, which applies its own level and the sink levels.
+//
+// header:  DECLARE_LOG_CATEGORY(engine, SPDLOG_LEVEL_TRACE);
+// source:  DEFINE_LOG_CATEGORY(engine);
+// use:     LOG_DEBUG(engine, "Created {} images.", count);
+// hot loops: LOG_TRACE_EVERY_N(engine, 100, ...) and LOG_WARN_RATE_LIMITED(engine, 1, ...), see spdlog.h.
+class log_category
+{
+public:
+    log_category(const char* name, spdlog::level::level_enum level);
+
+    log_category(const log_category&) = delete;
+    log_category& operator=(const log_category&) = delete;
+
+    const char* name() const
+    {
+        return name_;
+    }
+
+    bool should_log(spdlog::level::level_enum level) const
+    {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    spdlog::level::level_enum level() const
+    {
+        return static_cast<spdlog::level::level_enum>(level_.load(std::memory_order_relaxed));
+    }
+
+    void set_level(spdlog::level::level_enum level)
+    {
+        level_.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    // All categories defined in the program, nullptr if there is no category with that name.
+    static log_category* find(std::string_view name);
+
+    // Set runtime levels from a spec like "debug,engine=trace,validation=warn", a level without a
+    // name applies to all categories. Unknown names and levels are reported and skipped.
+    static void configure(std::string_view spec);
+
+private:
+    const char* name_;
+    std::atomic<int> level_;
+
+    // intrusive list of all categories, only appended to during static initialization
+    log_category* next_{ nullptr };
+    static log_category*& first_();
+};
+
+#define DECLARE_LOG_CATEGORY(name, compile_time_level)                                                                 \
+    struct log_category_##name##_floor                                                                                 \
+    {                                                                                                                  \
+        constexpr static int LEVEL =                                                                                   \
+            (compile_time_level) > SPDLOG_ACTIVE_LEVEL ? (compile_time_level) : SPDLOG_ACTIVE_LEVEL;                   \
+    };                                                                                                                 \
+    extern log_category log_category_##name
+
+#define DEFINE_LOG_CATEGORY(name) log_category log_category_##name(#name, spdlog::level::trace)
+
+#define LOG_CALL(category, level, ...)                                                                                 \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (static_cast<int>(level) >= log_category_##category##_floor::LEVEL)                               \
+        {                                                                                                              \
+            if (log_category_##category.should_log(level))                                                             \
+            {                                                                                                          \
+                SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(), level, __VA_ARGS__);                                  \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+#define LOG_CALL_EVERY_N(category, level, n, ...)                                                                      \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (static_cast<int>(level) >= log_category_##category##_floor::LEVEL)                               \
+        {                                                                                                              \
+            if (log_category_##category.should_log(level))                                                             \
+            {                                                                                                          \
+                SPDLOG_LOGGER_CALL_EVERY_N(spdlog::default_logger_raw(), level, n, __VA_ARGS__);                       \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+#define LOG_CALL_RATE_LIMITED(category, level, per_second, ...)                                                        \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if constexpr (static_cast<int>(level) >= log_category_##category##_floor::LEVEL)                               \
+        {                                                                                                              \
+            if (log_category_##category.should_log(level))                                                             \
+            {                                                                                                          \
+                SPDLOG_LOGGER_CALL_RATE_LIMITED(spdlog::default_logger_raw(), level, per_second, __VA_ARGS__);         \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+#define LOG_TRACE(category, ...) LOG_CALL(category, spdlog::level::trace, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_CALL(category, spdlog::level::debug, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_CALL(category, spdlog::level::info, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG_CALL(category, spdlog::level::warn, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_CALL(category, spdlog::level::err, __VA_ARGS__)
+#define LOG_CRITICAL(category, ...) LOG_CALL(category, spdlog::level::critical, __VA_ARGS__)
+
+#define LOG_TRACE_EVERY_N(category, n, ...) LOG_CALL_EVERY_N(category, spdlog::level::trace, n, __VA_ARGS__)
+#define LOG_DEBUG_EVERY_N(category, n, ...) LOG_CALL_EVERY_N(category, spdlog::level::debug, n, __VA_ARGS__)
+#define LOG_INFO_EVERY_N(category, n, ...) LOG_CALL_EVERY_N(category, spdlog::level::info, n, __VA_ARGS__)
+#define LOG_WARN_EVERY_N(category, n, ...) LOG_CALL_EVERY_N(category, spdlog::level::warn, n, __VA_ARGS__)
+#define LOG_ERROR_EVERY_N(category, n, ...) LOG_CALL_EVERY_N(category, spdlog::level::err, n, __VA_ARGS__)
+
+#define LOG_TRACE_RATE_LIMITED(category, per_second, ...) LOG_CALL_RATE_LIMITED(category, spdlog::level::trace, per_second, __VA_ARGS__)
+#define LOG_DEBUG_RATE_LIMITED(category, per_second, ...) LOG_CALL_RATE_LIMITED(category, spdlog::level::debug, per_second, __VA_ARGS__)
+#define LOG_INFO_RATE_LIMITED(category, per_second, ...) LOG_CALL_RATE_LIMITED(category, spdlog::level::info, per_second, __VA_ARGS__)
+#define LOG_WARN_RATE_LIMITED(category, per_second, ...) LOG_CALL_RATE_LIMITED(category, spdlog::level::warn, per_second, __VA_ARGS__)
+#define LOG_ERROR_RATE_LIMITED(category, per_second, ...) LOG_CALL_RATE_LIMITED(category, spdlog::level::err, per_second, __VA_ARGS__)
+
+struct log_queue_stats
+{
+    bool asynchronous{ false };
+
+    std::size_t queue_depth{ 0 };
+    std::size_t queue_capacity{ 0 };
+    std::size_t overrun_counter{ 0 };
+
+    // Estimated from the messages sampled for the enqueue latency (SPDLOG_ENQUEUE_SAMPLE_INTERVAL).
+    std::size_t enqueued{ 0 };
+    std::chrono::nanoseconds enqueue_latency_average{ 0 };
+    std::chrono::nanoseconds enqueue_latency_max{ 0 };
+};
+
+// Stats of the global logging thread pool, the enqueue latency covers the time since the previous call.
+log_queue_stats take_log_queue_stats();
+
+// First sink of the default logger of type Sink, nullptr if there is none.
+template<typename Sink>
+std::shared_ptr<Sink> find_log_sink()
+{
+    for (auto& sink : spdlog::default_logger_raw()->sinks())
+    {
+        if (auto found = std::dynamic_pointer_cast<Sink>(sink))
+        {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+// Block until everything logged so far went through the sinks, call before aborting.
+// Does nothing when the default logger is synchronous.
+void drain_log();
+
+// Same, but gives up after timeout (false), for crash paths where the logging thread may be stuck.
+// The drain goes on in a detached thread after a timeout.
+bool drain_log(std::chrono::milliseconds timeout);
 
 #endif
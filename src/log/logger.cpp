@@ -4,6 +4,7 @@
 #include <spdlog/logger.h>
 #include <spdlog/sinks/sink.h>
 #include <spdlog/pattern_formatter.h>
+#include <spdlog/details/flight_recorder.h>
 
 #include <memory>
 #include <mutex>
@@ -138,6 +139,8 @@ std::shared_ptr<logger> logger::clone(std::string logger_name)
 
 void logger::sink_it_(const details::log_msg &msg)
 {
+    details::flight_recorder::record(msg);
+
     for (auto &sink : sinks_)
     {
         if (sink->should_log(msg.level))
@@ -1021,6 +1021,18 @@ std::unique_ptr<formatter> pattern_formatter::clone() const
 
 void pattern_formatter::format(const details::log_msg &msg, memory_buf_t &dest)
 {
+    if (msg.tsc != 0)
+    {
+        // tsc timestamped message, convert to wall clock time only now
+        details::log_msg resolved(msg);
+        resolved.time = msg.resolved_time();
+        resolved.tsc = 0;
+        format(resolved, dest);
+        msg.color_range_start = resolved.color_range_start;
+        msg.color_range_end = resolved.color_range_end;
+        return;
+    }
+
     auto secs = std::chrono::duration_cast<std::chrono::seconds>(msg.time.time_since_epoch());
     if (secs != last_log_secs_)
     {
@@ -15,6 +15,7 @@ template<typename ConsoleMutex>
 ansicolor_sink<ConsoleMutex>::ansicolor_sink(FILE *target_file, color_mode mode)
     : target_file_(target_file)
     , mutex_(ConsoleMutex::mutex())
+    , should_flush_lines_(details::os::in_terminal(target_file))
     , formatter_(std::make_unique<spdlog::pattern_formatter>())
 
 {
@@ -40,27 +41,40 @@ void ansicolor_sink<ConsoleMutex>::log(const details::log_msg &msg)
 {
     // Wrap the originally formatted message in color codes.
     // If color is not supported in the terminal, log as is instead.
+    // The buffers are reused, so logging a line doesn't allocate once they have grown.
+    static thread_local memory_buf_t formatted;
+    static thread_local memory_buf_t line;
+
     std::lock_guard<mutex_t> lock(mutex_);
     msg.color_range_start = 0;
     msg.color_range_end = 0;
-    memory_buf_t formatted;
+    formatted.clear();
     formatter_->format(msg, formatted);
+
+    line.clear();
+    auto *data = formatted.data();
     if (should_do_colors_ && msg.color_range_end > msg.color_range_start)
     {
+        const auto &color = colors_[msg.level];
         // before color range
-        print_range_(formatted, 0, msg.color_range_start);
+        line.append(data, data + msg.color_range_start);
         // in color range
-        print_ccode_(colors_[msg.level]);
-        print_range_(formatted, msg.color_range_start, msg.color_range_end);
-        print_ccode_(reset);
+        line.append(color.data(), color.data() + color.size());
+        line.append(data + msg.color_range_start, data + msg.color_range_end);
+        line.append(reset.data(), reset.data() + reset.size());
         // after color range
-        print_range_(formatted, msg.color_range_end, formatted.size());
+        line.append(data + msg.color_range_end, data + formatted.size());
     }
     else // no color
     {
-        print_range_(formatted, 0, formatted.size());
+        line.append(data, data + formatted.size());
+    }
+
+    fwrite(line.data(), sizeof(char), line.size(), target_file_);
+    if (should_flush_lines_)
+    {
+        fflush(target_file_);
     }
-    fflush(target_file_);
 }
 
 template<typename ConsoleMutex>
@@ -107,18 +121,6 @@ void ansicolor_sink<ConsoleMutex>::set_color_mode(color_mode mode)
     }
 }
 
-template<typename ConsoleMutex>
-void ansicolor_sink<ConsoleMutex>::print_ccode_(const string_view_t &color_code)
-{
-    fwrite(color_code.data(), sizeof(char), color_code.size(), target_file_);
-}
-
-template<typename ConsoleMutex>
-void ansicolor_sink<ConsoleMutex>::print_range_(const memory_buf_t &formatted, size_t start, size_t end)
-{
-    fwrite(formatted.data() + start, sizeof(char), end - start, target_file_);
-}
-
 template<typename ConsoleMutex>
 std::string ansicolor_sink<ConsoleMutex>::to_string_(const string_view_t &sv)
 {
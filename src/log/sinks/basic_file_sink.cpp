@@ -11,7 +11,8 @@ namespace spdlog {
 namespace sinks {
 
 template<typename Mutex>
-basic_file_sink<Mutex>::basic_file_sink(const filename_t &filename, bool truncate)
+basic_file_sink<Mutex>::basic_file_sink(const filename_t &filename, bool truncate, bool flush_every_message)
+    : flush_every_message_(flush_every_message)
 {
     file_helper_.open(filename, truncate);
 }
@@ -28,7 +29,10 @@ void basic_file_sink<Mutex>::sink_it_(const details::log_msg &msg)
     memory_buf_t formatted;
     base_sink<Mutex>::formatter_->format(msg, formatted);
     file_helper_.write(formatted);
-    file_helper_.flush();
+    if (flush_every_message_)
+    {
+        file_helper_.flush();
+    }
 }
 
 template<typename Mutex>
@@ -0,0 +1,277 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <spdlog/sinks/binary_file_sink.h>
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+#include <spdlog/details/null_mutex.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace spdlog {
+namespace sinks {
+
+namespace {
+
+namespace bl = details::binary_log;
+
+struct file_closer
+{
+    void operator()(std::FILE *fd) const
+    {
+        std::fclose(fd);
+    }
+};
+
+using file_ptr = std::unique_ptr<std::FILE, file_closer>;
+
+bool read_at(std::FILE *fd, std::uint64_t offset, void *data, size_t size)
+{
+#ifdef _WIN32
+    if (::_fseeki64(fd, static_cast<__int64>(offset), SEEK_SET) != 0)
+#else
+    if (::fseeko(fd, static_cast<off_t>(offset), SEEK_SET) != 0)
+#endif
+    {
+        return false;
+    }
+    return std::fread(data, 1, size, fd) == size;
+}
+
+template<typename T>
+void append_pod(memory_buf_t &buf, const T &value)
+{
+    auto *begin = reinterpret_cast<const char *>(&value);
+    buf.append(begin, begin + sizeof(T));
+}
+
+} // namespace
+
+template<typename Mutex>
+binary_file_sink<Mutex>::binary_file_sink(const filename_t &filename, bool truncate, size_t block_size)
+    : block_size_((std::max)(block_size, size_t{4096}))
+{
+    bool append = !truncate && details::os::path_exists(filename) && load_index_(filename);
+
+    file_helper_.open(filename, !append);
+
+    if (append)
+    {
+        file_size_ = file_helper_.size();
+    }
+    else
+    {
+        bl::file_header header{};
+        std::memcpy(header.magic, bl::file_magic, sizeof(header.magic));
+        header.version = bl::format_version;
+        memory_buf_t buf;
+        append_pod(buf, header);
+        file_helper_.write(buf);
+        file_size_ = buf.size();
+    }
+
+    reset_block_();
+}
+
+template<typename Mutex>
+binary_file_sink<Mutex>::~binary_file_sink()
+{
+    SPDLOG_TRY
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::mutex_);
+        write_index_();
+    }
+    SPDLOG_CATCH_ALL() {}
+}
+
+template<typename Mutex>
+const filename_t &binary_file_sink<Mutex>::filename() const
+{
+    return file_helper_.filename();
+}
+
+template<typename Mutex>
+void binary_file_sink<Mutex>::sink_it_(const details::log_msg &msg)
+{
+    auto time = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(msg.resolved_time().time_since_epoch()).count());
+
+    constexpr size_t max_string = (std::numeric_limits<std::uint16_t>::max)();
+    auto logger_name_size = (std::min)(msg.logger_name.size(), max_string);
+    auto filename_size = msg.source.filename != nullptr ? (std::min)(std::strlen(msg.source.filename), max_string) : size_t{0};
+    auto funcname_size = msg.source.funcname != nullptr ? (std::min)(std::strlen(msg.source.funcname), max_string) : size_t{0};
+    auto payload_size = (std::min)(msg.payload.size(), size_t{(std::numeric_limits<std::uint32_t>::max)()} - 1024);
+
+    auto unpadded_size = sizeof(bl::record_header) + logger_name_size + filename_size + funcname_size + payload_size;
+    auto record_size = bl::padded_size(unpadded_size);
+
+    if (block_header_.record_count > 0 && block_.size() + record_size > block_size_)
+    {
+        write_block_();
+    }
+
+    bl::record_header header{};
+    header.size = static_cast<std::uint32_t>(record_size);
+    header.level = static_cast<std::uint8_t>(msg.level);
+    header.logger_name_size = static_cast<std::uint16_t>(logger_name_size);
+    header.time = time;
+    header.thread_id = msg.thread_id;
+    header.line = msg.source.line;
+    header.filename_size = static_cast<std::uint16_t>(filename_size);
+    header.funcname_size = static_cast<std::uint16_t>(funcname_size);
+    header.payload_size = static_cast<std::uint32_t>(payload_size);
+
+    append_pod(block_, header);
+    block_.append(msg.logger_name.data(), msg.logger_name.data() + logger_name_size);
+    if (filename_size > 0)
+    {
+        block_.append(msg.source.filename, msg.source.filename + filename_size);
+    }
+    if (funcname_size > 0)
+    {
+        block_.append(msg.source.funcname, msg.source.funcname + funcname_size);
+    }
+    block_.append(msg.payload.data(), msg.payload.data() + payload_size);
+
+    static const char padding[bl::record_alignment] = {};
+    block_.append(padding, padding + (record_size - unpadded_size));
+
+    block_header_.record_count++;
+    block_header_.level_mask |= std::uint32_t{1} << static_cast<unsigned>(msg.level);
+    block_header_.min_time = (std::min)(block_header_.min_time, time);
+    block_header_.max_time = (std::max)(block_header_.max_time, time);
+    block_header_.thread_mask |= bl::thread_bit(msg.thread_id);
+}
+
+template<typename Mutex>
+void binary_file_sink<Mutex>::flush_()
+{
+    write_block_();
+    file_helper_.flush();
+}
+
+template<typename Mutex>
+bool binary_file_sink<Mutex>::load_index_(const filename_t &filename)
+{
+    std::FILE *raw_fd = nullptr;
+    if (details::os::fopen_s(&raw_fd, filename, SPDLOG_FILENAME_T("rb")))
+    {
+        throw_spdlog_ex("binary_file_sink: failed opening file " + details::os::filename_to_str(filename) + " for reading", errno);
+    }
+    file_ptr fd(raw_fd);
+
+    std::uint64_t size = details::os::filesize(fd.get());
+    bl::file_header header{};
+    if (size < sizeof(header))
+    {
+        // empty or died while writing the header, start over
+        return false;
+    }
+
+    if (!read_at(fd.get(), 0, &header, sizeof(header)) || std::memcmp(header.magic, bl::file_magic, sizeof(header.magic)) != 0 ||
+        header.version != bl::format_version)
+    {
+        throw_spdlog_ex("binary_file_sink: " + details::os::filename_to_str(filename) + " is not a binary log file");
+    }
+
+    std::uint64_t valid_size = sizeof(header);
+    bl::index_footer footer{};
+    if (size >= sizeof(header) + sizeof(footer) && read_at(fd.get(), size - sizeof(footer), &footer, sizeof(footer)) &&
+        footer.magic == bl::index_magic && footer.index_offset >= sizeof(header) &&
+        footer.index_offset + footer.entry_count * sizeof(bl::index_entry) + sizeof(footer) == size)
+    {
+        index_.resize(static_cast<size_t>(footer.entry_count));
+        if (!index_.empty() && !read_at(fd.get(), footer.index_offset, index_.data(), index_.size() * sizeof(bl::index_entry)))
+        {
+            throw_spdlog_ex("binary_file_sink: failed reading index of " + details::os::filename_to_str(filename), errno);
+        }
+        valid_size = footer.index_offset;
+    }
+    else
+    {
+        // no index (the file was not closed properly), rebuild it from the block headers
+        // and drop whatever follows the last complete block
+        bl::block_header block{};
+        while (valid_size + sizeof(block) <= size && read_at(fd.get(), valid_size, &block, sizeof(block)) &&
+               block.magic == bl::block_magic && valid_size + sizeof(block) + block.size <= size)
+        {
+            index_.push_back({valid_size, block.min_time, block.max_time, block.thread_mask, block.record_count, block.level_mask});
+            valid_size += sizeof(block) + block.size;
+        }
+    }
+
+    fd.reset();
+
+    std::error_code ec;
+    std::filesystem::resize_file(std::filesystem::path(filename), valid_size, ec);
+    if (ec)
+    {
+        throw_spdlog_ex("binary_file_sink: failed truncating " + details::os::filename_to_str(filename) + ": " + ec.message());
+    }
+    return true;
+}
+
+template<typename Mutex>
+void binary_file_sink<Mutex>::write_block_()
+{
+    if (block_header_.record_count == 0)
+    {
+        return;
+    }
+
+    block_header_.magic = bl::block_magic;
+    block_header_.size = static_cast<std::uint32_t>(block_.size() - sizeof(bl::block_header));
+    std::memcpy(block_.data(), &block_header_, sizeof(block_header_));
+
+    file_helper_.write(block_);
+    index_.push_back({file_size_, block_header_.min_time, block_header_.max_time, block_header_.thread_mask, block_header_.record_count,
+        block_header_.level_mask});
+    file_size_ += block_.size();
+
+    reset_block_();
+}
+
+template<typename Mutex>
+void binary_file_sink<Mutex>::write_index_()
+{
+    write_block_();
+
+    memory_buf_t buf;
+    for (auto &entry : index_)
+    {
+        append_pod(buf, entry);
+    }
+
+    bl::index_footer footer{};
+    footer.index_offset = file_size_;
+    footer.entry_count = index_.size();
+    footer.magic = bl::index_magic;
+    append_pod(buf, footer);
+
+    file_helper_.write(buf);
+    file_helper_.flush();
+    file_size_ += buf.size();
+}
+
+template<typename Mutex>
+void binary_file_sink<Mutex>::reset_block_()
+{
+    block_.clear();
+    block_.resize(sizeof(bl::block_header));
+    block_header_ = bl::block_header{};
+    block_header_.min_time = (std::numeric_limits<std::uint64_t>::max)();
+}
+
+} // namespace sinks
+} // namespace spdlog
+
+template class SPDLOG_API spdlog::sinks::binary_file_sink<std::mutex>;
+template class SPDLOG_API spdlog::sinks::binary_file_sink<spdlog::details::null_mutex>;
@@ -6,30 +6,52 @@
 #include <spdlog/details/os.h>
 #include <spdlog/details/file_helper.h>
 #include <spdlog/details/null_mutex.h>
+#include <spdlog/details/lz4_frame.h>
 #include <spdlog/fmt/fmt.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <ctime>
+#include <filesystem>
 #include <mutex>
 #include <string>
+#include <system_error>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 namespace spdlog {
 namespace sinks {
 
 template<typename Mutex>
-rotating_file_sink<Mutex>::rotating_file_sink(filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open)
+rotating_file_sink<Mutex>::rotating_file_sink(
+    filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open, bool compress)
     : base_filename_(std::move(base_filename))
     , max_size_(max_size)
     , max_files_(max_files)
+    , compress_(compress)
 {
+    queue_leftover_segments_();
     file_helper_.open(calc_filename(base_filename_, 0));
     current_size_ = file_helper_.size(); // expensive. called only once
     if (rotate_on_open && current_size_ > 0)
     {
-        rotate_();
+        rotate_(); // only queues the segment, picked up once the worker starts
+    }
+    worker_thread_ = std::thread([this] { this->worker_loop_(); });
+}
+
+// stop the worker after it archived all pending segments
+template<typename Mutex>
+rotating_file_sink<Mutex>::~rotating_file_sink()
+{
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        worker_active_ = false;
     }
+    worker_cv_.notify_one();
+    worker_thread_.join();
 }
 
 // calc filename according to index and file extension if exists.
@@ -47,6 +69,23 @@ filename_t rotating_file_sink<Mutex>::calc_filename(const filename_t &filename,
     return fmt::format(SPDLOG_FILENAME_T("{}.{}{}"), basename, index, ext);
 }
 
+template<typename Mutex>
+filename_t rotating_file_sink<Mutex>::archive_filename(std::size_t index) const
+{
+    auto archive = calc_filename(base_filename_, index);
+    if (compress_ && index > 0)
+    {
+        archive += details::lz4::extension();
+    }
+    return archive;
+}
+
+template<typename Mutex>
+std::size_t rotating_file_sink<Mutex>::dropped_segments() const
+{
+    return dropped_segments_.load(std::memory_order_relaxed);
+}
+
 template<typename Mutex>
 filename_t rotating_file_sink<Mutex>::filename()
 {
@@ -57,6 +96,8 @@ filename_t rotating_file_sink<Mutex>::filename()
 template<typename Mutex>
 void rotating_file_sink<Mutex>::sink_it_(const details::log_msg &msg)
 {
+    throw_if_worker_failed_();
+
     memory_buf_t formatted;
     base_sink<Mutex>::formatter_->format(msg, formatted);
     current_size_ += formatted.size();
@@ -74,26 +115,143 @@ void rotating_file_sink<Mutex>::flush_()
     file_helper_.flush();
 }
 
-// Rotate files:
-// log.txt -> log.1.txt
-// log.1.txt -> log.2.txt
-// log.2.txt -> log.3.txt
-// log.3.txt -> delete
+// Only the cheap part happens here: move the full file aside under a unique
+// segment name, reopen a fresh file and queue the segment for the worker.
 template<typename Mutex>
 void rotating_file_sink<Mutex>::rotate_()
 {
     using details::os::filename_to_str;
-    using details::os::path_exists;
+    if (max_files_ == 0)
+    {
+        file_helper_.reopen(true);
+        return;
+    }
+
+    filename_t basename, ext;
+    std::tie(basename, ext) = details::file_helper::split_by_extension(base_filename_);
+    filename_t segment = fmt::format(SPDLOG_FILENAME_T("{}.segment{}{}"), basename, segment_counter_++, ext);
+
     file_helper_.close();
-    for (auto i = max_files_; i > 0; --i)
+    if (!rename_file_(base_filename_, segment))
     {
-        filename_t src = calc_filename(base_filename_, i - 1);
-        if (!path_exists(src))
+        // don't sleep and retry on the logging thread (see the worker).
+        file_helper_.reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
+        current_size_ = 0;
+        throw_spdlog_ex("rotating_file_sink: failed renaming " + filename_to_str(base_filename_) + " to " + filename_to_str(segment), errno);
+    }
+    file_helper_.reopen(true);
+
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        queue_segment_(std::move(segment));
+    }
+    worker_cv_.notify_one();
+}
+
+// the worker takes a segment out of the queue before archiving it, so the oldest queued one
+// can always be deleted.
+template<typename Mutex>
+void rotating_file_sink<Mutex>::queue_segment_(filename_t segment)
+{
+    if (max_files_ == 0)
+    {
+        (void)details::os::remove(segment);
+        dropped_segments_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    while (!pending_segments_.empty() && pending_segments_.size() >= max_files_)
+    {
+        (void)details::os::remove(pending_segments_.front());
+        pending_segments_.pop_front();
+        dropped_segments_.fetch_add(1, std::memory_order_relaxed);
+    }
+    pending_segments_.push_back(std::move(segment));
+}
+
+// the segments are named like rotate_() names them: log.segment<n>.txt next to log.txt.
+template<typename Mutex>
+void rotating_file_sink<Mutex>::queue_leftover_segments_()
+{
+    namespace fs = std::filesystem;
+    using char_type = filename_t::value_type;
+
+    filename_t basename, ext;
+    std::tie(basename, ext) = details::file_helper::split_by_extension(base_filename_);
+    const fs::path base_path(basename);
+    const filename_t prefix = base_path.filename().template string<char_type>() + SPDLOG_FILENAME_T(".segment");
+    const fs::path directory = base_path.has_parent_path() ? base_path.parent_path() : fs::path(".");
+
+    std::vector<std::pair<std::size_t, filename_t>> leftovers;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        const auto name = it->path().filename().template string<char_type>();
+        if (name.size() <= prefix.size() + ext.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
         {
             continue;
         }
-        filename_t target = calc_filename(base_filename_, i);
 
+        const auto number = name.substr(prefix.size(), name.size() - prefix.size() - ext.size());
+        if (number.size() > 18 || number.find_first_not_of(SPDLOG_FILENAME_T("0123456789")) != filename_t::npos)
+        {
+            continue;
+        }
+        leftovers.emplace_back(static_cast<std::size_t>(std::stoull(number)), basename + SPDLOG_FILENAME_T(".segment") + number + ext);
+    }
+
+    if (leftovers.empty())
+    {
+        return;
+    }
+
+    std::sort(leftovers.begin(), leftovers.end());
+    for (auto &leftover : leftovers)
+    {
+        queue_segment_(std::move(leftover.second));
+    }
+    segment_counter_ = leftovers.back().first + 1;
+}
+
+template<typename Mutex>
+void rotating_file_sink<Mutex>::worker_loop_()
+{
+    for (;;)
+    {
+        filename_t segment;
+        {
+            std::unique_lock<std::mutex> lock(worker_mutex_);
+            worker_cv_.wait(lock, [this] { return !worker_active_ || !pending_segments_.empty(); });
+            if (pending_segments_.empty())
+            {
+                return; // worker_active_ == false and nothing left to archive
+            }
+            segment = std::move(pending_segments_.front());
+            pending_segments_.pop_front();
+        }
+
+        SPDLOG_TRY
+        {
+            archive_segment_(segment);
+        }
+#ifndef SPDLOG_NO_EXCEPTIONS
+        catch (const std::exception &ex)
+        {
+            std::lock_guard<std::mutex> lock(worker_mutex_);
+            worker_error_ = ex.what();
+            worker_failed_.store(true, std::memory_order_release);
+        }
+#endif
+    }
+}
+
+template<typename Mutex>
+void rotating_file_sink<Mutex>::archive_segment_(const filename_t &segment_filename)
+{
+    using details::os::filename_to_str;
+    using details::os::path_exists;
+
+    auto rename_or_throw = [this](const filename_t &src, const filename_t &target) {
         if (!rename_file_(src, target))
         {
             // if failed try again after a small delay.
@@ -102,13 +260,48 @@ void rotating_file_sink<Mutex>::rotate_()
             details::os::sleep_for_millis(100);
             if (!rename_file_(src, target))
             {
-                file_helper_.reopen(true); // truncate the log file anyway to prevent it to grow beyond its limit!
-                current_size_ = 0;
                 throw_spdlog_ex("rotating_file_sink: failed renaming " + filename_to_str(src) + " to " + filename_to_str(target), errno);
             }
         }
+    };
+
+    for (auto i = max_files_; i > 1; --i)
+    {
+        filename_t src = archive_filename(i - 1);
+        if (!path_exists(src))
+        {
+            continue;
+        }
+        rename_or_throw(src, archive_filename(i));
     }
-    file_helper_.reopen(true);
+
+    if (compress_)
+    {
+        details::lz4::compress_file(segment_filename, archive_filename(1));
+        (void)details::os::remove(segment_filename);
+    }
+    else
+    {
+        rename_or_throw(segment_filename, archive_filename(1));
+    }
+}
+
+template<typename Mutex>
+void rotating_file_sink<Mutex>::throw_if_worker_failed_()
+{
+    if (!worker_failed_.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::string error;
+    {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        error = std::move(worker_error_);
+        worker_error_.clear();
+        worker_failed_.store(false, std::memory_order_relaxed);
+    }
+    throw_spdlog_ex(error);
 }
 
 // delete the target if exists, and rename the src file  to target
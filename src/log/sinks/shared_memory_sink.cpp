@@ -0,0 +1,184 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#include <spdlog/sinks/shared_memory_sink.h>
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+#include <spdlog/details/null_mutex.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+#include <spdlog/details/windows_include.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog {
+namespace sinks {
+
+namespace shm = details::shared_memory_log;
+
+template<typename Mutex>
+shared_memory_sink<Mutex>::shared_memory_sink(std::string name, size_t slot_count)
+    : name_(std::move(name))
+    , slot_count_((std::max)(slot_count, size_t{1}))
+    , size_(shm::segment_size(slot_count_))
+{
+    auto object_name = shm::object_name(name_);
+    void *data = nullptr;
+
+#ifdef _WIN32
+    mapping_ = ::CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<std::uint64_t>(size_) >> 32),
+        static_cast<DWORD>(size_ & 0xFFFFFFFF), object_name.c_str());
+    if (mapping_ == nullptr)
+    {
+        throw_spdlog_ex("shared_memory_sink: failed creating " + object_name, static_cast<int>(::GetLastError()));
+    }
+    data = ::MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, size_);
+    if (data == nullptr)
+    {
+        auto error = static_cast<int>(::GetLastError());
+        ::CloseHandle(mapping_);
+        throw_spdlog_ex("shared_memory_sink: failed mapping " + object_name, error);
+    }
+    // an existing mapping (another instance with the same name) keeps its contents
+    std::memset(data, 0, size_);
+#else
+    // a segment left behind by a crashed process is replaced, its readers keep the old one
+    ::shm_unlink(object_name.c_str());
+    int fd = ::shm_open(object_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+    {
+        throw_spdlog_ex("shared_memory_sink: failed creating " + object_name, errno);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size_)) != 0)
+    {
+        auto error = errno;
+        ::close(fd);
+        ::shm_unlink(object_name.c_str());
+        throw_spdlog_ex("shared_memory_sink: failed resizing " + object_name, error);
+    }
+    data = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    auto error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        ::shm_unlink(object_name.c_str());
+        throw_spdlog_ex("shared_memory_sink: failed mapping " + object_name, error);
+    }
+#endif
+
+    // the segment starts zeroed, the magic is written last so readers don't see a partial header
+    header_ = static_cast<shm::header *>(data);
+    header_->version = shm::format_version;
+    header_->slot_count = static_cast<std::uint32_t>(slot_count_);
+    header_->generation = static_cast<std::uint64_t>(
+                              std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) |
+                          1;
+    header_->writer_pid = static_cast<std::uint64_t>(details::os::pid());
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, shm::magic, sizeof(header_->magic));
+}
+
+template<typename Mutex>
+shared_memory_sink<Mutex>::~shared_memory_sink()
+{
+    header_->closed.store(1, std::memory_order_release);
+
+#ifdef _WIN32
+    ::UnmapViewOfFile(header_);
+    ::CloseHandle(mapping_);
+#else
+    ::munmap(header_, size_);
+    ::shm_unlink(shm::object_name(name_).c_str());
+#endif
+}
+
+template<typename Mutex>
+const std::string &shared_memory_sink<Mutex>::name() const
+{
+    return name_;
+}
+
+template<typename Mutex>
+void shared_memory_sink<Mutex>::set_counter(std::string_view counter_name, std::int64_t value)
+{
+    std::lock_guard<std::mutex> lock(counters_mutex_);
+
+    counter_name = counter_name.substr(0, shm::counter_name_size - 1);
+
+    auto count = header_->counter_count;
+    std::uint32_t index = 0;
+    while (index < count && std::string_view(header_->counters[index].name) != counter_name)
+    {
+        index++;
+    }
+    if (index == shm::counter_capacity)
+    {
+        return;
+    }
+
+    auto sequence = header_->counters_sequence.load(std::memory_order_relaxed);
+    header_->counters_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto &counter = header_->counters[index];
+    if (index == count)
+    {
+        std::memcpy(counter.name, counter_name.data(), counter_name.size());
+        counter.name[counter_name.size()] = '\0';
+        header_->counter_count = count + 1;
+    }
+    counter.value = value;
+
+    header_->counters_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+template<typename Mutex>
+void shared_memory_sink<Mutex>::sink_it_(const details::log_msg &msg)
+{
+    formatted_.clear();
+    base_sink<Mutex>::formatter_->format(msg, formatted_);
+
+    // the slot holds a single line, without the eol
+    size_t size = formatted_.size();
+    while (size > 0 && (formatted_[size - 1] == '\n' || formatted_[size - 1] == '\r'))
+    {
+        size--;
+    }
+    size = (std::min)(size, shm::record_text_size);
+
+    auto index = write_index_++;
+    auto &slot = shm::slots(header_)[index % slot_count_];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.time = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(msg.resolved_time().time_since_epoch()).count());
+    slot.thread_id = msg.thread_id;
+    slot.level = static_cast<std::uint8_t>(msg.level);
+    slot.size = static_cast<std::uint16_t>(size);
+    std::memcpy(slot.text, formatted_.data(), size);
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    header_->write_index.store(write_index_, std::memory_order_release);
+}
+
+template<typename Mutex>
+void shared_memory_sink<Mutex>::flush_()
+{}
+
+} // namespace sinks
+} // namespace spdlog
+
+template class SPDLOG_API spdlog::sinks::shared_memory_sink<std::mutex>;
+template class SPDLOG_API spdlog::sinks::shared_memory_sink<spdlog::details::null_mutex>;
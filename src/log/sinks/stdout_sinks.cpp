@@ -7,6 +7,7 @@
 #include <spdlog/async.h>
 #include <spdlog/sinks/stdout_sinks.h>
 #include <spdlog/details/console_globals.h>
+#include <spdlog/details/os.h>
 #include <spdlog/pattern_formatter.h>
 #include <memory>
 
@@ -18,17 +19,23 @@ template<typename ConsoleMutex>
 stdout_sink_base<ConsoleMutex>::stdout_sink_base(FILE *file)
     : mutex_(ConsoleMutex::mutex())
     , file_(file)
+    , should_flush_lines_(details::os::in_terminal(file))
     , formatter_(std::make_unique<spdlog::pattern_formatter>())
 {}
 
 template<typename ConsoleMutex>
 void stdout_sink_base<ConsoleMutex>::log(const details::log_msg &msg)
 {
+    static thread_local memory_buf_t formatted;
+
     std::lock_guard<mutex_t> lock(mutex_);
-    memory_buf_t formatted;
+    formatted.clear();
     formatter_->format(msg, formatted);
     fwrite(formatted.data(), sizeof(char), formatted.size(), file_);
-    fflush(file_); // flush every line to terminal
+    if (should_flush_lines_)
+    {
+        fflush(file_); // flush every line to terminal
+    }
 }
 
 template<typename ConsoleMutex>
@@ -6,13 +6,11 @@
 //
 // Async logging using global thread pool
 // All loggers created here share same global thread pool.
-// Each log message is pushed to a queue along with a shared pointer to the
-// logger.
-// If a logger deleted while having pending messages in the queue, it's actual
-// destruction will defer
-// until all its messages are processed by the thread pool.
-// This is because each message in the queue holds a shared_ptr to the
-// originating logger.
+// Each log message is copied into a preallocated queue slot along with a raw
+// pointer to the logger.
+// If a logger is deleted while having pending messages in the queue, its
+// destructor blocks until all of its messages are processed by the thread pool.
+// Loggers keep their thread pool alive.
 
 #include <spdlog/async_logger.h>
 #include <spdlog/details/registry.h>
@@ -11,8 +11,8 @@
 //    1. Checks if its log level is enough to log the message
 //    2. Push a new copy of the message to a queue (or block the caller until
 //    space is available in the queue)
-// Upon destruction, logs all remaining messages in the queue before
-// destructing..
+// Upon destruction, waits until the thread pool processed all of its remaining
+// messages (they refer to the logger by raw pointer).
 
 #include <spdlog/logger.h>
 
@@ -39,7 +39,7 @@ public:
     async_logger(std::string logger_name, It begin, It end, std::weak_ptr<details::thread_pool> tp,
         async_overflow_policy overflow_policy = async_overflow_policy::block)
         : logger(std::move(logger_name), begin, end)
-        , thread_pool_(std::move(tp))
+        , thread_pool_(tp.lock())
         , overflow_policy_(overflow_policy)
     {}
 
@@ -49,6 +49,11 @@ public:
     async_logger(std::string logger_name, sink_ptr single_sink, std::weak_ptr<details::thread_pool> tp,
         async_overflow_policy overflow_policy = async_overflow_policy::block);
 
+    async_logger(const async_logger &other) = default;
+
+    // must not be destroyed on one of the thread pool's worker threads
+    ~async_logger() override;
+
     std::shared_ptr<logger> clone(std::string new_name) override;
 
 protected:
@@ -58,7 +63,9 @@ protected:
     void backend_flush_();
 
 private:
-    std::weak_ptr<details::thread_pool> thread_pool_;
+    // held strongly, so that posting a message doesn't lock a weak_ptr (atomic refcount) each time.
+    // the queue no longer holds references to loggers, so this doesn't create a cycle.
+    std::shared_ptr<details::thread_pool> thread_pool_;
     async_overflow_policy overflow_policy_;
 };
 } // namespace spdlog
@@ -0,0 +1,108 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// On disk layout of the files written by binary_file_sink (native byte order).
+//
+//   file_header
+//   block*          block_header followed by record_count records, each one a record_header
+//                   followed by the logger name, filename, funcname and payload bytes,
+//                   padded to record_alignment
+//   index_entry*    one per block
+//   index_footer    at the very end of the file
+//
+// Blocks are self describing, so a file without index (the process died before closing the sink)
+// can still be read by walking the block headers. The index and the block headers carry the
+// time range, the levels and a 64 bit thread bloom mask of their block, so readers can skip
+// whole blocks when filtering.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spdlog {
+namespace details {
+namespace binary_log {
+
+constexpr char file_magic[8] = {'S', 'P', 'D', 'L', 'B', 'I', 'N', '1'};
+constexpr std::uint32_t format_version = 1;
+constexpr std::uint32_t block_magic = 0x314B4C42; // "BLK1"
+constexpr std::uint32_t index_magic = 0x31584449; // "IDX1"
+constexpr std::size_t record_alignment = 8;
+
+struct file_header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+};
+
+struct block_header
+{
+    std::uint32_t magic;
+    // bytes of records following the header
+    std::uint32_t size;
+    std::uint32_t record_count;
+    // bit (1 << level) set for every level present in the block
+    std::uint32_t level_mask;
+    // nanoseconds since epoch
+    std::uint64_t min_time;
+    std::uint64_t max_time;
+    std::uint64_t thread_mask;
+};
+
+struct record_header
+{
+    // total size of the record, including this header and the padding
+    std::uint32_t size;
+    std::uint8_t level;
+    std::uint8_t reserved;
+    std::uint16_t logger_name_size;
+    std::uint64_t time;
+    std::uint64_t thread_id;
+    std::int32_t line;
+    std::uint16_t filename_size;
+    std::uint16_t funcname_size;
+    std::uint32_t payload_size;
+    std::uint32_t reserved2;
+};
+
+struct index_entry
+{
+    // file offset of the block_header
+    std::uint64_t offset;
+    std::uint64_t min_time;
+    std::uint64_t max_time;
+    std::uint64_t thread_mask;
+    std::uint32_t record_count;
+    std::uint32_t level_mask;
+};
+
+struct index_footer
+{
+    std::uint64_t index_offset;
+    std::uint64_t entry_count;
+    std::uint32_t magic;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(file_header) == 16, "unexpected padding");
+static_assert(sizeof(block_header) == 40, "unexpected padding");
+static_assert(sizeof(record_header) == 40, "unexpected padding");
+static_assert(sizeof(index_entry) == 40, "unexpected padding");
+static_assert(sizeof(index_footer) == 24, "unexpected padding");
+
+// bloom bit of a thread id in thread_mask
+inline std::uint64_t thread_bit(std::uint64_t thread_id) noexcept
+{
+    return std::uint64_t{1} << ((thread_id * 0x9E3779B97F4A7C15ull) >> 58);
+}
+
+inline std::size_t padded_size(std::size_t size) noexcept
+{
+    return (size + record_alignment - 1) & ~(record_alignment - 1);
+}
+
+} // namespace binary_log
+} // namespace details
+} // namespace spdlog
@@ -0,0 +1,124 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Per call site limiters used by the SPDLOG_*_EVERY_N and SPDLOG_*_RATE_LIMITED macros.
+//
+// Each macro expansion owns one limiter as a function local static (constant initialized,
+// so no guard variable). Both are lock free and never look at the message itself,
+// unlike dup_filter_sink which compares every formatted payload under the sink lock.
+
+#include <spdlog/common.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace spdlog {
+namespace details {
+
+// Let through the 1st, (n+1)th, (2n+1)th... call.
+class every_n_limiter
+{
+public:
+    constexpr every_n_limiter() noexcept = default;
+
+    bool allow(std::uint64_t n) noexcept
+    {
+        const auto count = counter_.fetch_add(1, std::memory_order_relaxed);
+        return n <= 1 || (count % n) == 0;
+    }
+
+private:
+    std::atomic<std::uint64_t> counter_{0};
+};
+
+// Token bucket (implemented as GCRA - a single "theoretical arrival time").
+// Allows bursts of up to "burst" calls, refilled at "per_second" calls per second.
+// Keeps count of the rejected calls, handed out to the next allowed call.
+// A call site that goes quiet would keep its count forever, so the first rejected call also
+// links the limiter into a global list, from which registry::flush_all() and shutdown() report
+// the counts still pending (take_suppressed).
+class token_bucket_limiter
+{
+public:
+    constexpr token_bucket_limiter() noexcept = default;
+
+    bool allow(std::uint32_t per_second, std::uint32_t burst, const source_loc &loc, level::level_enum lvl, std::size_t &suppressed) noexcept
+    {
+        using std::chrono::nanoseconds;
+        const std::int64_t now = std::chrono::duration_cast<nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        const std::int64_t interval = per_second == 0 ? 1000000000 : 1000000000 / static_cast<std::int64_t>(per_second);
+        const std::int64_t tolerance = interval * (burst == 0 ? 0 : static_cast<std::int64_t>(burst) - 1);
+
+        auto tat = tat_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto start = tat > now ? tat : now;
+            if (start - now > tolerance)
+            {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                if (!registered_.load(std::memory_order_relaxed))
+                {
+                    register_(loc, lvl);
+                }
+                return false;
+            }
+            if (tat_.compare_exchange_weak(tat, start + interval, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Call fn(loc, level, count) for every call site with suppressed calls not reported yet,
+    // and reset their counts.
+    template<typename Fn>
+    static void take_suppressed(Fn &&fn)
+    {
+        for (auto *limiter = first_.load(std::memory_order_acquire); limiter != nullptr; limiter = limiter->next_)
+        {
+            const auto count = limiter->suppressed_.exchange(0, std::memory_order_relaxed);
+            if (count != 0)
+            {
+                fn(limiter->loc_, limiter->level_, count);
+            }
+        }
+    }
+
+private:
+    // loc_, level_ and next_ are written once, before the limiter is published in first_.
+    void register_(const source_loc &loc, level::level_enum lvl) noexcept
+    {
+        if (registered_.exchange(true, std::memory_order_relaxed))
+        {
+            return;
+        }
+        loc_ = loc;
+        level_ = lvl;
+        auto *first = first_.load(std::memory_order_relaxed);
+        do
+        {
+            next_ = first;
+        } while (!first_.compare_exchange_weak(first, this, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    std::atomic<std::int64_t> tat_{0};
+    std::atomic<std::size_t> suppressed_{0};
+
+    std::atomic<bool> registered_{false};
+    source_loc loc_{};
+    level::level_enum level_{level::off};
+    token_bucket_limiter *next_{nullptr};
+
+    // the limiters are function local statics, they stay in the list until the program exits
+    static inline std::atomic<token_bucket_limiter *> first_{nullptr};
+};
+
+} // namespace details
+} // namespace spdlog
@@ -61,6 +61,36 @@ public:
         }
     }
 
+    // index based access, for queues filling and reading the slots in place (mpmc_blocking_queue).
+    // the back slot to fill is slot(tail_index()), advance_tail() makes it the back item.
+    // the caller makes room first, advancing the tail of a full queue is undefined.
+    size_t head_index() const
+    {
+        return head_;
+    }
+
+    size_t tail_index() const
+    {
+        return tail_;
+    }
+
+    T &slot(size_t index)
+    {
+        return v_[index];
+    }
+
+    void advance_tail()
+    {
+        assert(!full());
+        tail_ = (tail_ + 1) % max_items_;
+    }
+
+    // an item was overrun or dropped by the caller
+    void count_overrun()
+    {
+        ++overrun_counter_;
+    }
+
     // Return reference to the front item.
     // If there are no elements in the container, the behavior is undefined.
     const T &front() const
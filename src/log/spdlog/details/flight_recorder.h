@@ -0,0 +1,75 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Crash-safe in-memory record of the most recent log messages of every thread.
+//
+// When enabled, loggers copy each message (timestamp, level, logger name, source location and
+// the first bytes of the payload) into a fixed size ring owned by the calling thread, before
+// the message goes to the sinks or the async queue. Recording is lock free and never allocates
+// after the first message of a thread; nothing is formatted or written unless the rings are dumped.
+// The rings of exited threads are pooled for new threads, only a few of them keep their records
+// (memory), the others are released.
+//
+// The rings are meant to be dumped when things go wrong: dump() only uses async signal safe
+// calls, so it can be called from the fatal signal handler installed by install_crash_handler().
+// Messages filtered out by the sinks' levels are still recorded (the logger's level must let them
+// through), so the dump can hold trace context while the regular sinks run at info.
+
+#include <spdlog/common.h>
+#include <spdlog/details/log_msg.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace spdlog {
+namespace details {
+
+class SPDLOG_API flight_recorder
+{
+public:
+    static constexpr size_t logger_name_capacity = 16;
+    static constexpr size_t payload_capacity = 192;
+
+    // start recording messages of at least min_level.
+    // records_per_thread is rounded up to a power of 2, rings that already exist keep their size.
+    static void enable(size_t records_per_thread, level::level_enum min_level = level::trace);
+    static void disable();
+
+    static bool enabled() noexcept
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void record(const log_msg &msg) noexcept
+    {
+        if (enabled() && msg.level >= min_level_.load(std::memory_order_relaxed))
+        {
+            record_(msg);
+        }
+    }
+
+    // write the content of all rings (oldest first, grouped by thread) as text to the given file.
+    // async signal safe. return false if the file could not be written.
+    static bool dump(const char *filename) noexcept;
+
+    // dump to filename when the process receives SIGSEGV, SIGBUS, SIGILL, SIGFPE or SIGABRT,
+    // then let the previous handler (or the default action) run.
+    static void install_crash_handler(const std::string &filename);
+
+    // dump to the crash handler's file, only the first call does it (later ones return false).
+    // to be called on fatal errors that don't raise one of the signals above, or before aborting.
+    static bool dump_crash_file() noexcept;
+
+private:
+    static void record_(const log_msg &msg) noexcept;
+
+    static std::atomic<bool> enabled_;
+    static std::atomic<int> min_level_;
+};
+
+} // namespace details
+} // namespace spdlog
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <spdlog/common.h>
+#include <cstdint>
 #include <string>
 
 namespace spdlog {
@@ -16,9 +17,14 @@ struct SPDLOG_API log_msg
     log_msg(string_view_t logger_name, level::level_enum lvl, string_view_t msg);
     log_msg(const log_msg &other) = default;
 
+    log_clock::time_point resolved_time() const;
+
     string_view_t logger_name;
     level::level_enum level{level::off};
     log_clock::time_point time;
+    // raw tsc_clock ticks when the message was timestamped by SPDLOG_CLOCK_TSC, 0 otherwise.
+    // "time" is not set in that case, use resolved_time() (the formatter does it for its flags).
+    std::uint64_t tsc{0};
     size_t thread_id{0};
 
     // wrapping the formatted text with color (updated by pattern_formatter).
@@ -23,6 +23,9 @@ public:
     log_msg_buffer(log_msg_buffer &&other) noexcept;
     log_msg_buffer &operator=(const log_msg_buffer &other);
     log_msg_buffer &operator=(log_msg_buffer &&other) noexcept;
+
+    // copy orig_msg into this buffer, reusing its capacity (no allocation once it grew large enough)
+    void assign(const log_msg &orig_msg);
 };
 
 } // namespace details
@@ -0,0 +1,37 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Minimal built-in LZ4 compressor used to pack rotated log segments.
+//
+// Produces standard LZ4 frames (independent 64KB blocks, no content checksum),
+// so archives can be read back with the stock "lz4 -d" tool.
+// Favours speed over ratio: single pass, greedy matching, 4KB hash table.
+
+#include <spdlog/common.h>
+
+#include <cstddef>
+
+namespace spdlog {
+namespace details {
+namespace lz4 {
+
+// file extension appended to compressed archives
+SPDLOG_API const filename_t &extension();
+
+// worst case size of a compressed block for the given input size
+SPDLOG_API std::size_t compress_bound(std::size_t source_size) noexcept;
+
+// compress one block in the raw LZ4 block format.
+// dest_capacity must be at least compress_bound(source_size).
+// return the compressed size, or 0 if dest is too small.
+SPDLOG_API std::size_t compress_block(const char *source, std::size_t source_size, char *dest, std::size_t dest_capacity) noexcept;
+
+// compress the whole source file into target as an LZ4 frame (target is truncated).
+// throw spdlog_ex on I/O errors.
+SPDLOG_API void compress_file(const filename_t &source_filename, const filename_t &target_filename);
+
+} // namespace lz4
+} // namespace details
+} // namespace spdlog
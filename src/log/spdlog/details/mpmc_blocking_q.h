@@ -3,17 +3,27 @@
 
 #pragma once
 
-// multi producer-multi consumer blocking queue.
-// enqueue(..) - will block until room found to put the new message.
-// enqueue_nowait(..) - will return immediately with false if no room left in
+// multi producer-multi consumer blocking queue of preallocated slots, filled and read in place.
+// enqueue_fill(..) - will block until room found to put the new message.
+// enqueue_fill_nowait(..) - will overrun the oldest message if no room left in
 // the queue.
-// dequeue_for(..) - will block until the queue is not empty or timeout have
+// dequeue_copy_for(..) - will block until the queue is not empty or timeout have
 // passed.
-
+//
+// a slot is reserved and released under the mutex, but filled and copied out without it,
+// so producers and consumers only hold the lock for the bookkeeping. every slot has a state:
+// a consumer only takes the front slot once its producer is done filling it, a producer only
+// reuses a slot once its consumer is done copying it out, and an overrun never evicts a slot
+// that is still being filled. a slot whose fill threw is published as skipped, consumers and
+// overruns step over it.
+
+#include <spdlog/common.h>
 #include <spdlog/details/circular_q.h>
 
 #include <condition_variable>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 namespace spdlog {
 namespace details {
@@ -25,96 +35,171 @@ public:
     using item_type = T;
     explicit mpmc_blocking_queue(size_t max_items)
         : q_(max_items)
+        , slot_states_(max_items + 1, slot_state::free)
     {}
 
-#ifndef __MINGW32__
-    // try to enqueue and block if no room left
-    void enqueue(T &&item)
+    // the free slot is filled in place by fill(slot) instead of being move assigned,
+    // so it keeps its buffers.
+    template<typename Fill>
+    void enqueue_fill(Fill &&fill)
     {
+        size_t index;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            pop_cv_.wait(lock, [this] { return !this->q_.full(); });
-            q_.push_back(std::move(item));
+            pop_cv_.wait(lock, [this] {
+                this->pop_skipped_();
+                return !this->q_.full() && this->slot_states_[this->q_.tail_index()] == slot_state::free;
+            });
+            index = reserve_back_();
         }
-        push_cv_.notify_one();
+        fill_(index, std::forward<Fill>(fill));
     }
 
-    // enqueue immediately. overrun oldest message in the queue if no room left.
-    void enqueue_nowait(T &&item)
+    // same as enqueue_fill(), but overruns the oldest item if no room left. the oldest item
+    // is kept when it is still being filled or keep(oldest) returns true, the new item is
+    // dropped (and counted as overrun) instead.
+    template<typename Fill, typename Keep>
+    void enqueue_fill_nowait(Fill &&fill, Keep &&keep)
     {
+        size_t index;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            q_.push_back(std::move(item));
+            // the marker slot may still be copied out by a consumer
+            if (slot_states_[q_.tail_index()] != slot_state::free)
+            {
+                q_.count_overrun();
+                return;
+            }
+            pop_skipped_();
+            if (q_.full())
+            {
+                const auto head = q_.head_index();
+                q_.count_overrun();
+                if (slot_states_[head] != slot_state::ready || keep(q_.slot(head)))
+                {
+                    return;
+                }
+                slot_states_[head] = slot_state::free;
+                q_.pop_front();
+            }
+            index = reserve_back_();
         }
-        push_cv_.notify_one();
+        fill_(index, std::forward<Fill>(fill));
     }
 
-    // try to dequeue item. if no item found. wait upto timeout and try again
-    // Return true, if succeeded dequeue item, false otherwise
-    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    // the item is copy assigned out of its slot, so neither the slot nor popped_item give up
+    // their buffers. Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_copy_for(T &popped_item, std::chrono::milliseconds wait_duration)
     {
+        size_t index;
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            if (!push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); }))
+            if (!push_cv_.wait_for(lock, wait_duration,
+                    [this] {
+                        this->pop_skipped_();
+                        return !this->q_.empty() && this->slot_states_[this->q_.head_index()] == slot_state::ready;
+                    }))
             {
                 return false;
             }
-            popped_item = std::move(q_.front());
+            index = q_.head_index();
+            slot_states_[index] = slot_state::reading;
             q_.pop_front();
         }
-        pop_cv_.notify_one();
+        popped_item = q_.slot(index);
+        {
+            // notified with the mutex held, mingw deadlocks otherwise
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            slot_states_[index] = slot_state::free;
+            pop_cv_.notify_all();
+        }
         return true;
     }
 
-#else
-    // apparently mingw deadlocks if the mutex is released before cv.notify_one(),
-    // so release the mutex at the very end each function.
-
-    // try to enqueue and block if no room left
-    void enqueue(T &&item)
+    size_t overrun_counter()
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
-        pop_cv_.wait(lock, [this] { return !this->q_.full(); });
-        q_.push_back(std::move(item));
-        push_cv_.notify_one();
+        return q_.overrun_counter();
     }
 
-    // enqueue immediately. overrun oldest message in the queue if no room left.
-    void enqueue_nowait(T &&item)
+    size_t size()
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
-        q_.push_back(std::move(item));
-        push_cv_.notify_one();
+        return q_.size();
     }
 
-    // try to dequeue item. if no item found. wait upto timeout and try again
-    // Return true, if succeeded dequeue item, false otherwise
-    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+private:
+    enum class slot_state : unsigned char
     {
-        std::unique_lock<std::mutex> lock(queue_mutex_);
-        if (!push_cv_.wait_for(lock, wait_duration, [this] { return !this->q_.empty(); }))
-        {
-            return false;
-        }
-        popped_item = std::move(q_.front());
-        q_.pop_front();
-        pop_cv_.notify_one();
-        return true;
+        free,
+        writing,
+        ready,
+        reading,
+        skipped
+    };
+
+    // with the mutex held
+    size_t reserve_back_()
+    {
+        const auto index = q_.tail_index();
+        slot_states_[index] = slot_state::writing;
+        q_.advance_tail();
+        return index;
     }
 
+    // if fill throws (e.g. allocating the payload buffer), the slot is published as skipped
+    // and counted as overrun, instead of staying "writing" and blocking every consumer on it.
+    template<typename Fill>
+    void fill_(size_t index, Fill &&fill)
+    {
+#ifdef SPDLOG_NO_EXCEPTIONS
+        fill(q_.slot(index));
+#else
+        try
+        {
+            fill(q_.slot(index));
+        }
+        catch (...)
+        {
+            publish_(index, slot_state::skipped);
+            throw;
+        }
 #endif
+        publish_(index, slot_state::ready);
+    }
 
-    size_t overrun_counter()
+    void publish_(size_t index, slot_state state)
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
-        return q_.overrun_counter();
+        slot_states_[index] = state;
+        if (state == slot_state::skipped)
+        {
+            q_.count_overrun();
+        }
+        push_cv_.notify_all();
+    }
+
+    // with the mutex held, frees the skipped slots at the front
+    void pop_skipped_()
+    {
+        bool popped = false;
+        while (!q_.empty() && slot_states_[q_.head_index()] == slot_state::skipped)
+        {
+            slot_states_[q_.head_index()] = slot_state::free;
+            q_.pop_front();
+            popped = true;
+        }
+        if (popped)
+        {
+            pop_cv_.notify_all();
+        }
     }
 
-private:
     std::mutex queue_mutex_;
     std::condition_variable push_cv_;
     std::condition_variable pop_cv_;
     spdlog::details::circular_q<T> q_;
+    std::vector<slot_state> slot_states_;
 };
 } // namespace details
 } // namespace spdlog
@@ -7,10 +7,15 @@
 // An attempt to create a logger with an already existing name will result with spdlog_ex exception.
 // If user requests a non existing logger, nullptr will be returned
 // This class is thread safe
+//
+// The logger map, default logger and thread pool are kept in an immutable snapshot,
+// published through an atomic pointer (RCU style). Lookups never take a mutex, only
+// the writers (registration, drop, level/formatter changes..) serialize on logger_map_mutex_.
 
 #include <spdlog/common.h>
 #include <spdlog/cfg/log_levels.h>
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -39,11 +44,12 @@ public:
     // Return raw ptr to the default logger.
     // To be used directly by the spdlog default api (e.g. spdlog::info)
     // This make the default API faster, but cannot be used concurrently with set_default_logger().
+    // (the returned logger might be destroyed by it).
     // e.g do not call set_default_logger() from one thread while calling spdlog::info() from another.
     logger *get_default_raw();
 
     // set default logger.
-    // default logger is stored in default_logger_ (for faster retrieval) and in the loggers_ map.
+    // default logger is stored in the snapshot and in its loggers map.
     void set_default_logger(std::shared_ptr<logger> new_default_logger);
 
     void set_tp(std::shared_ptr<thread_pool> tp);
@@ -61,6 +67,8 @@ public:
 
     void flush_on(level::level_enum log_level);
 
+    // bound the age of unflushed async messages, see flush_policy::max_age (applies to the
+    // current thread pool and to the ones set later), and flush all loggers every interval.
     void flush_every(std::chrono::seconds interval);
 
     void set_error_handler(void (*handler)(const std::string &msg));
@@ -85,21 +93,47 @@ public:
     static registry &instance();
 
 private:
+    struct snapshot : std::enable_shared_from_this<snapshot>
+    {
+        std::unordered_map<std::string, std::shared_ptr<logger>> loggers;
+        std::shared_ptr<logger> default_logger;
+        std::shared_ptr<thread_pool> tp;
+    };
+
+    // number of readers currently inside a read_guard, one per epoch
+    struct alignas(64) reader_counter
+    {
+        std::atomic<size_t> count{0};
+    };
+
+    class read_guard;
+
     registry();
     ~registry();
 
-    void throw_if_exists_(const std::string &logger_name);
-    void register_logger_(std::shared_ptr<logger> new_logger);
+    // writer path, logger_map_mutex_ must be held
+    std::shared_ptr<snapshot> copy_snapshot_() const;
+    void publish_(std::shared_ptr<snapshot> next);
+    void synchronize_();
+
+    // log the counts of the rate limited call sites that went quiet since their last allowed call
+    static void report_suppressed_(logger *default_logger);
+
+    void throw_if_exists_(const snapshot &snap, const std::string &logger_name);
+    void register_logger_(snapshot &snap, std::shared_ptr<logger> new_logger);
     std::mutex logger_map_mutex_, flusher_mutex_;
     std::recursive_mutex tp_mutex_;
-    std::unordered_map<std::string, std::shared_ptr<logger>> loggers_;
+    std::shared_ptr<snapshot> current_;
+    std::atomic<const snapshot *> snapshot_{nullptr};
+    std::atomic<logger *> default_logger_raw_{nullptr};
+    std::atomic<size_t> epoch_{0};
+    reader_counter readers_[2];
     cfg::log_levels levels_;
     std::unique_ptr<formatter> formatter_;
     level::level_enum flush_level_ = level::off;
-    void (*err_handler_)(const std::string &msg);
-    std::shared_ptr<thread_pool> tp_;
+    void (*err_handler_)(const std::string &msg) = nullptr;
     std::unique_ptr<periodic_worker> periodic_flusher_;
-    std::shared_ptr<logger> default_logger_;
+    std::chrono::seconds flush_interval_{0};
     bool automatic_registration_ = true;
 };
 
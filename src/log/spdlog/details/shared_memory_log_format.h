@@ -0,0 +1,106 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Layout of the shared memory written by shared_memory_sink (native byte order, one writer).
+//
+//   header          magic, sizes, the number of records written so far and the counters
+//   record_slot*    slot_count slots, record n is in slot n % slot_count
+//
+// Readers never block the writer. Every slot and the counters block are protected by a seqlock:
+// the writer makes the sequence odd, writes, and stores the final even sequence, which for
+// record n is 2 * (n + 1). A reader copies the slot and checks that the sequence was the
+// expected one before and after the copy, otherwise the record was overwritten while reading
+// (the reader fell more than slot_count records behind) and is skipped.
+//
+// A writer that dies leaves its segment open (closed stays 0), readers check writer_pid for
+// that. A new writer replaces the segment (or reinitializes it in place on windows) with another
+// generation, readers compare it against the one they follow to switch to the new segment.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace spdlog {
+namespace details {
+namespace shared_memory_log {
+
+constexpr char magic[8] = {'S', 'P', 'D', 'L', 'S', 'H', 'M', '1'};
+constexpr std::uint32_t format_version = 2;
+constexpr std::size_t record_text_size = 480;
+constexpr std::size_t counter_name_size = 56;
+constexpr std::size_t counter_capacity = 32;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory atomics must be lock free");
+
+struct counter
+{
+    char name[counter_name_size];
+    std::int64_t value;
+};
+
+struct header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t slot_count;
+    // records written so far, record n is complete once write_index > n
+    std::atomic<std::uint64_t> write_index;
+    // set when the writer is done, the segment won't change anymore
+    std::atomic<std::uint32_t> closed;
+    std::uint32_t counter_count;
+    std::atomic<std::uint64_t> counters_sequence;
+    // unique per writer instance, never 0
+    std::uint64_t generation;
+    std::uint64_t writer_pid;
+    std::uint64_t reserved;
+    counter counters[counter_capacity];
+};
+
+struct record_slot
+{
+    std::atomic<std::uint64_t> sequence;
+    // nanoseconds since epoch
+    std::uint64_t time;
+    std::uint64_t thread_id;
+    std::uint8_t level;
+    std::uint8_t reserved;
+    std::uint16_t size;
+    std::uint32_t reserved2;
+    // the formatted line, without eol, truncated to record_text_size
+    char text[record_text_size];
+};
+
+static_assert(sizeof(header) % 64 == 0, "unexpected padding");
+static_assert(sizeof(record_slot) == 512, "unexpected padding");
+
+inline std::size_t segment_size(std::size_t slot_count) noexcept
+{
+    return sizeof(header) + slot_count * sizeof(record_slot);
+}
+
+inline record_slot *slots(header *h) noexcept
+{
+    return reinterpret_cast<record_slot *>(h + 1);
+}
+
+inline const record_slot *slots(const header *h) noexcept
+{
+    return reinterpret_cast<const record_slot *>(h + 1);
+}
+
+// name of the shared memory object for the platform ("/name" for shm_open, "Local\name" on windows)
+inline std::string object_name(const std::string &name)
+{
+#ifdef _WIN32
+    return "Local\\" + name;
+#else
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+#endif
+}
+
+} // namespace shared_memory_log
+} // namespace details
+} // namespace spdlog
@@ -8,7 +8,11 @@
 #include <spdlog/details/os.h>
 #include <spdlog/async_logger.h>
 
+#include <barrier>
+
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -19,65 +23,81 @@ class async_logger;
 
 namespace details {
 
-using async_logger_ptr = std::shared_ptr<spdlog::async_logger>;
-
 enum class async_msg_type
 {
     log,
     flush,
+    barrier,
     terminate
 };
 
-#include <spdlog/details/log_msg_buffer.h>
-// Async msg to move to/from the queue
-// Movable only. should never be copied
+// Async msg stored in the queue.
+// The queue's preallocated slots are reused in place: messages are copied into and out of
+// them (see mpmc_blocking_queue::enqueue_fill/dequeue_copy_for), so every slot keeps its
+// payload buffer and, once warmed up, posting a message never allocates. The copies are
+// made outside the queue's mutex. Only log messages are ever overrun: flush, barrier and
+// terminate messages are always posted blocking and never evicted.
+// The logger is referred to by a raw pointer (no refcount per message); async_logger
+// drains the pool in its destructor instead, see thread_pool::drain().
 struct async_msg : log_msg_buffer
 {
     async_msg_type msg_type{async_msg_type::log};
-    async_logger_ptr worker_ptr;
+    async_logger *worker_ptr{nullptr};
+    // set for barrier messages only
+    std::shared_ptr<std::barrier<>> barrier;
 
     async_msg() = default;
     ~async_msg() = default;
 
-    // should only be moved in or out of the queue..
+    // only copy assigned, to keep the buffers of the queue slots.
     async_msg(const async_msg &) = delete;
+    async_msg &operator=(const async_msg &) = default;
 
-// support for vs2013 move
-#if defined(_MSC_VER) && _MSC_VER <= 1800
-    async_msg(async_msg &&other)
-        : log_msg_buffer(std::move(other))
-        , msg_type(other.msg_type)
-        , worker_ptr(std::move(other.worker_ptr))
-    {}
+    async_msg(async_msg &&) = default;
+    async_msg &operator=(async_msg &&) = default;
 
-    async_msg &operator=(async_msg &&other)
+    // fill a queue slot from log_msg with given type
+    void assign(async_logger *worker, async_msg_type the_type, const details::log_msg &m)
     {
-        *static_cast<log_msg_buffer *>(this) = std::move(other);
-        msg_type = other.msg_type;
-        worker_ptr = std::move(other.worker_ptr);
-        return *this;
+        log_msg_buffer::assign(m);
+        msg_type = the_type;
+        worker_ptr = worker;
+        barrier.reset();
     }
-#else // (_MSC_VER) && _MSC_VER <= 1800
-    async_msg(async_msg &&) = default;
-    async_msg &operator=(async_msg &&) = default;
+
+    void assign(async_logger *worker, async_msg_type the_type)
+    {
+        msg_type = the_type;
+        worker_ptr = worker;
+        barrier.reset();
+    }
+};
+
+// when the worker threads flush the loggers they wrote to, on top of explicit flushes and
+// the loggers' own flush_on() level. a worker flushes as soon as one of the limits is hit:
+// about max_bytes of payload written since the last flush, the oldest unflushed message
+// being max_age old, or a message of at least flush_level. it also flushes when it goes
+// through a drain() barrier or terminates, so the sinks never fflush per message.
+struct flush_policy
+{
+    size_t max_bytes = 64 * 1024;
+    std::chrono::milliseconds max_age{1000};
+    level::level_enum flush_level = level::err;
+};
+
+// one in SPDLOG_ENQUEUE_SAMPLE_INTERVAL messages posted by a thread is timed for the enqueue
+// stats, the others don't read the clock. 0 compiles the timing out.
+#ifndef SPDLOG_ENQUEUE_SAMPLE_INTERVAL
+#define SPDLOG_ENQUEUE_SAMPLE_INTERVAL 64
 #endif
 
-    // construct from log_msg with given type
-    async_msg(async_logger_ptr &&worker, async_msg_type the_type, const details::log_msg &m)
-        : log_msg_buffer{m}
-        , msg_type{the_type}
-        , worker_ptr{std::move(worker)}
-    {}
-
-    async_msg(async_logger_ptr &&worker, async_msg_type the_type)
-        : log_msg_buffer{}
-        , msg_type{the_type}
-        , worker_ptr{std::move(worker)}
-    {}
-
-    explicit async_msg(async_msg_type the_type)
-        : async_msg{nullptr, the_type}
-    {}
+// time spent by producers in post_log(), including waiting on a full queue, of the sampled
+// messages (count of them).
+struct enqueue_stats
+{
+    size_t count = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
 };
 
 class SPDLOG_API thread_pool
@@ -95,22 +115,61 @@ public:
     thread_pool(const thread_pool &) = delete;
     thread_pool &operator=(thread_pool &&) = delete;
 
-    void post_log(async_logger_ptr &&worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy);
-    void post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy);
+    void post_log(async_logger *worker_ptr, const details::log_msg &msg, async_overflow_policy overflow_policy);
+    void post_flush(async_logger *worker_ptr, async_overflow_policy overflow_policy);
     size_t overrun_counter();
 
+    // number of messages waiting in the queue right now
+    size_t queue_size();
+    size_t queue_capacity() const;
+
+    // return the enqueue stats accumulated since the previous call and reset them
+    enqueue_stats take_enqueue_stats();
+
+    void set_flush_policy(const flush_policy &policy);
+    flush_policy get_flush_policy() const;
+
+    // block until every message posted before this call has been processed (and flushed).
+    // posts one barrier per worker thread, each thread takes exactly one and waits
+    // for the others, so no thread is still busy with an earlier message afterwards.
+    // must not be called from a worker thread.
+    void drain();
+
 private:
     q_type q_;
+    size_t q_max_items_;
+
+    std::atomic<size_t> enqueue_count_{0};
+    std::atomic<std::int64_t> enqueue_ns_total_{0};
+    std::atomic<std::int64_t> enqueue_ns_max_{0};
+
+    std::atomic<size_t> flush_max_bytes_;
+    std::atomic<std::int64_t> flush_max_age_ms_;
+    std::atomic<int> flush_level_;
 
     std::vector<std::thread> threads_;
 
-    void post_async_msg_(async_msg &&new_msg, async_overflow_policy overflow_policy);
+    // keeps the barriers of concurrent drain() calls from interleaving in the queue
+    std::mutex drain_mutex_;
+
+    // loggers a worker thread wrote to since it last flushed them
+    struct unflushed_state
+    {
+        std::vector<async_logger *> loggers;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point oldest;
+    };
+
+    template<typename Fill>
+    void post_async_msg_(Fill &&fill, async_overflow_policy overflow_policy);
+    void record_enqueue_(std::chrono::nanoseconds elapsed);
     void worker_loop_();
 
-    // process next message in the queue
+    // process next message in the queue (copied into incoming_async_msg, which is reused)
     // return true if this thread should still be active (while no terminate msg
     // was received)
-    bool process_next_msg_();
+    bool process_next_msg_(async_msg &incoming_async_msg, unflushed_state &unflushed);
+    void flush_unflushed_(unflushed_state &unflushed);
 };
 
 } // namespace details
@@ -0,0 +1,53 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// Log timestamps taken from the invariant TSC (see SPDLOG_CLOCK_TSC in tweakme.h).
+//
+// Reading the TSC is cheaper than clock_gettime and has nanosecond resolution, and an
+// invariant TSC is synchronized across cores, so the ticks also order events between threads.
+// The tick rate is calibrated against the monotonic clock when the registry is created (so the
+// first log call doesn't stall on it), and raw ticks are only converted to wall clock time when
+// the message gets formatted. The conversion never goes backwards, it is steered towards the
+// wall clock instead of re-anchored to it.
+
+#include <spdlog/common.h>
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SPDLOG_TSC_SUPPORTED
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace spdlog {
+namespace details {
+
+class SPDLOG_API tsc_clock
+{
+public:
+    // true if the cpu has an invariant TSC and calibration succeeded.
+    // the first call calibrates (takes a few milliseconds).
+    static bool available() noexcept;
+
+    static std::uint64_t ticks() noexcept
+    {
+#ifdef SPDLOG_TSC_SUPPORTED
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    // convert ticks to wall clock time, only valid if available() returned true.
+    // async signal safe when recalibrate is false.
+    static log_clock::time_point to_time_point(std::uint64_t ticks, bool recalibrate = true) noexcept;
+};
+
+} // namespace details
+} // namespace spdlog
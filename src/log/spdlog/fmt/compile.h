@@ -0,0 +1,17 @@
+//
+// Copyright(c) 2016 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+//
+// include bundled or external copy of fmtlib's format string compilation (FMT_COMPILE)
+//
+
+#include <spdlog/fmt/fmt.h>
+
+#if !defined(SPDLOG_FMT_EXTERNAL)
+#include <spdlog/fmt/bundled/compile.h>
+#else
+#include <fmt/compile.h>
+#endif
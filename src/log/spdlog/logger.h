@@ -17,6 +17,11 @@
 #include <spdlog/common.h>
 #include <spdlog/details/log_msg.h>
 
+#ifdef SPDLOG_COMPILED_FORMAT
+#include <spdlog/fmt/compile.h>
+#include <iterator>
+#endif
+
 #ifdef SPDLOG_WCHAR_TO_UTF8_SUPPORT
 #include <spdlog/details/os.h>
 #endif
@@ -38,6 +43,42 @@
 
 namespace spdlog {
 
+#ifdef SPDLOG_COMPILED_FORMAT
+namespace details {
+// number of replacement fields of a format string, or -1 if it uses explicit argument ids,
+// names or dynamic width/precision, which the bundled fmt can't compile (formatted at runtime).
+constexpr int count_format_fields(string_view_t str)
+{
+    int fields = 0;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] != '{')
+        {
+            continue;
+        }
+        if (i + 1 < str.size() && str[i + 1] == '{')
+        {
+            ++i;
+            continue;
+        }
+        if (i + 1 < str.size() && str[i + 1] != '}' && str[i + 1] != ':')
+        {
+            return -1;
+        }
+        for (++i; i < str.size() && str[i] != '}'; ++i)
+        {
+            if (str[i] == '{')
+            {
+                return -1;
+            }
+        }
+        ++fields;
+    }
+    return fields;
+}
+} // namespace details
+#endif
+
 class SPDLOG_API logger
 {
 public:
@@ -79,6 +120,26 @@ public:
         log_(loc, lvl, fmt, args...);
     }
 
+#ifdef SPDLOG_COMPILED_FORMAT
+    // FormatString was compiled by FMT_COMPILE (see SPDLOG_FMT_STRING).
+    // without arguments it is logged as is, like a plain string (overload below).
+    template<typename FormatString, typename std::enable_if_t<fmt::detail::is_compiled_string<FormatString>::value, int> = 0,
+        typename Arg, typename... Args>
+    void log(source_loc loc, level::level_enum lvl, const FormatString &fmt, const Arg &arg, const Args &... args)
+    {
+        constexpr int fields = details::count_format_fields(string_view_t(FormatString()));
+        static_assert(fields < 0 || fields == static_cast<int>(1 + sizeof...(Args)), "argument count doesn't match the format string");
+        if constexpr (fields < 0)
+        {
+            log_(loc, lvl, string_view_t(fmt), arg, args...);
+        }
+        else
+        {
+            log_(loc, lvl, fmt, arg, args...);
+        }
+    }
+#endif
+
     // FormatString is NOT a type derived from fmt::compile_string but is a string_view_t or can be implicitly converted to one
     template<typename... Args>
     void log(source_loc loc, level::level_enum lvl, string_view_t fmt, const Args &... args)
@@ -313,7 +374,18 @@ protected:
         SPDLOG_TRY
         {
             memory_buf_t buf;
-            fmt::format_to(buf, fmt, args...);
+#ifdef SPDLOG_COMPILED_FORMAT
+            if constexpr (fmt::detail::is_compiled_string<FormatString>::value)
+            {
+                // formatting code generated for this format string, nothing is parsed at runtime
+                fmt::detail::buffer<char> &base = buf;
+                fmt::format_to(std::back_inserter(base), fmt, args...);
+            }
+            else
+#endif
+            {
+                fmt::format_to(buf, fmt, args...);
+            }
             details::log_msg log_msg(loc, name_, lvl, string_view_t(buf.data(), buf.size()));
             sink_it_(log_msg);
         }
@@ -19,6 +19,9 @@ namespace sinks {
  * depending on the severity
  * of the message.
  * If no color terminal detected, omit the escape codes.
+ * Each line (with its color codes) is assembled in a buffer and written at once.
+ * If the target is not a terminal, lines are not flushed one by one but left to
+ * the stdio buffer, which writes many of them at once (and on flush() and exit).
  */
 
 template<typename ConsoleMutex>
@@ -83,10 +86,9 @@ private:
     FILE *target_file_;
     mutex_t &mutex_;
     bool should_do_colors_;
+    bool should_flush_lines_;
     std::unique_ptr<spdlog::formatter> formatter_;
     std::array<std::string, level::n_levels> colors_;
-    void print_ccode_(const string_view_t &color_code);
-    void print_range_(const memory_buf_t &formatted, size_t start, size_t end);
     static std::string to_string_(const string_view_t &sv);
 };
 
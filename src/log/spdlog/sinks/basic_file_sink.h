@@ -15,12 +15,15 @@ namespace spdlog {
 namespace sinks {
 /*
  * Trivial file sink with single file as target
+ * Flushes after every message unless flush_every_message is false, in which case
+ * the file is only flushed by flush() (flush_on() level, flush_every() or the
+ * async flush_policy).
  */
 template<typename Mutex>
 class basic_file_sink final : public base_sink<Mutex>
 {
 public:
-    explicit basic_file_sink(const filename_t &filename, bool truncate = false);
+    explicit basic_file_sink(const filename_t &filename, bool truncate = false, bool flush_every_message = true);
     const filename_t &filename() const;
 
 protected:
@@ -29,6 +32,7 @@ protected:
 
 private:
     details::file_helper file_helper_;
+    bool flush_every_message_;
 };
 
 using basic_file_sink_mt = basic_file_sink<std::mutex>;
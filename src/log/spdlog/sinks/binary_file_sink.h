@@ -0,0 +1,76 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/binary_log_format.h>
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/synchronous_factory.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace spdlog {
+namespace sinks {
+/*
+ * Structured binary file sink (see details/binary_log_format.h), records are not formatted.
+ * Records are collected into blocks of about block_size bytes, a block index is written when the sink
+ * is destroyed, so the file can be queried by time range, level and thread without scanning it.
+ * When appending to an existing file its index is loaded (or rebuilt) and rewritten at the end.
+ */
+template<typename Mutex>
+class binary_file_sink final : public base_sink<Mutex>
+{
+public:
+    static constexpr size_t default_block_size = 64 * 1024;
+
+    explicit binary_file_sink(const filename_t &filename, bool truncate = false, size_t block_size = default_block_size);
+    ~binary_file_sink() override;
+
+    binary_file_sink(const binary_file_sink &) = delete;
+    binary_file_sink &operator=(const binary_file_sink &) = delete;
+
+    const filename_t &filename() const;
+
+protected:
+    void sink_it_(const details::log_msg &msg) override;
+    void flush_() override;
+
+private:
+    // read the index of an existing file (or rebuild it from the block headers),
+    // and cut the file after the last complete block. return false if the file has no header yet.
+    bool load_index_(const filename_t &filename);
+    void write_block_();
+    void write_index_();
+    void reset_block_();
+
+    details::file_helper file_helper_;
+    size_t block_size_;
+    std::uint64_t file_size_ = 0;
+    memory_buf_t block_;
+    details::binary_log::block_header block_header_{};
+    std::vector<details::binary_log::index_entry> index_;
+};
+
+using binary_file_sink_mt = binary_file_sink<std::mutex>;
+using binary_file_sink_st = binary_file_sink<details::null_mutex>;
+
+} // namespace sinks
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> binary_logger_mt(const std::string &logger_name, const filename_t &filename, bool truncate = false)
+{
+    return Factory::template create<sinks::binary_file_sink_mt>(logger_name, filename, truncate);
+}
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> binary_logger_st(const std::string &logger_name, const filename_t &filename, bool truncate = false)
+{
+    return Factory::template create<sinks::binary_file_sink_st>(logger_name, filename, truncate);
+}
+
+} // namespace spdlog
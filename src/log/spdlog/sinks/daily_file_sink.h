@@ -79,7 +79,7 @@ public:
 protected:
     void sink_it_(const details::log_msg &msg) override
     {
-        auto time = msg.time;
+        auto time = msg.resolved_time();
         bool should_rotate = time >= rotation_tp_;
         if (should_rotate)
         {
@@ -70,7 +70,7 @@ protected:
 
         // log current message
         dist_sink<Mutex>::sink_it_(msg);
-        last_msg_time_ = msg.time;
+        last_msg_time_ = msg.resolved_time();
         skip_counter_ = 0;
         last_msg_payload_.assign(msg.payload.data(), msg.payload.data() + msg.payload.size());
     }
@@ -78,7 +78,7 @@ protected:
     // return whether the log msg should be displayed (true) or skipped (false)
     bool filter_(const details::log_msg &msg)
     {
-        auto filter_duration = msg.time - last_msg_time_;
+        auto filter_duration = msg.resolved_time() - last_msg_time_;
         return (filter_duration > max_skip_duration_) || (msg.payload != last_msg_payload_);
     }
 };
@@ -8,9 +8,13 @@
 #include <spdlog/details/null_mutex.h>
 #include <spdlog/details/synchronous_factory.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <string>
+#include <thread>
 
 namespace spdlog {
 namespace sinks {
@@ -18,26 +22,58 @@ namespace sinks {
 //
 // Rotating file sink based on size
 //
+// Rotation only moves the full file aside and reopens a fresh one on the logging thread.
+// Shifting the older files and (optionally) lz4-compressing the finished segment is done
+// by a background worker owned by the sink, so loggers never stall on it.
+// Errors from the worker are reported through the logger on the next message.
+// Segments left over by a previous run (stopped before the worker archived them) are
+// archived on construction, and the segment numbering continues after them.
+// At most max_files segments wait for the worker, beyond that the oldest waiting one is
+// deleted (counted by dropped_segments()), so the sink never keeps more than max_files files.
+//
 template<typename Mutex>
 class rotating_file_sink final : public base_sink<Mutex>
 {
 public:
-    rotating_file_sink(filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open = false);
+    rotating_file_sink(
+        filename_t base_filename, std::size_t max_size, std::size_t max_files, bool rotate_on_open = false, bool compress = false);
+    ~rotating_file_sink() override;
     static filename_t calc_filename(const filename_t &filename, std::size_t index);
     filename_t filename();
 
+    // name of the archived file at the given index (with the .lz4 extension if compressing)
+    filename_t archive_filename(std::size_t index) const;
+
+    // segments deleted unarchived because max_files of them were already waiting for the worker
+    std::size_t dropped_segments() const;
+
 protected:
     void sink_it_(const details::log_msg &msg) override;
     void flush_() override;
 
 private:
     // Rotate files:
-    // log.txt -> log.1.txt
-    // log.1.txt -> log.2.txt
-    // log.2.txt -> log.3.txt
+    // log.txt -> log.segment<n>.txt (on the logging thread, then reopen log.txt)
+    // and on the worker:
     // log.3.txt -> delete
+    // log.2.txt -> log.3.txt
+    // log.1.txt -> log.2.txt
+    // log.segment<n>.txt -> log.1.txt (compressed into log.1.txt.lz4 if enabled)
     void rotate_();
 
+    // queue the segments left over by a previous run and continue numbering after the highest one
+    void queue_leftover_segments_();
+
+    // queue a segment for the worker (with worker_mutex_ held, or before the worker started)
+    void queue_segment_(filename_t segment);
+
+    // worker thread - archives the queued segments in order
+    void worker_loop_();
+    void archive_segment_(const filename_t &segment_filename);
+
+    // throw (under the sink lock) the last error reported by the worker, if any
+    void throw_if_worker_failed_();
+
     // delete the target if exists, and rename the src file  to target
     // return true on success, false otherwise.
     bool rename_file_(const filename_t &src_filename, const filename_t &target_filename);
@@ -45,8 +81,19 @@ private:
     filename_t base_filename_;
     std::size_t max_size_;
     std::size_t max_files_;
+    bool compress_;
     std::size_t current_size_;
+    std::size_t segment_counter_{0};
     details::file_helper file_helper_;
+
+    std::thread worker_thread_;
+    std::mutex worker_mutex_;
+    std::condition_variable worker_cv_;
+    std::deque<filename_t> pending_segments_;
+    bool worker_active_{true};
+    std::atomic<bool> worker_failed_{false};
+    std::atomic<std::size_t> dropped_segments_{0};
+    std::string worker_error_;
 };
 
 using rotating_file_sink_mt = rotating_file_sink<std::mutex>;
@@ -59,16 +106,16 @@ using rotating_file_sink_st = rotating_file_sink<details::null_mutex>;
 //
 
 template<typename Factory = spdlog::synchronous_factory>
-inline std::shared_ptr<logger> rotating_logger_mt(
-    const std::string &logger_name, const filename_t &filename, size_t max_file_size, size_t max_files, bool rotate_on_open = false)
+inline std::shared_ptr<logger> rotating_logger_mt(const std::string &logger_name, const filename_t &filename, size_t max_file_size,
+    size_t max_files, bool rotate_on_open = false, bool compress = false)
 {
-    return Factory::template create<sinks::rotating_file_sink_mt>(logger_name, filename, max_file_size, max_files, rotate_on_open);
+    return Factory::template create<sinks::rotating_file_sink_mt>(logger_name, filename, max_file_size, max_files, rotate_on_open, compress);
 }
 
 template<typename Factory = spdlog::synchronous_factory>
-inline std::shared_ptr<logger> rotating_logger_st(
-    const std::string &logger_name, const filename_t &filename, size_t max_file_size, size_t max_files, bool rotate_on_open = false)
+inline std::shared_ptr<logger> rotating_logger_st(const std::string &logger_name, const filename_t &filename, size_t max_file_size,
+    size_t max_files, bool rotate_on_open = false, bool compress = false)
 {
-    return Factory::template create<sinks::rotating_file_sink_st>(logger_name, filename, max_file_size, max_files, rotate_on_open);
+    return Factory::template create<sinks::rotating_file_sink_st>(logger_name, filename, max_file_size, max_files, rotate_on_open, compress);
 }
 } // namespace spdlog
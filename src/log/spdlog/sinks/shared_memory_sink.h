@@ -0,0 +1,80 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+#include <spdlog/details/shared_memory_log_format.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/synchronous_factory.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace spdlog {
+namespace sinks {
+/*
+ * Publishes the formatted records and a set of named counters in a shared memory ring
+ * (see details/shared_memory_log_format.h), for live viewers on the same machine.
+ * Writing a record is a copy into the next slot, the sink never waits for readers:
+ * readers that fall behind lose the overwritten records.
+ * The shared memory object is created (replacing a stale one) by the constructor and
+ * removed by the destructor.
+ */
+template<typename Mutex>
+class shared_memory_sink final : public base_sink<Mutex>
+{
+public:
+    static constexpr size_t default_slot_count = 4096;
+
+    explicit shared_memory_sink(std::string name, size_t slot_count = default_slot_count);
+    ~shared_memory_sink() override;
+
+    shared_memory_sink(const shared_memory_sink &) = delete;
+    shared_memory_sink &operator=(const shared_memory_sink &) = delete;
+
+    const std::string &name() const;
+
+    // set (or add) a counter shown by the viewers, can be called from any thread.
+    // names are truncated, at most details::shared_memory_log::counter_capacity counters can be added.
+    void set_counter(std::string_view counter_name, std::int64_t value);
+
+protected:
+    void sink_it_(const details::log_msg &msg) override;
+    void flush_() override;
+
+private:
+    std::string name_;
+    details::shared_memory_log::header *header_ = nullptr;
+    size_t slot_count_;
+    size_t size_;
+#ifdef _WIN32
+    void *mapping_ = nullptr;
+#endif
+    std::uint64_t write_index_ = 0;
+    memory_buf_t formatted_;
+
+    // the counters have their own writers, next to the logging thread
+    std::mutex counters_mutex_;
+};
+
+using shared_memory_sink_mt = shared_memory_sink<std::mutex>;
+using shared_memory_sink_st = shared_memory_sink<details::null_mutex>;
+
+} // namespace sinks
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> shared_memory_logger_mt(const std::string &logger_name, const std::string &name)
+{
+    return Factory::template create<sinks::shared_memory_sink_mt>(logger_name, name);
+}
+
+template<typename Factory = spdlog::synchronous_factory>
+inline std::shared_ptr<logger> shared_memory_logger_st(const std::string &logger_name, const std::string &name)
+{
+    return Factory::template create<sinks::shared_memory_sink_st>(logger_name, name);
+}
+
+} // namespace spdlog
@@ -12,6 +12,8 @@ namespace spdlog {
 
 namespace sinks {
 
+// each line is flushed to a terminal at once. if the target is not a terminal, lines are left
+// to the stdio buffer, which writes many of them at once (and on flush() and exit).
 template<typename ConsoleMutex>
 class stdout_sink_base : public sink
 {
@@ -35,6 +37,7 @@ public:
 protected:
     mutex_t &mutex_;
     FILE *file_;
+    bool should_flush_lines_;
     std::unique_ptr<spdlog::formatter> formatter_;
 };
 
@@ -14,6 +14,7 @@
 #include <spdlog/logger.h>
 #include <spdlog/version.h>
 #include <spdlog/details/synchronous_factory.h>
+#include <spdlog/details/call_site_limiter.h>
 
 #include <chrono>
 #include <functional>
@@ -64,7 +65,8 @@ SPDLOG_API void set_level(level::level_enum log_level);
 // Set global flush level
 SPDLOG_API void flush_on(level::level_enum log_level);
 
-// Start/Restart a periodic flusher thread
+// Flush all loggers at least every interval. Async loggers are flushed by the thread
+// pool's workers (see details::flush_policy), the others by a periodic flusher thread.
 // Warning: Use only if all your loggers are thread safe!
 SPDLOG_API void flush_every(std::chrono::seconds interval);
 
@@ -223,54 +225,149 @@ inline void critical(const T &msg)
 // SPDLOG_LEVEL_OFF
 //
 
-#define SPDLOG_LOGGER_CALL(logger, level, ...) (logger)->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, level, __VA_ARGS__)
+// with SPDLOG_COMPILED_FORMAT the format string (which must be a literal) is compiled by
+// FMT_COMPILE: mismatched arguments are compile errors and no format string is parsed at runtime.
+#ifdef SPDLOG_COMPILED_FORMAT
+#define SPDLOG_FMT_STRING(format) FMT_COMPILE(format)
+#else
+#define SPDLOG_FMT_STRING(format) format
+#endif
+
+#define SPDLOG_LOGGER_CALL(logger, level, format, ...)                                                                                     \
+    (logger)->log(spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, level, SPDLOG_FMT_STRING(format), ##__VA_ARGS__)
+
+//
+// Per call site sampling and rate limiting, for logs in hot loops.
+// The level is checked first, so calls below the logger level are not counted.
+//
+// SPDLOG_INFO_EVERY_N(100, "Frame {}.", n);        // logs the 1st, 101st, 201st.. call
+// SPDLOG_WARN_RATE_LIMITED(5, "Slow frame {}.", n); // at most 5 per second (bursts of 5),
+//                                                   // followed by a count of the suppressed ones
+//
+// Counts still pending when a call site goes quiet are reported to the default logger
+// by flush_all() (so also by flush_every) and shutdown().
+//
+#define SPDLOG_LOGGER_CALL_EVERY_N(logger, level, n, ...)                                                                                  \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        static spdlog::details::every_n_limiter spdlog_every_n_limiter_;                                                                   \
+        if ((logger)->should_log(level) && spdlog_every_n_limiter_.allow(n))                                                               \
+        {                                                                                                                                  \
+            SPDLOG_LOGGER_CALL(logger, level, __VA_ARGS__);                                                                                \
+        }                                                                                                                                  \
+    } while (0)
+
+#define SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, level, per_second, ...)                                                                    \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        static spdlog::details::token_bucket_limiter spdlog_token_bucket_limiter_;                                                         \
+        std::size_t spdlog_suppressed_{0};                                                                                                 \
+        if ((logger)->should_log(level) &&                                                                                                 \
+            spdlog_token_bucket_limiter_.allow(per_second, per_second, spdlog::source_loc{__FILE__, __LINE__, SPDLOG_FUNCTION}, level,     \
+                spdlog_suppressed_))                                                                                                       \
+        {                                                                                                                                  \
+            SPDLOG_LOGGER_CALL(logger, level, __VA_ARGS__);                                                                                \
+            if (spdlog_suppressed_ != 0)                                                                                                   \
+            {                                                                                                                              \
+                SPDLOG_LOGGER_CALL(logger, level, "Suppressed {} message(s) from this call site.", spdlog_suppressed_);                    \
+            }                                                                                                                              \
+        }                                                                                                                                  \
+    } while (0)
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
 #define SPDLOG_LOGGER_TRACE(logger, ...) SPDLOG_LOGGER_CALL(logger, spdlog::level::trace, __VA_ARGS__)
 #define SPDLOG_TRACE(...) SPDLOG_LOGGER_TRACE(spdlog::default_logger_raw(), __VA_ARGS__)
+#define SPDLOG_LOGGER_TRACE_EVERY_N(logger, n, ...) SPDLOG_LOGGER_CALL_EVERY_N(logger, spdlog::level::trace, n, __VA_ARGS__)
+#define SPDLOG_TRACE_EVERY_N(n, ...) SPDLOG_LOGGER_TRACE_EVERY_N(spdlog::default_logger_raw(), n, __VA_ARGS__)
+#define SPDLOG_LOGGER_TRACE_RATE_LIMITED(logger, per_second, ...) SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, spdlog::level::trace, per_second, __VA_ARGS__)
+#define SPDLOG_TRACE_RATE_LIMITED(per_second, ...) SPDLOG_LOGGER_TRACE_RATE_LIMITED(spdlog::default_logger_raw(), per_second, __VA_ARGS__)
 #else
 #define SPDLOG_LOGGER_TRACE(logger, ...) (void)0
 #define SPDLOG_TRACE(...) (void)0
+#define SPDLOG_LOGGER_TRACE_EVERY_N(logger, n, ...) (void)0
+#define SPDLOG_TRACE_EVERY_N(n, ...) (void)0
+#define SPDLOG_LOGGER_TRACE_RATE_LIMITED(logger, per_second, ...) (void)0
+#define SPDLOG_TRACE_RATE_LIMITED(per_second, ...) (void)0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
 #define SPDLOG_LOGGER_DEBUG(logger, ...) SPDLOG_LOGGER_CALL(logger, spdlog::level::debug, __VA_ARGS__)
 #define SPDLOG_DEBUG(...) SPDLOG_LOGGER_DEBUG(spdlog::default_logger_raw(), __VA_ARGS__)
+#define SPDLOG_LOGGER_DEBUG_EVERY_N(logger, n, ...) SPDLOG_LOGGER_CALL_EVERY_N(logger, spdlog::level::debug, n, __VA_ARGS__)
+#define SPDLOG_DEBUG_EVERY_N(n, ...) SPDLOG_LOGGER_DEBUG_EVERY_N(spdlog::default_logger_raw(), n, __VA_ARGS__)
+#define SPDLOG_LOGGER_DEBUG_RATE_LIMITED(logger, per_second, ...) SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, spdlog::level::debug, per_second, __VA_ARGS__)
+#define SPDLOG_DEBUG_RATE_LIMITED(per_second, ...) SPDLOG_LOGGER_DEBUG_RATE_LIMITED(spdlog::default_logger_raw(), per_second, __VA_ARGS__)
 #else
 #define SPDLOG_LOGGER_DEBUG(logger, ...) (void)0
 #define SPDLOG_DEBUG(...) (void)0
+#define SPDLOG_LOGGER_DEBUG_EVERY_N(logger, n, ...) (void)0
+#define SPDLOG_DEBUG_EVERY_N(n, ...) (void)0
+#define SPDLOG_LOGGER_DEBUG_RATE_LIMITED(logger, per_second, ...) (void)0
+#define SPDLOG_DEBUG_RATE_LIMITED(per_second, ...) (void)0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
 #define SPDLOG_LOGGER_INFO(logger, ...) SPDLOG_LOGGER_CALL(logger, spdlog::level::info, __VA_ARGS__)
 #define SPDLOG_INFO(...) SPDLOG_LOGGER_INFO(spdlog::default_logger_raw(), __VA_ARGS__)
+#define SPDLOG_LOGGER_INFO_EVERY_N(logger, n, ...) SPDLOG_LOGGER_CALL_EVERY_N(logger, spdlog::level::info, n, __VA_ARGS__)
+#define SPDLOG_INFO_EVERY_N(n, ...) SPDLOG_LOGGER_INFO_EVERY_N(spdlog::default_logger_raw(), n, __VA_ARGS__)
+#define SPDLOG_LOGGER_INFO_RATE_LIMITED(logger, per_second, ...) SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, spdlog::level::info, per_second, __VA_ARGS__)
+#define SPDLOG_INFO_RATE_LIMITED(per_second, ...) SPDLOG_LOGGER_INFO_RATE_LIMITED(spdlog::default_logger_raw(), per_second, __VA_ARGS__)
 #else
 #define SPDLOG_LOGGER_INFO(logger, ...) (void)0
 #define SPDLOG_INFO(...) (void)0
+#define SPDLOG_LOGGER_INFO_EVERY_N(logger, n, ...) (void)0
+#define SPDLOG_INFO_EVERY_N(n, ...) (void)0
+#define SPDLOG_LOGGER_INFO_RATE_LIMITED(logger, per_second, ...) (void)0
+#define SPDLOG_INFO_RATE_LIMITED(per_second, ...) (void)0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
 #define SPDLOG_LOGGER_WARN(logger, ...) SPDLOG_LOGGER_CALL(logger, spdlog::level::warn, __VA_ARGS__)
 #define SPDLOG_WARN(...) SPDLOG_LOGGER_WARN(spdlog::default_logger_raw(), __VA_ARGS__)
+#define SPDLOG_LOGGER_WARN_EVERY_N(logger, n, ...) SPDLOG_LOGGER_CALL_EVERY_N(logger, spdlog::level::warn, n, __VA_ARGS__)
+#define SPDLOG_WARN_EVERY_N(n, ...) SPDLOG_LOGGER_WARN_EVERY_N(spdlog::default_logger_raw(), n, __VA_ARGS__)
+#define SPDLOG_LOGGER_WARN_RATE_LIMITED(logger, per_second, ...) SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, spdlog::level::warn, per_second, __VA_ARGS__)
+#define SPDLOG_WARN_RATE_LIMITED(per_second, ...) SPDLOG_LOGGER_WARN_RATE_LIMITED(spdlog::default_logger_raw(), per_second, __VA_ARGS__)
 #else
 #define SPDLOG_LOGGER_WARN(logger, ...) (void)0
 #define SPDLOG_WARN(...) (void)0
+#define SPDLOG_LOGGER_WARN_EVERY_N(logger, n, ...) (void)0
+#define SPDLOG_WARN_EVERY_N(n, ...) (void)0
+#define SPDLOG_LOGGER_WARN_RATE_LIMITED(logger, per_second, ...) (void)0
+#define SPDLOG_WARN_RATE_LIMITED(per_second, ...) (void)0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
 #define SPDLOG_LOGGER_ERROR(logger, ...) SPDLOG_LOGGER_CALL(logger, spdlog::level::err, __VA_ARGS__)
 #define SPDLOG_ERROR(...) SPDLOG_LOGGER_ERROR(spdlog::default_logger_raw(), __VA_ARGS__)
+#define SPDLOG_LOGGER_ERROR_EVERY_N(logger, n, ...) SPDLOG_LOGGER_CALL_EVERY_N(logger, spdlog::level::err, n, __VA_ARGS__)
+#define SPDLOG_ERROR_EVERY_N(n, ...) SPDLOG_LOGGER_ERROR_EVERY_N(spdlog::default_logger_raw(), n, __VA_ARGS__)
+#define SPDLOG_LOGGER_ERROR_RATE_LIMITED(logger, per_second, ...) SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, spdlog::level::err, per_second, __VA_ARGS__)
+#define SPDLOG_ERROR_RATE_LIMITED(per_second, ...) SPDLOG_LOGGER_ERROR_RATE_LIMITED(spdlog::default_logger_raw(), per_second, __VA_ARGS__)
 #else
 #define SPDLOG_LOGGER_ERROR(logger, ...) (void)0
 #define SPDLOG_ERROR(...) (void)0
+#define SPDLOG_LOGGER_ERROR_EVERY_N(logger, n, ...) (void)0
+#define SPDLOG_ERROR_EVERY_N(n, ...) (void)0
+#define SPDLOG_LOGGER_ERROR_RATE_LIMITED(logger, per_second, ...) (void)0
+#define SPDLOG_ERROR_RATE_LIMITED(per_second, ...) (void)0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_CRITICAL
 #define SPDLOG_LOGGER_CRITICAL(logger, ...) SPDLOG_LOGGER_CALL(logger, spdlog::level::critical, __VA_ARGS__)
 #define SPDLOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(spdlog::default_logger_raw(), __VA_ARGS__)
+#define SPDLOG_LOGGER_CRITICAL_EVERY_N(logger, n, ...) SPDLOG_LOGGER_CALL_EVERY_N(logger, spdlog::level::critical, n, __VA_ARGS__)
+#define SPDLOG_CRITICAL_EVERY_N(n, ...) SPDLOG_LOGGER_CRITICAL_EVERY_N(spdlog::default_logger_raw(), n, __VA_ARGS__)
+#define SPDLOG_LOGGER_CRITICAL_RATE_LIMITED(logger, per_second, ...) SPDLOG_LOGGER_CALL_RATE_LIMITED(logger, spdlog::level::critical, per_second, __VA_ARGS__)
+#define SPDLOG_CRITICAL_RATE_LIMITED(per_second, ...) SPDLOG_LOGGER_CRITICAL_RATE_LIMITED(spdlog::default_logger_raw(), per_second, __VA_ARGS__)
 #else
 #define SPDLOG_LOGGER_CRITICAL(logger, ...) (void)0
 #define SPDLOG_CRITICAL(...) (void)0
+#define SPDLOG_LOGGER_CRITICAL_EVERY_N(logger, n, ...) (void)0
+#define SPDLOG_CRITICAL_EVERY_N(n, ...) (void)0
+#define SPDLOG_LOGGER_CRITICAL_RATE_LIMITED(logger, per_second, ...) (void)0
+#define SPDLOG_CRITICAL_RATE_LIMITED(per_second, ...) (void)0
 #endif
 
 #endif // SPDLOG_H
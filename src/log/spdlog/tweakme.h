@@ -22,6 +22,27 @@
 // #define SPDLOG_CLOCK_COARSE
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// Timestamp messages with the invariant TSC (rdtsc) instead of the regular clock.
+// Cheaper than the regular clock with nanosecond resolution. The tick rate is
+// calibrated against the monotonic clock when the registry is created (~10ms) and
+// ticks are converted to wall clock time when the message is formatted.
+// Falls back to the regular clock on CPUs without an invariant TSC.
+// Comment out to use the regular clock.
+//
+#define SPDLOG_CLOCK_TSC
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Compile the format strings of the SPDLOG_* macros with FMT_COMPILE.
+// Argument/format mismatches become compile errors and the formatting code is
+// generated per call site, so no format string is parsed at runtime.
+// The macros then only accept string literals as format strings.
+// Comment out to use runtime format strings.
+//
+#define SPDLOG_COMPILED_FORMAT
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment if thread id logging is not needed (i.e. no %t in the log pattern).
 // This will prevent spdlog from querying the thread id on each log call.
@@ -0,0 +1,504 @@
+// Throughput and latency benchmark for the log library.
+//
+// Runs every combination of logger mode (sync, async block, async overrun_oldest),
+// sink, producer thread count and message size, and writes the results as JSON
+// (to stdout, or to the file given with --output). Progress goes to stderr.
+//
+// Usage: log_benchmark [--messages N] [--max-threads N] [--queue-size N] [--output file.json]
+
+#include "log/spdlog/async.h"
+#include "log/spdlog/async_logger.h"
+#include "log/spdlog/details/thread_pool.h"
+#include "log/spdlog/sinks/ansicolor_sink.h"
+#include "log/spdlog/sinks/basic_file_sink.h"
+#include "log/spdlog/sinks/null_sink.h"
+#include "log/spdlog/sinks/rotating_file_sink.h"
+#include "log/spdlog/spdlog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+enum class logger_mode
+{
+    sync,
+    async_block,
+    async_overrun_oldest
+};
+
+enum class sink_type
+{
+    null,
+    basic_file,
+    rotating_file,
+    ansicolor
+};
+
+struct benchmark_options
+{
+    std::size_t messages{ 200000 };
+    std::size_t max_threads{ 4 };
+    std::size_t queue_size{ 8192 };
+    std::string output;
+};
+
+struct benchmark_case
+{
+    logger_mode mode;
+    sink_type sink;
+    std::size_t threads;
+    std::size_t message_size;
+};
+
+struct benchmark_result
+{
+    benchmark_case test_case;
+    std::size_t messages{ 0 };
+    double seconds{ 0.0 };
+    double messages_per_second{ 0.0 };
+    std::size_t overruns{ 0 };
+    std::uint64_t latency_min_ns{ 0 };
+    std::uint64_t latency_p50_ns{ 0 };
+    std::uint64_t latency_p90_ns{ 0 };
+    std::uint64_t latency_p99_ns{ 0 };
+    std::uint64_t latency_p999_ns{ 0 };
+    std::uint64_t latency_max_ns{ 0 };
+};
+
+constexpr static std::size_t MESSAGE_SIZES[] = { 16, 128, 1024 };
+constexpr static std::size_t ROTATING_MAX_SIZE = 16 * 1024 * 1024;
+constexpr static std::size_t ROTATING_MAX_FILES = 3;
+
+#ifdef _WIN32
+constexpr static const char* NULL_DEVICE = "NUL";
+#else
+constexpr static const char* NULL_DEVICE = "/dev/null";
+#endif
+
+const char* to_string(logger_mode mode)
+{
+    switch (mode)
+    {
+    case logger_mode::sync:
+        return "sync";
+    case logger_mode::async_block:
+        return "async_block";
+    case logger_mode::async_overrun_oldest:
+        return "async_overrun_oldest";
+    }
+
+    return "unknown";
+}
+
+const char* to_string(sink_type sink)
+{
+    switch (sink)
+    {
+    case sink_type::null:
+        return "null_sink";
+    case sink_type::basic_file:
+        return "basic_file_sink";
+    case sink_type::rotating_file:
+        return "rotating_file_sink";
+    case sink_type::ansicolor:
+        return "ansicolor_sink";
+    }
+
+    return "unknown";
+}
+
+// The ansicolor sink writes to the null device, so we measure the formatting and
+// color handling without depending on the terminal the benchmark runs in.
+class null_device
+{
+public:
+    null_device()
+        : file_(std::fopen(NULL_DEVICE, "wb"))
+    {
+        if (file_ == nullptr)
+        {
+            spdlog::throw_spdlog_ex(std::string("Could not open ") + NULL_DEVICE);
+        }
+    }
+
+    ~null_device()
+    {
+        std::fclose(file_);
+    }
+
+    null_device(const null_device&) = delete;
+    null_device& operator=(const null_device&) = delete;
+
+    FILE* get() const
+    {
+        return file_;
+    }
+
+private:
+    FILE* file_;
+};
+
+spdlog::sink_ptr create_sink(sink_type sink, const std::filesystem::path& directory, const null_device& device)
+{
+    switch (sink)
+    {
+    case sink_type::null:
+        return std::make_shared<spdlog::sinks::null_sink_mt>();
+    case sink_type::basic_file:
+        return std::make_shared<spdlog::sinks::basic_file_sink_mt>((directory / "basic.log").string(), true);
+    case sink_type::rotating_file:
+        return std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
+            (directory / "rotating.log").string(), ROTATING_MAX_SIZE, ROTATING_MAX_FILES);
+    case sink_type::ansicolor:
+        return std::make_shared<spdlog::sinks::ansicolor_sink<spdlog::details::console_mutex>>(
+            device.get(), spdlog::color_mode::always);
+    }
+
+    return nullptr;
+}
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+
+    auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+benchmark_result run_case(const benchmark_case& test_case, const benchmark_options& options, const null_device& device)
+{
+    auto directory = std::filesystem::temp_directory_path() / "log_benchmark";
+
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    benchmark_result result;
+
+    result.test_case = test_case;
+
+    {
+        auto sink = create_sink(test_case.sink, directory, device);
+
+        std::shared_ptr<spdlog::details::thread_pool> thread_pool;
+        std::shared_ptr<spdlog::logger> logger;
+
+        if (test_case.mode == logger_mode::sync)
+        {
+            logger = std::make_shared<spdlog::logger>("benchmark", std::move(sink));
+        }
+        else
+        {
+            auto policy = test_case.mode == logger_mode::async_block
+                ? spdlog::async_overflow_policy::block
+                : spdlog::async_overflow_policy::overrun_oldest;
+
+            thread_pool = std::make_shared<spdlog::details::thread_pool>(options.queue_size, 1);
+            logger = std::make_shared<spdlog::async_logger>("benchmark", std::move(sink), thread_pool, policy);
+        }
+
+        logger->set_level(spdlog::level::info);
+        logger->flush_on(spdlog::level::off);
+
+        const std::string payload(test_case.message_size, 'x');
+        const std::size_t messages_per_thread = options.messages / test_case.threads;
+
+        std::vector<std::vector<std::uint64_t>> latencies(test_case.threads);
+        std::vector<std::thread> producers;
+
+        std::atomic<std::size_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+
+        for (std::size_t t = 0; t < test_case.threads; ++t)
+        {
+            latencies[t].reserve(messages_per_thread);
+
+            producers.emplace_back([&, t]() {
+                auto& thread_latencies = latencies[t];
+
+                ready.fetch_add(1, std::memory_order_acq_rel);
+
+                while (!go.load(std::memory_order_acquire))
+                {
+                    std::this_thread::yield();
+                }
+
+                for (std::size_t i = 0; i < messages_per_thread; ++i)
+                {
+                    auto start = std::chrono::steady_clock::now();
+
+                    logger->info("Message #{}: {}", i, payload);
+
+                    auto end = std::chrono::steady_clock::now();
+
+                    thread_latencies.push_back(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+                }
+            });
+        }
+
+        while (ready.load(std::memory_order_acquire) != test_case.threads)
+        {
+            std::this_thread::yield();
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        go.store(true, std::memory_order_release);
+
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+
+        // Throughput includes getting everything through the sink, not just into the queue.
+        logger->flush();
+
+        if (thread_pool)
+        {
+            thread_pool->drain();
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        result.messages = messages_per_thread * test_case.threads;
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.messages_per_second = result.seconds > 0.0 ? static_cast<double>(result.messages) / result.seconds : 0.0;
+
+        if (thread_pool)
+        {
+            result.overruns = thread_pool->overrun_counter();
+        }
+
+        std::vector<std::uint64_t> all_latencies;
+
+        all_latencies.reserve(result.messages);
+
+        for (auto& thread_latencies : latencies)
+        {
+            all_latencies.insert(all_latencies.end(), thread_latencies.begin(), thread_latencies.end());
+        }
+
+        std::sort(all_latencies.begin(), all_latencies.end());
+
+        if (!all_latencies.empty())
+        {
+            result.latency_min_ns = all_latencies.front();
+            result.latency_max_ns = all_latencies.back();
+        }
+
+        result.latency_p50_ns = percentile(all_latencies, 0.50);
+        result.latency_p90_ns = percentile(all_latencies, 0.90);
+        result.latency_p99_ns = percentile(all_latencies, 0.99);
+        result.latency_p999_ns = percentile(all_latencies, 0.999);
+    }
+
+    // Loggers and sinks are gone (rotating sink archive worker joined), safe to clean up.
+    std::filesystem::remove_all(directory);
+
+    return result;
+}
+
+std::vector<std::size_t> thread_counts(std::size_t max_threads)
+{
+    std::vector<std::size_t> counts;
+
+    for (std::size_t count = 1; count < max_threads; count *= 2)
+    {
+        counts.push_back(count);
+    }
+
+    counts.push_back(max_threads);
+
+    return counts;
+}
+
+void write_json(FILE* file, const benchmark_options& options, const std::vector<benchmark_result>& results)
+{
+    fmt::print(file, "{{\n");
+    fmt::print(file, "  \"spdlog_version\": \"{}.{}.{}\",\n", SPDLOG_VER_MAJOR, SPDLOG_VER_MINOR, SPDLOG_VER_PATCH);
+    fmt::print(file, "  \"messages\": {},\n", options.messages);
+    fmt::print(file, "  \"queue_size\": {},\n", options.queue_size);
+    fmt::print(file, "  \"hardware_concurrency\": {},\n", std::thread::hardware_concurrency());
+    fmt::print(file, "  \"results\": [\n");
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+
+        fmt::print(file,
+            "    {{\"mode\": \"{}\", \"sink\": \"{}\", \"threads\": {}, \"message_size\": {}, "
+            "\"messages\": {}, \"seconds\": {:.6f}, \"messages_per_second\": {:.1f}, \"overruns\": {}, "
+            "\"latency_ns\": {{\"min\": {}, \"p50\": {}, \"p90\": {}, \"p99\": {}, \"p999\": {}, \"max\": {}}}}}{}\n",
+            to_string(result.test_case.mode),
+            to_string(result.test_case.sink),
+            result.test_case.threads,
+            result.test_case.message_size,
+            result.messages,
+            result.seconds,
+            result.messages_per_second,
+            result.overruns,
+            result.latency_min_ns,
+            result.latency_p50_ns,
+            result.latency_p90_ns,
+            result.latency_p99_ns,
+            result.latency_p999_ns,
+            result.latency_max_ns,
+            i + 1 < results.size() ? "," : "");
+    }
+
+    fmt::print(file, "  ]\n");
+    fmt::print(file, "}}\n");
+}
+
+bool parse_size(const char* value, std::size_t& out)
+{
+    char* end = nullptr;
+
+    auto parsed = std::strtoull(value, &end, 10);
+
+    if (end == value || *end != '\0' || parsed == 0)
+    {
+        return false;
+    }
+
+    out = static_cast<std::size_t>(parsed);
+
+    return true;
+}
+
+bool parse_options(int argc, char* argv[], benchmark_options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            fmt::print(stderr, "Missing value for '{}'.\n", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+
+        bool valid = true;
+
+        if (arg == "--messages")
+        {
+            valid = parse_size(value, options.messages);
+        }
+        else if (arg == "--max-threads")
+        {
+            valid = parse_size(value, options.max_threads);
+        }
+        else if (arg == "--queue-size")
+        {
+            valid = parse_size(value, options.queue_size);
+        }
+        else if (arg == "--output")
+        {
+            options.output = value;
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown option '{}'.\n", arg);
+            return false;
+        }
+
+        if (!valid)
+        {
+            fmt::print(stderr, "Invalid value '{}' for '{}'.\n", value, arg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    benchmark_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fmt::print(stderr, "Usage: {} [--messages N] [--max-threads N] [--queue-size N] [--output file.json]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<benchmark_result> results;
+
+    try
+    {
+        null_device device;
+
+        for (auto mode : { logger_mode::sync, logger_mode::async_block, logger_mode::async_overrun_oldest })
+        {
+            for (auto sink : { sink_type::null, sink_type::basic_file, sink_type::rotating_file, sink_type::ansicolor })
+            {
+                for (auto threads : thread_counts(options.max_threads))
+                {
+                    for (auto message_size : MESSAGE_SIZES)
+                    {
+                        benchmark_case test_case{ mode, sink, threads, message_size };
+
+                        auto result = run_case(test_case, options, device);
+
+                        fmt::print(stderr, "{:<22} {:<20} threads={:<3} size={:<5} {:>12.0f} msg/s  p50={}ns p99={}ns\n",
+                            to_string(mode),
+                            to_string(sink),
+                            threads,
+                            message_size,
+                            result.messages_per_second,
+                            result.latency_p50_ns,
+                            result.latency_p99_ns);
+
+                        results.push_back(result);
+                    }
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print(stderr, "Benchmark failed: {}\n", e.what());
+        return 1;
+    }
+
+    if (options.output.empty())
+    {
+        write_json(stdout, options, results);
+    }
+    else
+    {
+        FILE* file = std::fopen(options.output.c_str(), "w");
+
+        if (file == nullptr)
+        {
+            fmt::print(stderr, "Could not open '{}' for writing.\n", options.output);
+            return 1;
+        }
+
+        write_json(file, options, results);
+
+        std::fclose(file);
+    }
+
+    return 0;
+}
@@ -0,0 +1,474 @@
+// Query tool for the files written by spdlog::sinks::binary_file_sink.
+//
+// Maps the file and prints the matching records as text. Blocks are skipped using the index
+// footer (or the block headers, when the file has no index) whenever their time range, levels
+// or thread bloom mask show they can't contain a match, so only matching blocks are read.
+//
+// Usage: log_query [--from TIME] [--to TIME] [--level LEVEL] [--thread ID] [--count] file.binlog
+//
+// TIME is either seconds since epoch (fractions allowed) or local time 'YYYY-MM-DD HH:MM:SS[.fff]'.
+// LEVEL is the minimum level (trace, debug, info, warning, error, critical).
+
+#include "log/spdlog/details/binary_log_format.h"
+#include "log/spdlog/details/os.h"
+#include "log/spdlog/spdlog.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+namespace bl = spdlog::details::binary_log;
+
+struct query_options
+{
+    std::uint64_t from{ 0 };
+    std::uint64_t to{ std::numeric_limits<std::uint64_t>::max() };
+    spdlog::level::level_enum level{ spdlog::level::trace };
+    bool has_thread{ false };
+    std::uint64_t thread{ 0 };
+    bool count_only{ false };
+    std::string filename;
+};
+
+class mapped_file
+{
+public:
+    explicit mapped_file(const std::string& filename)
+    {
+#ifdef _WIN32
+        file_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        LARGE_INTEGER size{};
+
+        if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+        {
+            return;
+        }
+
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (mapping_ == nullptr)
+        {
+            return;
+        }
+
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        size_ = data_ != nullptr ? static_cast<std::size_t>(size.QuadPart) : 0;
+#else
+        fd_ = ::open(filename.c_str(), O_RDONLY);
+
+        struct stat st{};
+
+        if (fd_ == -1 || ::fstat(fd_, &st) != 0 || st.st_size == 0)
+        {
+            return;
+        }
+
+        auto* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+
+        if (data == MAP_FAILED)
+        {
+            return;
+        }
+
+        ::madvise(data, static_cast<std::size_t>(st.st_size), MADV_RANDOM);
+
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+    }
+
+    ~mapped_file()
+    {
+#ifdef _WIN32
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+
+        if (file_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_);
+        }
+#else
+        if (data_ != nullptr)
+        {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+
+        if (fd_ != -1)
+        {
+            ::close(fd_);
+        }
+#endif
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const char* data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE file_{ INVALID_HANDLE_VALUE };
+    HANDLE mapping_{ nullptr };
+#else
+    int fd_{ -1 };
+#endif
+    const char* data_{ nullptr };
+    std::size_t size_{ 0 };
+};
+
+template<typename T>
+T read_pod(const char* data)
+{
+    T value;
+
+    std::memcpy(&value, data, sizeof(T));
+
+    return value;
+}
+
+// index entries from the footer, or rebuilt from the block headers when the file has none.
+std::vector<bl::index_entry> load_index(const mapped_file& file, bool& has_footer)
+{
+    std::vector<bl::index_entry> index;
+
+    auto size = file.size();
+
+    has_footer = false;
+
+    if (size >= sizeof(bl::file_header) + sizeof(bl::index_footer))
+    {
+        auto footer = read_pod<bl::index_footer>(file.data() + size - sizeof(bl::index_footer));
+
+        if (footer.magic == bl::index_magic && footer.index_offset >= sizeof(bl::file_header) &&
+            footer.index_offset + footer.entry_count * sizeof(bl::index_entry) + sizeof(bl::index_footer) == size)
+        {
+            index.resize(static_cast<std::size_t>(footer.entry_count));
+
+            if (!index.empty())
+            {
+                std::memcpy(index.data(), file.data() + footer.index_offset, index.size() * sizeof(bl::index_entry));
+            }
+
+            has_footer = true;
+
+            return index;
+        }
+    }
+
+    std::uint64_t offset = sizeof(bl::file_header);
+
+    while (offset + sizeof(bl::block_header) <= size)
+    {
+        auto block = read_pod<bl::block_header>(file.data() + offset);
+
+        if (block.magic != bl::block_magic || offset + sizeof(bl::block_header) + block.size > size)
+        {
+            break;
+        }
+
+        index.push_back({ offset, block.min_time, block.max_time, block.thread_mask, block.record_count, block.level_mask });
+
+        offset += sizeof(bl::block_header) + block.size;
+    }
+
+    return index;
+}
+
+void print_record(const bl::record_header& header, const char* strings)
+{
+    std::string_view logger_name{ strings, header.logger_name_size };
+    strings += header.logger_name_size;
+
+    std::string_view filename{ strings, header.filename_size };
+    strings += header.filename_size;
+
+    std::string_view funcname{ strings, header.funcname_size };
+    strings += header.funcname_size;
+
+    std::string_view payload{ strings, header.payload_size };
+
+    auto seconds = static_cast<std::time_t>(header.time / 1000000000);
+    auto tm = spdlog::details::os::localtime(seconds);
+
+    auto level = header.level < spdlog::level::n_levels ? static_cast<spdlog::level::level_enum>(header.level) : spdlog::level::off;
+    auto level_name = spdlog::level::to_string_view(level);
+
+    fmt::print("[{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:06}] [{}] [{}] [{}] ",
+        tm.tm_year + 1900,
+        tm.tm_mon + 1,
+        tm.tm_mday,
+        tm.tm_hour,
+        tm.tm_min,
+        tm.tm_sec,
+        (header.time % 1000000000) / 1000,
+        logger_name,
+        std::string_view{ level_name.data(), level_name.size() },
+        header.thread_id);
+
+    if (!filename.empty())
+    {
+        fmt::print("[{}:{}{}{}] ", filename, header.line, funcname.empty() ? "" : " ", funcname);
+    }
+
+    fmt::print("{}\n", payload);
+}
+
+bool parse_time(const char* value, std::uint64_t& out)
+{
+    char* end = nullptr;
+
+    auto seconds = std::strtod(value, &end);
+
+    if (end != value && *end == '\0' && seconds >= 0.0)
+    {
+        out = static_cast<std::uint64_t>(seconds * 1e9);
+        return true;
+    }
+
+    std::tm tm{};
+    double fraction = 0.0;
+    int consumed = 0;
+
+    if (std::sscanf(value, "%d-%d-%d %d:%d:%d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 6)
+    {
+        return false;
+    }
+
+    if (value[consumed] == '.')
+    {
+        fraction = std::strtod(value + consumed, &end);
+    }
+    else
+    {
+        end = const_cast<char*>(value + consumed);
+    }
+
+    if (*end != '\0')
+    {
+        return false;
+    }
+
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+
+    auto time = std::mktime(&tm);
+
+    if (time == static_cast<std::time_t>(-1))
+    {
+        return false;
+    }
+
+    out = static_cast<std::uint64_t>(time) * 1000000000 + static_cast<std::uint64_t>(std::llround(fraction * 1e9));
+
+    return true;
+}
+
+bool parse_options(int argc, char* argv[], query_options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--count")
+        {
+            options.count_only = true;
+            continue;
+        }
+
+        if (arg.rfind("--", 0) != 0)
+        {
+            if (!options.filename.empty())
+            {
+                fmt::print(stderr, "Only one file can be queried.\n");
+                return false;
+            }
+
+            options.filename = arg;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            fmt::print(stderr, "Missing value for '{}'.\n", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+
+        bool valid = true;
+
+        if (arg == "--from")
+        {
+            valid = parse_time(value, options.from);
+        }
+        else if (arg == "--to")
+        {
+            valid = parse_time(value, options.to);
+        }
+        else if (arg == "--level")
+        {
+            options.level = spdlog::level::from_str(value);
+            valid = options.level != spdlog::level::off || std::strcmp(value, "off") == 0;
+        }
+        else if (arg == "--thread")
+        {
+            char* end = nullptr;
+
+            options.thread = std::strtoull(value, &end, 10);
+            options.has_thread = true;
+
+            valid = end != value && *end == '\0';
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown option '{}'.\n", arg);
+            return false;
+        }
+
+        if (!valid)
+        {
+            fmt::print(stderr, "Invalid value '{}' for '{}'.\n", value, arg);
+            return false;
+        }
+    }
+
+    if (options.filename.empty())
+    {
+        fmt::print(stderr, "No file given.\n");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    query_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fmt::print(stderr, "Usage: {} [--from TIME] [--to TIME] [--level LEVEL] [--thread ID] [--count] file.binlog\n", argv[0]);
+        return 1;
+    }
+
+    mapped_file file(options.filename);
+
+    if (file.data() == nullptr || file.size() < sizeof(bl::file_header))
+    {
+        fmt::print(stderr, "Could not map '{}'.\n", options.filename);
+        return 1;
+    }
+
+    auto file_header = read_pod<bl::file_header>(file.data());
+
+    if (std::memcmp(file_header.magic, bl::file_magic, sizeof(file_header.magic)) != 0 || file_header.version != bl::format_version)
+    {
+        fmt::print(stderr, "'{}' is not a binary log file.\n", options.filename);
+        return 1;
+    }
+
+    bool has_footer = false;
+
+    auto index = load_index(file, has_footer);
+
+    if (!has_footer)
+    {
+        fmt::print(stderr, "'{}' has no index (not closed properly), scanning block headers.\n", options.filename);
+    }
+
+    // levels >= options.level
+    std::uint32_t level_mask = ~((std::uint32_t{ 1 } << options.level) - 1);
+    std::uint64_t thread_bit = options.has_thread ? bl::thread_bit(options.thread) : ~std::uint64_t{ 0 };
+
+    std::size_t blocks_read{ 0 };
+    std::size_t matches{ 0 };
+
+    for (auto& entry : index)
+    {
+        if (entry.max_time < options.from || entry.min_time > options.to || (entry.level_mask & level_mask) == 0 ||
+            (entry.thread_mask & thread_bit) == 0)
+        {
+            continue;
+        }
+
+        ++blocks_read;
+
+        auto block = read_pod<bl::block_header>(file.data() + entry.offset);
+
+        const char* record = file.data() + entry.offset + sizeof(bl::block_header);
+        const char* block_end = record + block.size;
+
+        for (std::uint32_t i = 0; i < block.record_count && record + sizeof(bl::record_header) <= block_end; ++i)
+        {
+            auto header = read_pod<bl::record_header>(record);
+
+            std::size_t strings_size = std::size_t{ header.logger_name_size } + header.filename_size + header.funcname_size + header.payload_size;
+
+            if (header.size < sizeof(bl::record_header) + strings_size || header.size > static_cast<std::size_t>(block_end - record))
+            {
+                fmt::print(stderr, "Corrupt record in block at offset {}.\n", entry.offset);
+                break;
+            }
+
+            if (header.time >= options.from && header.time <= options.to && header.level >= options.level &&
+                (!options.has_thread || header.thread_id == options.thread))
+            {
+                ++matches;
+
+                if (!options.count_only)
+                {
+                    print_record(header, record + sizeof(bl::record_header));
+                }
+            }
+
+            record += header.size;
+        }
+    }
+
+    if (options.count_only)
+    {
+        fmt::print("{}\n", matches);
+    }
+
+    fmt::print(stderr, "{} matching records, read {} of {} blocks.\n", matches, blocks_read, index.size());
+
+    return 0;
+}
@@ -0,0 +1,504 @@
+// Live viewer for spdlog::sinks::shared_memory_sink.
+//
+// Maps the shared memory read-only and prints the records as they are written, and the counters
+// every few seconds. The writer never waits for the viewer: records overwritten before they
+// could be read are counted and reported as lost. When the writer dies without closing the
+// segment, or a new writer replaces it, the viewer reports it and follows the next segment.
+//
+// Usage: log_viewer [--level LEVEL] [--history N] [--counters SECONDS] [NAME]
+//
+// NAME is the name given to the sink (default 'vulkantesting').
+// LEVEL is the minimum level (trace, debug, info, warning, error, critical).
+// --history prints up to N records written before the viewer started (default 100).
+// --counters sets the interval of the counter lines, 0 disables them (default 1).
+
+#include "log/spdlog/details/shared_memory_log_format.h"
+#include "log/spdlog/spdlog.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+namespace shm = spdlog::details::shared_memory_log;
+
+constexpr static std::chrono::milliseconds POLL_INTERVAL{ 20 };
+constexpr static std::chrono::milliseconds OPEN_RETRY_INTERVAL{ 500 };
+// How often a followed segment is checked for a dead or replaced writer.
+constexpr static std::chrono::milliseconds WRITER_CHECK_INTERVAL{ 500 };
+// A writer updates the counters in a few microseconds, an odd sequence for longer means it died mid-update.
+constexpr static std::chrono::milliseconds COUNTERS_READ_TIMEOUT{ 50 };
+
+struct viewer_options
+{
+    spdlog::level::level_enum level{ spdlog::level::trace };
+    std::uint64_t history{ 100 };
+    std::chrono::seconds counters_interval{ 1 };
+    std::string name{ "vulkantesting" };
+};
+
+class mapped_segment
+{
+public:
+    explicit mapped_segment(const std::string& name)
+    {
+        auto object_name = shm::object_name(name);
+
+#ifdef _WIN32
+        mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, object_name.c_str());
+
+        if (mapping_ == nullptr)
+        {
+            return;
+        }
+
+        auto* data = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+
+        MEMORY_BASIC_INFORMATION info{};
+
+        if (data == nullptr || VirtualQuery(data, &info, sizeof(info)) == 0)
+        {
+            return;
+        }
+
+        header_ = static_cast<const shm::header*>(data);
+        size_ = info.RegionSize;
+#else
+        int fd = ::shm_open(object_name.c_str(), O_RDONLY, 0);
+
+        if (fd == -1)
+        {
+            return;
+        }
+
+        struct stat st{};
+
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(shm::header))
+        {
+            ::close(fd);
+            return;
+        }
+
+        auto* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+        ::close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            return;
+        }
+
+        header_ = static_cast<const shm::header*>(data);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+    }
+
+    ~mapped_segment()
+    {
+#ifdef _WIN32
+        if (header_ != nullptr)
+        {
+            UnmapViewOfFile(header_);
+        }
+
+        if (mapping_ != nullptr)
+        {
+            CloseHandle(mapping_);
+        }
+#else
+        if (header_ != nullptr)
+        {
+            ::munmap(const_cast<shm::header*>(header_), size_);
+        }
+#endif
+    }
+
+    mapped_segment(const mapped_segment&) = delete;
+    mapped_segment& operator=(const mapped_segment&) = delete;
+
+    // The header, once the writer finished initializing it and the segment is big enough for its slots.
+    const shm::header* header() const
+    {
+        if (header_ == nullptr || std::memcmp(header_->magic, shm::magic, sizeof(header_->magic)) != 0)
+        {
+            return nullptr;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (header_->version != shm::format_version || header_->slot_count == 0 || shm::segment_size(header_->slot_count) > size_)
+        {
+            return nullptr;
+        }
+
+        return header_;
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE mapping_{ nullptr };
+#endif
+    const shm::header* header_{ nullptr };
+    std::size_t size_{ 0 };
+};
+
+bool process_alive(std::uint64_t pid)
+{
+#ifdef _WIN32
+    auto process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+
+    if (process == nullptr)
+    {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+
+    CloseHandle(process);
+
+    return alive;
+#else
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+struct record
+{
+    std::uint8_t level{ 0 };
+    std::string text;
+};
+
+// Copy record 'index', false if it was overwritten (or is being overwritten) by a newer one.
+bool read_record(const shm::header* header, std::uint64_t index, record& out)
+{
+    auto& slot = shm::slots(header)[index % header->slot_count];
+
+    auto expected = 2 * index + 2;
+
+    if (slot.sequence.load(std::memory_order_acquire) != expected)
+    {
+        return false;
+    }
+
+    out.level = slot.level;
+    out.text.assign(slot.text, std::min<std::size_t>(slot.size, shm::record_text_size));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return slot.sequence.load(std::memory_order_relaxed) == expected;
+}
+
+// False if the counters are still being updated after COUNTERS_READ_TIMEOUT.
+bool read_counters(const shm::header* header, std::vector<shm::counter>& counters)
+{
+    const auto deadline = std::chrono::steady_clock::now() + COUNTERS_READ_TIMEOUT;
+
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        auto sequence = header->counters_sequence.load(std::memory_order_acquire);
+
+        if (sequence % 2 != 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        auto count = std::min<std::size_t>(header->counter_count, shm::counter_capacity);
+
+        counters.assign(header->counters, header->counters + count);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (header->counters_sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// False if the counters could not be read, see read_counters().
+bool print_counters(const shm::header* header)
+{
+    std::vector<shm::counter> counters;
+
+    if (!read_counters(header, counters))
+    {
+        return false;
+    }
+
+    if (counters.empty())
+    {
+        return true;
+    }
+
+    std::string line = "--";
+
+    for (auto& counter : counters)
+    {
+        counter.name[shm::counter_name_size - 1] = '\0';
+
+        line += fmt::format(" {}={}", counter.name, counter.value);
+    }
+
+    fmt::print("{}\n", line);
+
+    return true;
+}
+
+bool parse_options(int argc, char* argv[], viewer_options& options)
+{
+    bool has_name = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--", 0) != 0)
+        {
+            if (has_name)
+            {
+                fmt::print(stderr, "Only one name can be given.\n");
+                return false;
+            }
+
+            options.name = arg;
+            has_name = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            fmt::print(stderr, "Missing value for '{}'.\n", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+
+        bool valid = true;
+
+        if (arg == "--level")
+        {
+            options.level = spdlog::level::from_str(value);
+            valid = options.level != spdlog::level::off || std::strcmp(value, "off") == 0;
+        }
+        else if (arg == "--history" || arg == "--counters")
+        {
+            char* end = nullptr;
+
+            auto number = std::strtoull(value, &end, 10);
+
+            valid = end != value && *end == '\0';
+
+            if (arg == "--history")
+            {
+                options.history = number;
+            }
+            else
+            {
+                options.counters_interval = std::chrono::seconds(number);
+            }
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown option '{}'.\n", arg);
+            return false;
+        }
+
+        if (!valid)
+        {
+            fmt::print(stderr, "Invalid value '{}' for '{}'.\n", value, arg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+enum class follow_result
+{
+    closed,
+    writer_died,
+    replaced
+};
+
+// Prints the records of the segment from 'next' on as they are written, until the writer closes
+// it, dies or another writer takes over the name.
+follow_result follow(const viewer_options& options, const shm::header* header, std::uint64_t next)
+{
+    const auto generation = header->generation;
+
+    std::uint64_t lost{ 0 };
+
+    record current_record;
+
+    auto last_counters = std::chrono::steady_clock::now();
+    auto last_writer_check = last_counters;
+
+    while (true)
+    {
+        bool closed = header->closed.load(std::memory_order_acquire) != 0;
+
+        auto write_index = header->write_index.load(std::memory_order_acquire);
+
+        if (write_index - next > header->slot_count)
+        {
+            lost += write_index - next - header->slot_count;
+            next = write_index - header->slot_count;
+        }
+
+        for (; next < write_index; ++next)
+        {
+            if (!read_record(header, next, current_record))
+            {
+                ++lost;
+                continue;
+            }
+
+            if (current_record.level >= options.level)
+            {
+                fmt::print("{}\n", current_record.text);
+            }
+        }
+
+        if (lost != 0)
+        {
+            fmt::print(stderr, "-- {} record(s) lost, the viewer fell behind.\n", lost);
+            lost = 0;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+
+        if (options.counters_interval.count() != 0 && (now - last_counters >= options.counters_interval || closed))
+        {
+            if (print_counters(header))
+            {
+                last_counters = now;
+            }
+            else
+            {
+                // Stuck in an update, check the writer right away and retry on the next poll.
+                last_writer_check = {};
+            }
+        }
+
+        std::fflush(stdout);
+
+        if (closed)
+        {
+            fmt::print(stderr, "'{}' was closed by the writer.\n", options.name);
+            return follow_result::closed;
+        }
+
+        if (now - last_writer_check >= WRITER_CHECK_INTERVAL)
+        {
+            last_writer_check = now;
+
+            // A new writer unlinks the segment and creates another one (in place on windows).
+            mapped_segment latest(options.name);
+            auto* latest_header = latest.header();
+
+            if (header->generation != generation || (latest_header != nullptr && latest_header->generation != generation))
+            {
+                fmt::print(stderr, "'{}' was replaced by a new writer.\n", options.name);
+                return follow_result::replaced;
+            }
+
+            // The records are all read above, nothing more will come.
+            if (!process_alive(header->writer_pid))
+            {
+                fmt::print(stderr, "The writer of '{}' (pid {}) exited without closing it.\n", options.name, header->writer_pid);
+                return follow_result::writer_died;
+            }
+        }
+
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    viewer_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fmt::print(stderr, "Usage: {} [--level LEVEL] [--history N] [--counters SECONDS] [NAME]\n", argv[0]);
+        return 1;
+    }
+
+    // The generation followed last, a segment left behind by a dead writer is not followed twice.
+    std::uint64_t last_generation{ 0 };
+
+    bool first_segment{ true };
+
+    while (true)
+    {
+        std::unique_ptr<mapped_segment> segment;
+        const shm::header* header{ nullptr };
+
+        bool waiting_reported{ false };
+
+        while (header == nullptr)
+        {
+            segment = std::make_unique<mapped_segment>(options.name);
+            header = segment->header();
+
+            if (header != nullptr && header->generation == last_generation)
+            {
+                header = nullptr;
+            }
+
+            if (header == nullptr)
+            {
+                if (!waiting_reported)
+                {
+                    fmt::print(stderr, "Waiting for '{}'...\n", options.name);
+                    waiting_reported = true;
+                }
+
+                std::this_thread::sleep_for(OPEN_RETRY_INTERVAL);
+            }
+        }
+
+        last_generation = header->generation;
+
+        // The history of the first segment, everything still in the later ones.
+        auto write_index = header->write_index.load(std::memory_order_acquire);
+        auto history = first_segment ? options.history : std::uint64_t{ header->slot_count };
+        auto next = write_index - std::min({ write_index, history, std::uint64_t{ header->slot_count } });
+
+        first_segment = false;
+
+        if (follow(options, header, next) == follow_result::closed)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
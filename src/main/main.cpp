@@ -1,25 +1,467 @@
 #include "core/core.h"
 
 #include "log/spdlog/sinks/basic_file_sink.h"
+#include "log/spdlog/sinks/binary_file_sink.h"
+#include "log/spdlog/sinks/shared_memory_sink.h"
+#include "log/spdlog/sinks/stdout_color_sinks.h"
 
 #include "core/engine.h"
+#include "core/timing_summary.h"
 
-void initialize_logging()
+constexpr static std::size_t LOG_QUEUE_SIZE = 8192;
+constexpr static std::size_t FLIGHT_RECORDER_RECORDS_PER_THREAD = 4096;
+constexpr static const char* FLIGHT_RECORDER_FILENAME = "vulkantesting.flight.log";
+constexpr static const char* BINARY_LOG_FILENAME = "vulkantesting.binlog";
+constexpr static const char* SHARED_MEMORY_LOG_NAME = "vulkantesting";
+
+// Benchmark mode: a fixed workload, then the statistics as JSON on stdout (and in the report file).
+struct benchmark_options
+{
+    bool enabled{ false };
+
+    // Measured frames, 0 when only the duration ends the run.
+    std::uint64_t frames{ 0 };
+
+    // Frames run before measuring, pipelines and caches settle.
+    std::uint64_t warmup{ 0 };
+
+    // Measuring stops after this long, 0 when only the frame count ends the run.
+    std::chrono::duration<double> duration{ 0.0 };
+
+    std::string report;
+};
+
+struct command_line
 {
-    spdlog::init_thread_pool(8192, 1);
+    engine_config config;
+    benchmark_options benchmark;
+
+    bool help{ false };
+};
+
+constexpr static const char* USAGE =
+    "Usage: vulkantesting [--help] [--frames N] [--warmup N] [--duration SECONDS] [--report FILE]\n"
+    "                     [--present-mode immediate|mailbox|fifo|fifo_relaxed|low_latency] [--gpu-type discrete|integrated|cpu]\n"
+    "                     [--validation on|off] [--dynamic-resolution on|off] [--draws N] [--headless WIDTHxHEIGHT]\n"
+    "--frames or --duration runs a benchmark, the statistics are printed as JSON. The options override the VKT_* environment variables.\n";
+
+void initialize_logging(bool benchmark)
+{
+    spdlog::init_thread_pool(LOG_QUEUE_SIZE, 1);
+
+    const bool sync_logging = has_environment_variable("VKT_SYNC_LOGGING");
+
+    // Synchronous logging flushes the file after every message, the logging thread
+    // flushes it by its flush_policy (size, age and level) instead.
+    // In benchmark mode stdout only carries the JSON results, the console output goes to stderr.
+    spdlog::sink_ptr console_sink;
 
-    auto default_logger = spdlog::default_logger();
+    if (benchmark)
+    {
+        console_sink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+    }
+    else
+    {
+        console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    }
+
+    std::vector<spdlog::sink_ptr> sinks{
+        console_sink,
+        std::make_shared<spdlog::sinks::basic_file_sink_mt>("vulkantesting.log", true, sync_logging)
+    };
+
+    if (has_environment_variable("VKT_BINARY_LOG"))
+    {
+        // Unformatted records, appended across runs and indexed for the log_query tool.
+        sinks.push_back(std::make_shared<spdlog::sinks::binary_file_sink_mt>(BINARY_LOG_FILENAME));
+    }
+
+    if (has_environment_variable("VKT_SHARED_MEMORY_LOG"))
+    {
+        // Records and engine counters for the log_viewer tool, readers never slow down the logging thread.
+        sinks.push_back(std::make_shared<spdlog::sinks::shared_memory_sink_mt>(SHARED_MEMORY_LOG_NAME));
+    }
+
+    // The regular sinks run at info (or VKT_LOG_LEVEL), the flight recorder keeps everything
+    // down to trace and is dumped on crashes and fence timeouts.
+    auto sink_level = spdlog::level::info;
+
+    if (auto level_name = get_environment_variable("VKT_LOG_LEVEL"))
+    {
+        sink_level = spdlog::level::from_str(*level_name);
+    }
+
+    for (auto& sink : sinks)
+    {
+        sink->set_level(sink_level);
+    }
+
+    if (benchmark)
+    {
+        // The console only gets the problems, the file has everything.
+        sinks.front()->set_level(std::max(sink_level, spdlog::level::warn));
+    }
+
+    spdlog::details::flight_recorder::enable(FLIGHT_RECORDER_RECORDS_PER_THREAD);
+    spdlog::details::flight_recorder::install_crash_handler(FLIGHT_RECORDER_FILENAME);
+
+    std::shared_ptr<spdlog::logger> default_logger;
+
+    if (sync_logging)
+    {
+        // Everything is written and flushed on the calling thread, nothing is lost when crashing.
+        default_logger = std::make_shared<spdlog::logger>("", sinks.begin(), sinks.end());
+    }
+    else
+    {
+        // Console and file output happen on the logging thread, a full queue drops the oldest
+        // messages (counted in the log queue stats) instead of stalling the frame loop on a slow
+        // console. Flushes and drain_log() still wait, they are never dropped.
+        default_logger = std::make_shared<spdlog::async_logger>(
+            "", sinks.begin(), sinks.end(), spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+    }
 
     default_logger->set_level(spdlog::level::trace);
 
-    auto file_sink_ptr = std::make_shared<spdlog::sinks::basic_file_sink_mt>("vulkantesting.log", true);
-    default_logger->sinks().emplace_back(std::move(file_sink_ptr));
+    spdlog::set_default_logger(std::move(default_logger));
 
     spdlog::set_pattern("%T.%f %-20t %-40s %-5# %-8l : %^%v%$");
+
+    // Runtime levels per log category, e.g. VKT_LOG_CATEGORIES="info,validation=warn".
+    // Disabled categories skip formatting entirely, also for the flight recorder.
+    if (auto categories = get_environment_variable("VKT_LOG_CATEGORIES"))
+    {
+        log_category::configure(*categories);
+    }
+}
+
+#ifdef WIN32
+std::vector<std::string> command_line_arguments()
+{
+    std::vector<std::string> arguments;
+
+    for (int index = 1; index < __argc; ++index)
+    {
+        const auto size = WideCharToMultiByte(CP_UTF8, 0, __wargv[index], -1, nullptr, 0, nullptr, nullptr);
+
+        std::string argument(size > 0 ? static_cast<std::size_t>(size) - 1 : 0, '\0');
+
+        WideCharToMultiByte(CP_UTF8, 0, __wargv[index], -1, argument.data(), size, nullptr, nullptr);
+
+        arguments.push_back(std::move(argument));
+    }
+
+    return arguments;
+}
+#else
+std::vector<std::string> command_line_arguments(int argc, char* argv[])
+{
+    return std::vector<std::string>(argv + 1, argv + argc);
+}
+#endif
+
+bool parse_switch(const std::string& value, std::optional<bool>& out)
+{
+    if (value == "on" || value == "off")
+    {
+        out = value == "on";
+
+        return true;
+    }
+
+    return false;
+}
+
+bool parse_command_line(const std::vector<std::string>& arguments, command_line& result)
+{
+    auto& config = result.config;
+    auto& benchmark = result.benchmark;
+
+    for (std::size_t index = 0; index < arguments.size(); ++index)
+    {
+        const auto& argument = arguments[index];
+
+        if (argument == "--help" || argument == "-h")
+        {
+            result.help = true;
+
+            return true;
+        }
+
+        if (index + 1 >= arguments.size())
+        {
+            fmt::print(stderr, "Missing value for '{}'.\n", argument);
+
+            return false;
+        }
+
+        const auto& value = arguments[++index];
+
+        std::uint64_t number{ 0 };
+
+        bool valid = true;
+
+        if (argument == "--frames")
+        {
+            valid = parse_unsigned(value, benchmark.frames) && benchmark.frames > 0;
+        }
+        else if (argument == "--warmup")
+        {
+            valid = parse_unsigned(value, benchmark.warmup);
+        }
+        else if (argument == "--duration")
+        {
+            char* end = nullptr;
+
+            benchmark.duration = std::chrono::duration<double>(std::strtod(value.c_str(), &end));
+
+            valid = end != value.c_str() && *end == '\0' && benchmark.duration.count() > 0.0;
+        }
+        else if (argument == "--report")
+        {
+            benchmark.report = value;
+        }
+        else if (argument == "--present-mode")
+        {
+            if (value == "low_latency")
+            {
+                config.low_latency = true;
+            }
+            else
+            {
+                config.present_mode = present_mode_from_name(value);
+
+                valid = config.present_mode.has_value();
+            }
+        }
+        else if (argument == "--gpu-type")
+        {
+            if (value == "discrete")
+            {
+                config.gpu_type = vk::PhysicalDeviceType::eDiscreteGpu;
+            }
+            else if (value == "integrated")
+            {
+                config.gpu_type = vk::PhysicalDeviceType::eIntegratedGpu;
+            }
+            else if (value == "cpu")
+            {
+                config.gpu_type = vk::PhysicalDeviceType::eCpu;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (argument == "--validation")
+        {
+            valid = parse_switch(value, config.validation);
+        }
+        else if (argument == "--dynamic-resolution")
+        {
+            valid = parse_switch(value, config.dynamic_resolution);
+        }
+        else if (argument == "--draws")
+        {
+            valid = parse_unsigned(value, number) && number > 0 && number <= std::numeric_limits<std::uint32_t>::max();
+
+            config.draw_count = static_cast<std::uint32_t>(number);
+        }
+        else if (argument == "--headless")
+        {
+            unsigned int width{ 0 };
+            unsigned int height{ 0 };
+            char rest{ 0 };
+
+            valid = std::sscanf(value.c_str(), "%ux%u%c", &width, &height, &rest) == 2 && width > 0 && height > 0;
+
+            config.headless = true;
+            config.headless_extent = vk::Extent2D{ width, height };
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown option '{}'.\n", argument);
+
+            return false;
+        }
+
+        if (!valid)
+        {
+            fmt::print(stderr, "Invalid value '{}' for '{}'.\n", value, argument);
+
+            return false;
+        }
+    }
+
+    benchmark.enabled = benchmark.frames > 0 || benchmark.duration.count() > 0.0;
+
+    if (!benchmark.enabled && (benchmark.warmup > 0 || !benchmark.report.empty()))
+    {
+        fmt::print(stderr, "--warmup and --report need --frames or --duration.\n");
+
+        return false;
+    }
+
+    return true;
+}
+
+// The buckets with frames in them, as [upper edge in ms, count].
+std::string input_latency_json(const engine& engine_instance)
+{
+    const auto& histogram = engine_instance.input_latency();
+
+    std::string buckets;
+
+    for (std::size_t index = 0; index < histogram.buckets().size(); ++index)
+    {
+        if (histogram.buckets()[index] == 0)
+        {
+            continue;
+        }
+
+        buckets += fmt::format("{}[{:.1f}, {}]", buckets.empty() ? "" : ", ",
+            static_cast<float>(index + 1) * latency_histogram::BUCKET_WIDTH_MS, histogram.buckets()[index]);
+    }
+
+    return fmt::format("{{\"until\": \"{}\", \"count\": {}, \"mean\": {:.4f}, \"min\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f}, \"buckets\": [{}]}}",
+        engine_instance.input_latency_to_present() ? "present" : "render", histogram.count(), histogram.mean(), histogram.min(),
+        histogram.percentile(0.50f), histogram.percentile(0.95f), histogram.percentile(0.99f), histogram.max(), buckets);
+}
+
+void print_benchmark_json(FILE* file, const engine& engine_instance, const benchmark_options& benchmark, double seconds,
+    const timing_summary& frame_ms, const timing_summary& cpu_ms, const timing_summary& gpu_ms, const timing_summary& wait_ms, float resolution_scale)
+{
+    auto timing_json = [](const timing_summary& summary) {
+        return fmt::format("{{\"mean\": {:.4f}, \"min\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f}}}",
+            summary.mean, summary.min, summary.p50, summary.p95, summary.p99, summary.max);
+    };
+
+    const auto extent = engine_instance.extent();
+
+    fmt::print(file, "{{\n");
+    fmt::print(file, "  \"device\": \"{}\",\n", json_escape(engine_instance.device_name()));
+    fmt::print(file, "  \"present_mode\": \"{}\",\n", present_mode_name(engine_instance.present_mode()));
+    fmt::print(file, "  \"low_latency\": {},\n", engine_instance.low_latency());
+    fmt::print(file, "  \"width\": {},\n", extent.width);
+    fmt::print(file, "  \"height\": {},\n", extent.height);
+    fmt::print(file, "  \"warmup\": {},\n", benchmark.warmup);
+    fmt::print(file, "  \"frames\": {},\n", frame_ms.count);
+    fmt::print(file, "  \"seconds\": {:.4f},\n", seconds);
+    fmt::print(file, "  \"fps\": {:.2f},\n", seconds > 0.0 ? static_cast<double>(frame_ms.count) / seconds : 0.0);
+    fmt::print(file, "  \"frame_ms\": {},\n", timing_json(frame_ms));
+    fmt::print(file, "  \"cpu_ms\": {},\n", timing_json(cpu_ms));
+    fmt::print(file, "  \"gpu_ms\": {},\n", timing_json(gpu_ms));
+    fmt::print(file, "  \"wait_ms\": {},\n", timing_json(wait_ms));
+    fmt::print(file, "  \"resolution_scale\": {:.3f},\n", resolution_scale);
+    fmt::print(file, "  \"input_latency_ms\": {}\n", input_latency_json(engine_instance));
+    fmt::print(file, "}}\n");
+}
+
+int run_benchmark(command_line command)
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto& benchmark = command.benchmark;
+    auto& config = command.config;
+
+    if (benchmark.frames > 0)
+    {
+        config.frame_limit = benchmark.warmup + benchmark.frames;
+    }
+
+    std::vector<float> frame_times;
+    std::vector<float> cpu_times;
+    std::vector<float> gpu_times;
+    std::vector<float> wait_times;
+
+    frame_times.reserve(benchmark.frames);
+    cpu_times.reserve(benchmark.frames);
+    gpu_times.reserve(benchmark.frames);
+    wait_times.reserve(benchmark.frames);
+
+    clock::time_point previous_frame_end{};
+    clock::time_point measure_start{};
+    clock::time_point measure_end{};
+    float resolution_scale{ 1.0f };
+
+    engine* running_engine{ nullptr };
+
+    config.frame_callback = [&](const frame_stats& stats) {
+        const auto now = clock::now();
+
+        if (stats.frame >= benchmark.warmup)
+        {
+            if (stats.frame == benchmark.warmup)
+            {
+                measure_start = previous_frame_end;
+            }
+
+            frame_times.push_back(std::chrono::duration<float, std::milli>(now - previous_frame_end).count());
+            cpu_times.push_back(stats.cpu_time.count());
+            gpu_times.push_back(stats.gpu_time.count());
+            wait_times.push_back(stats.wait_time.count());
+
+            measure_end = now;
+            resolution_scale = stats.resolution_scale;
+
+            if (benchmark.duration.count() > 0.0 && now - measure_start >= benchmark.duration)
+            {
+                running_engine->stop();
+            }
+        }
+
+        previous_frame_end = now;
+    };
+
+    engine engine_instance(std::move(config));
+
+    running_engine = &engine_instance;
+
+    engine_instance.initialize();
+
+    SPDLOG_INFO("Engine initialized, benchmarking.");
+
+    previous_frame_end = clock::now();
+
+    const auto result = engine_instance.run();
+
+    const auto seconds = std::chrono::duration<double>(measure_end - measure_start).count();
+
+    const auto frame_ms = summarize_timings(std::move(frame_times));
+    const auto cpu_ms = summarize_timings(std::move(cpu_times));
+    const auto gpu_ms = summarize_timings(std::move(gpu_times));
+    const auto wait_ms = summarize_timings(std::move(wait_times));
+
+    print_benchmark_json(stdout, engine_instance, benchmark, seconds, frame_ms, cpu_ms, gpu_ms, wait_ms, resolution_scale);
+
+    if (!benchmark.report.empty())
+    {
+        FILE* file = std::fopen(benchmark.report.c_str(), "w");
+
+        if (file == nullptr)
+        {
+            SPDLOG_ERROR("Could not open '{}' for the benchmark report.", benchmark.report);
+        }
+        else
+        {
+            print_benchmark_json(file, engine_instance, benchmark, seconds, frame_ms, cpu_ms, gpu_ms, wait_ms, resolution_scale);
+
+            std::fclose(file);
+        }
+    }
+
+    engine_instance.destroy();
+
+    return result;
 }
 
-int inner_main()
+int inner_main(command_line command)
 {
+    if (command.benchmark.enabled)
+    {
+        return run_benchmark(std::move(command));
+    }
+
     SPDLOG_INFO("Vulkan testing started.");
 
     SPDLOG_INFO("Initializing engine...");
@@ -27,7 +469,7 @@ int inner_main()
     int result{ -1 };
 
     {
-        engine engine_instance;
+        engine engine_instance(std::move(command.config));
 
         engine_instance.initialize();
 
@@ -61,9 +503,29 @@ int main(int argc, char* argv[])
 {
 #ifdef WIN32
     AllocConsole();
+
+    const auto arguments = command_line_arguments();
+#else
+    const auto arguments = command_line_arguments(argc, argv);
 #endif
 
-    initialize_logging();
+    command_line command;
+
+    if (!parse_command_line(arguments, command))
+    {
+        fmt::print(stderr, "{}", USAGE);
+
+        return 1;
+    }
+
+    if (command.help)
+    {
+        fmt::print("{}", USAGE);
+
+        return 0;
+    }
+
+    initialize_logging(command.benchmark.enabled);
 
     int result;
 
@@ -73,13 +535,13 @@ int main(int argc, char* argv[])
     if (true)
 #endif
     {
-        result = inner_main();
+        result = inner_main(std::move(command));
     }
     else
     {
         try
         {
-            result = inner_main();
+            result = inner_main(std::move(command));
         }
         catch (const std::exception& e)
         {
@@ -87,5 +549,8 @@ int main(int argc, char* argv[])
         }
     }
 
+    // Writes out the queued messages and destroys the loggers, so the binary log gets its index.
+    spdlog::shutdown();
+
     return result;
 }
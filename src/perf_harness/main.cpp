@@ -0,0 +1,722 @@
+// Headless performance regression harness for the engine.
+//
+// Runs the scenes of a script through the engine without a window, on a software Vulkan
+// implementation (lavapipe) by default so the numbers don't depend on the GPU of the machine.
+// Per scene the median and 95th percentile CPU and GPU frame times are measured after a warmup,
+// and the last frame is captured and hashed. The results are compared against a baseline file:
+// a scene fails when its median got slower than the thresholds allow or its image changed.
+//
+// Usage: perf_harness [--scenes FILE] [--baseline FILE] [--update-baseline] [--report FILE]
+//                     [--cpu-threshold PCT] [--gpu-threshold PCT] [--min-delta-ms MS]
+//                     [--icd FILE] [--gpu-type cpu|integrated|discrete] [--captures DIR]
+//
+// Runs from the directory with the spv/ shaders, like vulkantesting. Exits with 1 on a regression
+// and with 2 when the harness itself failed.
+//
+// A scene script has one scene per line, a name and key=value settings, '#' starts a comment:
+//
+//   overdraw frames=200 warmup=20 width=1280 height=720 draws=64 dynamic_resolution=off
+//
+// The baseline has one line per scene in the same form, written by --update-baseline:
+//
+//   overdraw cpu_ms=0.412 gpu_ms=8.125 hash=0123456789abcdef
+
+#include "core/core.h"
+#include "core/engine.h"
+#include "core/timing_summary.h"
+
+#include "log/spdlog/sinks/basic_file_sink.h"
+#include "log/spdlog/sinks/stdout_color_sinks.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+
+constexpr const char* LOG_FILENAME = "perf_harness.log";
+
+// Used without --scenes.
+constexpr const char* DEFAULT_SCENES = R"(
+# Mostly CPU: recording, submitting and the frame loop.
+triangle frames=300 warmup=30 width=1024 height=512 draws=1
+
+# Fill rate bound, the triangle drawn on top of itself.
+overdraw frames=200 warmup=20 width=1280 height=720 draws=64
+
+# Offscreen rendering and the upscale blit, the image depends on the timings and isn't compared.
+dynamic_resolution frames=200 warmup=20 width=1920 height=1080 draws=64 dynamic_resolution=on
+)";
+
+// Where distributions usually install the lavapipe ICD manifest.
+constexpr const char* LAVAPIPE_ICD_FILENAMES[] = {
+    "/usr/share/vulkan/icd.d/lvp_icd.x86_64.json",
+    "/usr/share/vulkan/icd.d/lvp_icd.aarch64.json",
+    "/usr/share/vulkan/icd.d/lvp_icd.json",
+    "/usr/local/share/vulkan/icd.d/lvp_icd.x86_64.json"
+};
+
+struct harness_options
+{
+    std::string scenes;
+    std::string baseline{ "perf_baseline.txt" };
+    bool update_baseline{ false };
+    std::string report;
+
+    // Allowed slowdown of the medians, in percent.
+    double cpu_threshold{ 15.0 };
+    double gpu_threshold{ 15.0 };
+
+    // Differences below this are noise, however large in percent.
+    double min_delta_ms{ 0.05 };
+
+    std::string icd;
+    vk::PhysicalDeviceType gpu_type{ vk::PhysicalDeviceType::eCpu };
+    std::string captures{ "perf_captures" };
+};
+
+struct scene
+{
+    std::string name;
+    std::uint64_t frames{ 200 };
+    std::uint64_t warmup{ 20 };
+    vk::Extent2D extent{ 1024, 512 };
+    std::uint32_t draws{ 1 };
+    bool dynamic_resolution{ false };
+};
+
+struct baseline_entry
+{
+    double cpu_ms{ 0.0 };
+    double gpu_ms{ 0.0 };
+    std::optional<std::uint64_t> hash;
+};
+
+enum class scene_status
+{
+    ok,
+    no_baseline,
+    slower,
+    image_changed,
+    no_capture
+};
+
+struct scene_result
+{
+    scene scene_settings;
+
+    std::uint64_t frames_measured{ 0 };
+    timing_summary cpu;
+    timing_summary gpu;
+    float final_resolution_scale{ 1.0f };
+
+    std::optional<std::uint64_t> hash;
+
+    scene_status status{ scene_status::ok };
+    std::string detail;
+};
+
+const char* to_string(scene_status status)
+{
+    switch (status)
+    {
+    case scene_status::ok:
+        return "ok";
+    case scene_status::no_baseline:
+        return "no_baseline";
+    case scene_status::slower:
+        return "slower";
+    case scene_status::image_changed:
+        return "image_changed";
+    case scene_status::no_capture:
+        return "no_capture";
+    }
+
+    return "unknown";
+}
+
+bool is_failure(scene_status status)
+{
+    return status == scene_status::slower || status == scene_status::image_changed || status == scene_status::no_capture;
+}
+
+// "name key=value key=value", false for blank and comment lines.
+bool split_line(const std::string& line, std::string& name, std::map<std::string, std::string>& values)
+{
+    std::istringstream stream(line.substr(0, line.find('#')));
+
+    if (!(stream >> name))
+    {
+        return false;
+    }
+
+    std::string token;
+
+    while (stream >> token)
+    {
+        const auto equals = token.find('=');
+
+        if (equals == std::string::npos || equals == 0)
+        {
+            throw std::runtime_error(fmt::format("Expected key=value, got '{}' in '{}'.", token, line));
+        }
+
+        values[token.substr(0, equals)] = token.substr(equals + 1);
+    }
+
+    return true;
+}
+
+bool parse_double(const std::string& value, double& out)
+{
+    char* end = nullptr;
+
+    out = std::strtod(value.c_str(), &end);
+
+    return end != value.c_str() && *end == '\0' && out >= 0.0;
+}
+
+std::string read_text_file(const std::string& filename)
+{
+    std::ifstream file(filename);
+
+    if (!file)
+    {
+        throw std::runtime_error(fmt::format("Could not open '{}'.", filename));
+    }
+
+    std::ostringstream contents;
+
+    contents << file.rdbuf();
+
+    return contents.str();
+}
+
+std::vector<scene> parse_scenes(const std::string& script)
+{
+    std::vector<scene> scenes;
+
+    std::istringstream lines(script);
+    std::string line;
+
+    while (std::getline(lines, line))
+    {
+        std::string name;
+        std::map<std::string, std::string> values;
+
+        if (!split_line(line, name, values))
+        {
+            continue;
+        }
+
+        auto& new_scene = scenes.emplace_back();
+
+        new_scene.name = name;
+
+        for (const auto& [key, value] : values)
+        {
+            std::uint64_t number{ 0 };
+
+            bool valid = true;
+
+            if (key == "frames")
+            {
+                valid = parse_unsigned(value, new_scene.frames) && new_scene.frames > 0;
+            }
+            else if (key == "warmup")
+            {
+                valid = parse_unsigned(value, new_scene.warmup);
+            }
+            else if (key == "width")
+            {
+                valid = parse_unsigned(value, number) && number > 0;
+                new_scene.extent.width = static_cast<std::uint32_t>(number);
+            }
+            else if (key == "height")
+            {
+                valid = parse_unsigned(value, number) && number > 0;
+                new_scene.extent.height = static_cast<std::uint32_t>(number);
+            }
+            else if (key == "draws")
+            {
+                valid = parse_unsigned(value, number) && number > 0;
+                new_scene.draws = static_cast<std::uint32_t>(number);
+            }
+            else if (key == "dynamic_resolution")
+            {
+                valid = value == "on" || value == "off";
+                new_scene.dynamic_resolution = value == "on";
+            }
+            else
+            {
+                throw std::runtime_error(fmt::format("Unknown setting '{}' for scene '{}'.", key, name));
+            }
+
+            if (!valid)
+            {
+                throw std::runtime_error(fmt::format("Invalid value '{}' for '{}' of scene '{}'.", value, key, name));
+            }
+        }
+    }
+
+    if (scenes.empty())
+    {
+        throw std::runtime_error("The scene script has no scenes.");
+    }
+
+    return scenes;
+}
+
+std::map<std::string, baseline_entry> read_baseline(const std::string& filename)
+{
+    std::map<std::string, baseline_entry> baseline;
+
+    if (!std::filesystem::exists(filename))
+    {
+        return baseline;
+    }
+
+    std::istringstream lines(read_text_file(filename));
+    std::string line;
+
+    while (std::getline(lines, line))
+    {
+        std::string name;
+        std::map<std::string, std::string> values;
+
+        if (!split_line(line, name, values))
+        {
+            continue;
+        }
+
+        auto& entry = baseline[name];
+
+        if (!parse_double(values["cpu_ms"], entry.cpu_ms) || !parse_double(values["gpu_ms"], entry.gpu_ms))
+        {
+            throw std::runtime_error(fmt::format("Invalid baseline line '{}'.", line));
+        }
+
+        if (values.count("hash"))
+        {
+            entry.hash = std::strtoull(values["hash"].c_str(), nullptr, 16);
+        }
+    }
+
+    return baseline;
+}
+
+void write_baseline(const std::string& filename, const std::vector<scene_result>& results)
+{
+    std::ofstream file(filename, std::ios::trunc);
+
+    file << "# Written by perf_harness --update-baseline, median frame times in milliseconds.\n";
+
+    for (const auto& result : results)
+    {
+        file << fmt::format("{} cpu_ms={:.4f} gpu_ms={:.4f}", result.scene_settings.name, result.cpu.p50, result.gpu.p50);
+
+        if (result.hash && !result.scene_settings.dynamic_resolution)
+        {
+            file << fmt::format(" hash={:016x}", result.hash.value());
+        }
+
+        file << "\n";
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error(fmt::format("Could not write '{}'.", filename));
+    }
+}
+
+scene_result run_scene(const scene& p_scene, const harness_options& options)
+{
+    scene_result result{};
+
+    result.scene_settings = p_scene;
+
+    std::vector<float> cpu_times;
+    std::vector<float> gpu_times;
+
+    cpu_times.reserve(p_scene.frames);
+    gpu_times.reserve(p_scene.frames);
+
+    std::mutex hash_mutex;
+
+    engine_config config{};
+
+    config.headless = true;
+    config.headless_extent = p_scene.extent;
+    config.frame_limit = p_scene.warmup + p_scene.frames;
+    config.draw_count = p_scene.draws;
+    config.gpu_type = options.gpu_type;
+    config.dynamic_resolution = p_scene.dynamic_resolution;
+
+    // Validation costs more than the frames themselves on a software implementation.
+    config.validation = false;
+
+    config.capture_frames = { config.frame_limit - 1 };
+    config.capture_directory = (std::filesystem::path(options.captures) / p_scene.name).string();
+
+    config.capture_callback = [&result, &hash_mutex](const frame_capture::result& capture_result) {
+        std::lock_guard lock(hash_mutex);
+
+        result.hash = capture_result.pixel_hash;
+    };
+
+    config.frame_callback = [&](const frame_stats& stats) {
+        result.final_resolution_scale = stats.resolution_scale;
+
+        if (stats.frame < p_scene.warmup)
+        {
+            return;
+        }
+
+        cpu_times.push_back(stats.cpu_time.count());
+        gpu_times.push_back(stats.gpu_time.count());
+    };
+
+    {
+        engine engine_instance(std::move(config));
+
+        engine_instance.initialize();
+        engine_instance.run();
+
+        // Waits for the capture workers.
+        engine_instance.destroy();
+    }
+
+    result.frames_measured = cpu_times.size();
+    result.cpu = summarize_timings(std::move(cpu_times));
+    result.gpu = summarize_timings(std::move(gpu_times));
+
+    return result;
+}
+
+void compare(scene_result& result, const std::map<std::string, baseline_entry>& baseline, const harness_options& options)
+{
+    const auto found = baseline.find(result.scene_settings.name);
+
+    if (!result.hash && !result.scene_settings.dynamic_resolution)
+    {
+        result.status = scene_status::no_capture;
+        result.detail = "the last frame was not captured";
+
+        return;
+    }
+
+    if (found == baseline.end())
+    {
+        result.status = scene_status::no_baseline;
+
+        return;
+    }
+
+    const auto& entry = found->second;
+
+    auto slower = [&options](double measured, double reference, double threshold_percent) {
+        return measured - reference > options.min_delta_ms && measured > reference * (1.0 + threshold_percent / 100.0);
+    };
+
+    if (slower(result.cpu.p50, entry.cpu_ms, options.cpu_threshold))
+    {
+        result.status = scene_status::slower;
+        result.detail += fmt::format("CPU {:.3f} ms, baseline {:.3f} ms (+{:.1f}%). ", result.cpu.p50, entry.cpu_ms, (result.cpu.p50 / entry.cpu_ms - 1.0) * 100.0);
+    }
+
+    if (slower(result.gpu.p50, entry.gpu_ms, options.gpu_threshold))
+    {
+        result.status = scene_status::slower;
+        result.detail += fmt::format("GPU {:.3f} ms, baseline {:.3f} ms (+{:.1f}%). ", result.gpu.p50, entry.gpu_ms, (result.gpu.p50 / entry.gpu_ms - 1.0) * 100.0);
+    }
+
+    // The resolution of dynamic resolution scenes follows the timings, their images differ between runs.
+    if (!result.scene_settings.dynamic_resolution && entry.hash && result.hash != entry.hash)
+    {
+        result.status = scene_status::image_changed;
+        result.detail += fmt::format("hash {:016x}, baseline {:016x}. ", result.hash.value_or(0), entry.hash.value());
+    }
+}
+
+void write_report(const std::string& filename, const harness_options& options, const std::vector<scene_result>& results)
+{
+    FILE* file = std::fopen(filename.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        throw std::runtime_error(fmt::format("Could not open '{}'.", filename));
+    }
+
+    auto timing_json = [](const timing_summary& summary) {
+        return fmt::format("{{\"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"max\": {:.4f}}}", summary.mean, summary.p50, summary.p95, summary.max);
+    };
+
+    fmt::print(file, "{{\n");
+    fmt::print(file, "  \"cpu_threshold_percent\": {:.1f},\n", options.cpu_threshold);
+    fmt::print(file, "  \"gpu_threshold_percent\": {:.1f},\n", options.gpu_threshold);
+    fmt::print(file, "  \"min_delta_ms\": {:.3f},\n", options.min_delta_ms);
+    fmt::print(file, "  \"scenes\": [\n");
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        const auto& settings = result.scene_settings;
+
+        fmt::print(file,
+            "    {{\"name\": \"{}\", \"width\": {}, \"height\": {}, \"draws\": {}, \"dynamic_resolution\": {}, "
+            "\"frames\": {}, \"cpu_ms\": {}, \"gpu_ms\": {}, \"final_resolution_scale\": {:.3f}, "
+            "\"hash\": \"{}\", \"status\": \"{}\"}}{}\n",
+            json_escape(settings.name),
+            settings.extent.width,
+            settings.extent.height,
+            settings.draws,
+            settings.dynamic_resolution,
+            result.frames_measured,
+            timing_json(result.cpu),
+            timing_json(result.gpu),
+            result.final_resolution_scale,
+            result.hash ? fmt::format("{:016x}", result.hash.value()) : std::string{},
+            to_string(result.status),
+            i + 1 < results.size() ? "," : "");
+    }
+
+    fmt::print(file, "  ]\n");
+    fmt::print(file, "}}\n");
+
+    std::fclose(file);
+}
+
+void set_environment_variable(const char* name, const std::string& value)
+{
+#ifdef WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+// Points the Vulkan loader at the software implementation, before the engine creates its instance.
+void select_icd(const harness_options& options)
+{
+    std::string icd = options.icd;
+
+    if (icd.empty() && options.gpu_type == vk::PhysicalDeviceType::eCpu)
+    {
+        for (const auto* filename : LAVAPIPE_ICD_FILENAMES)
+        {
+            if (std::filesystem::exists(filename))
+            {
+                icd = filename;
+
+                break;
+            }
+        }
+    }
+
+    if (icd.empty())
+    {
+        fmt::print(stderr, "Using the installed Vulkan drivers.\n");
+
+        return;
+    }
+
+    fmt::print(stderr, "Using the Vulkan driver '{}'.\n", icd);
+
+    // VK_DRIVER_FILES replaces VK_ICD_FILENAMES in newer loaders.
+    set_environment_variable("VK_ICD_FILENAMES", icd);
+    set_environment_variable("VK_DRIVER_FILES", icd);
+}
+
+void initialize_logging()
+{
+    // The console only gets the problems, the engine's progress goes to the file.
+    auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+    auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(LOG_FILENAME, true);
+
+    console_sink->set_level(spdlog::level::warn);
+    file_sink->set_level(spdlog::level::info);
+
+    std::vector<spdlog::sink_ptr> sinks{ console_sink, file_sink };
+
+    // Synchronous, no logging thread competing with the frames being measured.
+    auto default_logger = std::make_shared<spdlog::logger>("", sinks.begin(), sinks.end());
+
+    default_logger->set_level(spdlog::level::info);
+
+    spdlog::set_default_logger(std::move(default_logger));
+
+    spdlog::set_pattern("%T.%f %-20t %-40s %-5# %-8l : %^%v%$");
+}
+
+bool parse_options(int argc, char* argv[], harness_options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--update-baseline")
+        {
+            options.update_baseline = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            fmt::print(stderr, "Missing value for '{}'.\n", arg);
+            return false;
+        }
+
+        const std::string value = argv[++i];
+
+        bool valid = true;
+
+        if (arg == "--scenes")
+        {
+            options.scenes = value;
+        }
+        else if (arg == "--baseline")
+        {
+            options.baseline = value;
+        }
+        else if (arg == "--report")
+        {
+            options.report = value;
+        }
+        else if (arg == "--cpu-threshold")
+        {
+            valid = parse_double(value, options.cpu_threshold);
+        }
+        else if (arg == "--gpu-threshold")
+        {
+            valid = parse_double(value, options.gpu_threshold);
+        }
+        else if (arg == "--min-delta-ms")
+        {
+            valid = parse_double(value, options.min_delta_ms);
+        }
+        else if (arg == "--icd")
+        {
+            options.icd = value;
+        }
+        else if (arg == "--gpu-type")
+        {
+            if (value == "cpu")
+            {
+                options.gpu_type = vk::PhysicalDeviceType::eCpu;
+            }
+            else if (value == "integrated")
+            {
+                options.gpu_type = vk::PhysicalDeviceType::eIntegratedGpu;
+            }
+            else if (value == "discrete")
+            {
+                options.gpu_type = vk::PhysicalDeviceType::eDiscreteGpu;
+            }
+            else
+            {
+                valid = false;
+            }
+        }
+        else if (arg == "--captures")
+        {
+            options.captures = value;
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown option '{}'.\n", arg);
+            return false;
+        }
+
+        if (!valid)
+        {
+            fmt::print(stderr, "Invalid value '{}' for '{}'.\n", value, arg);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int inner_main(const harness_options& options)
+{
+    const auto scenes = parse_scenes(options.scenes.empty() ? std::string{ DEFAULT_SCENES } : read_text_file(options.scenes));
+    const auto baseline = read_baseline(options.baseline);
+
+    select_icd(options);
+
+    std::vector<scene_result> results;
+
+    bool failed{ false };
+
+    for (const auto& current_scene : scenes)
+    {
+        fmt::print(stderr, "Running '{}' ({} + {} frames at {}x{}, {} draw(s))...\n", current_scene.name, current_scene.warmup, current_scene.frames,
+            current_scene.extent.width, current_scene.extent.height, current_scene.draws);
+
+        auto& result = results.emplace_back(run_scene(current_scene, options));
+
+        compare(result, baseline, options);
+
+        failed = failed || is_failure(result.status);
+
+        fmt::print("{:<20} cpu p50 {:>8.3f} ms p95 {:>8.3f} ms  gpu p50 {:>8.3f} ms p95 {:>8.3f} ms  {:<16} {:<13} {}\n",
+            current_scene.name,
+            result.cpu.p50,
+            result.cpu.p95,
+            result.gpu.p50,
+            result.gpu.p95,
+            result.hash ? fmt::format("{:016x}", result.hash.value()) : std::string{ "-" },
+            to_string(result.status),
+            result.detail);
+    }
+
+    if (!options.report.empty())
+    {
+        write_report(options.report, options, results);
+    }
+
+    if (options.update_baseline)
+    {
+        write_baseline(options.baseline, results);
+
+        fmt::print(stderr, "Baseline '{}' updated.\n", options.baseline);
+
+        return 0;
+    }
+
+    return failed ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    harness_options options;
+
+    if (!parse_options(argc, argv, options))
+    {
+        fmt::print(stderr, "Usage: {} [--scenes FILE] [--baseline FILE] [--update-baseline] [--report FILE] "
+            "[--cpu-threshold PCT] [--gpu-threshold PCT] [--min-delta-ms MS] [--icd FILE] [--gpu-type cpu|integrated|discrete] [--captures DIR]\n", argv[0]);
+        return 2;
+    }
+
+    initialize_logging();
+
+    int result{ 2 };
+
+    try
+    {
+        result = inner_main(options);
+    }
+    catch (const std::exception& e)
+    {
+        fmt::print(stderr, "Failed: '{}'.\n", e.what());
+    }
+
+    spdlog::shutdown();
+
+    return result;
+}